@@ -0,0 +1,509 @@
+#ifndef ASYNC_LOG_HEADER
+#define ASYNC_LOG_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "IpIpoptApplication.hpp"
+#include "IpJournalist.hpp"
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+/** Where the AsyncLogger writes its lines. Sinks are only called from the thread of the logger. */
+class LogSink {
+public:
+
+    virtual ~LogSink() {}
+
+    /** Write one line, without its newline. line[size] is '\0'. */
+    virtual void write(const char *line, size_t size) = 0;
+
+    /** Called when the logger runs out of lines to write */
+    virtual void flush() {}
+};
+
+class StdoutSink : public LogSink {
+public:
+
+    void write(const char *line, size_t size) override {
+        std::fwrite(line, 1, size, stdout);
+        std::fputc('\n', stdout);
+    }
+
+    void flush() override {
+        std::fflush(stdout);
+    }
+};
+
+class FileSink : public LogSink {
+private:
+
+    std::FILE *file;
+
+public:
+
+    /** Append to the file at path. If it cannot be opened, the lines are dropped. */
+    explicit FileSink(const char *path) : file(std::fopen(path, "a")) {
+    }
+
+    ~FileSink() {
+        if (file)
+            std::fclose(file);
+    }
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    void write(const char *line, size_t size) override {
+        if (!file)
+            return;
+        std::fwrite(line, 1, size, file);
+        std::fputc('\n', file);
+    }
+
+    void flush() override {
+        if (file)
+            std::fflush(file);
+    }
+};
+
+#ifdef __ANDROID__
+
+/** Each line becomes one logcat record */
+class LogcatSink : public LogSink {
+private:
+
+    std::string tag;
+    int priority;
+
+public:
+
+    LogcatSink(const std::string &tag, int priority) : tag(tag), priority(priority) {
+    }
+
+    void write(const char *line, size_t size) override {
+        __android_log_write(priority, tag.c_str(), line);
+    }
+};
+
+#endif
+
+/**
+ * A logger whose callers only copy text into memory. Each thread assembles its current line in a buffer of
+ * its own, and hands complete lines to a bounded lock-free ring. A background thread takes the lines from
+ * the ring and writes them to the sinks. When the ring is full, lines are dropped and counted rather than
+ * making the caller wait, and the logger reports how many were dropped.
+ *
+ * Lines longer than line_capacity are split into several lines.
+ *
+ * A thread that switches to another logger first hands its unfinished line to the previous one. The line refers
+ * to its logger by a number that is never reused, so a line whose logger was destroyed is dropped instead.
+ */
+class AsyncLogger {
+public:
+
+    static constexpr size_t line_capacity = 240;
+
+private:
+
+    /** A slot of the ring. The sequence numbers follow Vyukov's bounded queue, so producers never take a lock. */
+    struct Slot {
+        std::atomic<size_t> sequence;
+        size_t size;
+        char text[line_capacity + 1];
+    };
+
+    /** The line that the calling thread is assembling, and the id of the logger that it belongs to (0 for none) */
+    struct Line {
+        size_t owner = 0;
+        size_t size = 0;
+        char text[line_capacity];
+    };
+
+    static Line &currentLine() {
+        static thread_local Line line;
+        return line;
+    }
+
+    /** The loggers that are alive, so that a line can be handed to its logger by id */
+    static std::mutex &registryMutex() {
+        static std::mutex instance;
+        return instance;
+    }
+
+    static std::vector<AsyncLogger *> &registry() {
+        static std::vector<AsyncLogger *> instance;
+        return instance;
+    }
+
+    static size_t nextId() {
+        static std::atomic<size_t> counter{0};
+        return ++counter;
+    }
+
+    /** Push the unfinished line to the logger with the given id, if it is still alive */
+    static void pushTo(size_t owner, const char *text, size_t size) {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        for (AsyncLogger *logger : registry())
+            if (logger->id == owner)
+                logger->push(text, size);
+    }
+
+    const size_t id;
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    std::atomic<size_t> dropped{0};
+
+    /** The number of lines that were pushed to the ring and written to the sinks */
+    std::atomic<size_t> pushed{0};
+    std::atomic<size_t> written{0};
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable drained;
+    std::vector<std::unique_ptr<LogSink>> sinks;
+    bool stopping = false;
+    std::thread thread;
+
+    void push(const char *text, size_t size) {
+        size_t position = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = slots[position & mask];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - position);
+            if (difference == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    std::memcpy(slot.text, text, size);
+                    slot.text[size] = '\0';
+                    slot.size = size;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    pushed.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            } else if (difference < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** Take the oldest line. Only the thread of the logger calls this. */
+    bool pop(char *text, size_t &size) {
+        const size_t position = tail.load(std::memory_order_relaxed);
+        Slot &slot = slots[position & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+            return false;
+        size = slot.size;
+        std::memcpy(text, slot.text, size + 1);
+        slot.sequence.store(position + mask + 1, std::memory_order_release);
+        tail.store(position + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void writeToSinks(const char *text, size_t size) {
+        for (const std::unique_ptr<LogSink> &sink : sinks)
+            sink->write(text, size);
+    }
+
+    void run() {
+        char text[line_capacity + 1];
+        size_t size;
+        std::chrono::microseconds pause(100);
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            bool any = false;
+            while (pop(text, size)) {
+                writeToSinks(text, size);
+                written.fetch_add(1, std::memory_order_release);
+                any = true;
+            }
+            const size_t lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost > 0) {
+                const int length = std::snprintf(text, sizeof(text), "[%zu log lines dropped]", lost);
+                writeToSinks(text, static_cast<size_t>(length));
+            }
+            if (any || lost > 0) {
+                for (const std::unique_ptr<LogSink> &sink : sinks)
+                    sink->flush();
+                drained.notify_all();
+                pause = std::chrono::microseconds(100);
+            } else if (stopping) {
+                break;
+            }
+
+            /* The callers do not signal new lines, so poll, and back off while the logger is idle */
+            wake.wait_for(lock, pause);
+            pause = std::min(pause * 2, std::chrono::microseconds(20000));
+        }
+    }
+
+public:
+
+    /** Start the thread of the logger, with room for capacity lines, rounded up to a power of two */
+    explicit AsyncLogger(size_t capacity = 1024)
+            : id(nextId()),
+              mask([capacity] {
+                  size_t size = 2;
+                  while (size < capacity)
+                      size *= 2;
+                  return size - 1;
+              }()),
+              slots(new Slot[mask + 1]) {
+        for (size_t i = 0; i <= mask; ++i)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        thread = std::thread(&AsyncLogger::run, this);
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry().push_back(this);
+    }
+
+    AsyncLogger(const AsyncLogger &) = delete;
+
+    AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+    /**
+     * Write the lines that were already pushed, and stop the thread. The unfinished line of the calling thread
+     * is written too, but those of other threads are lost.
+     */
+    ~AsyncLogger() {
+        {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            registry().erase(std::find(registry().begin(), registry().end(), this));
+        }
+        Line &line = currentLine();
+        if (line.owner == id) {
+            if (line.size > 0)
+                push(line.text, line.size);
+            line.owner = 0;
+            line.size = 0;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+
+    /** Add a sink. This may be called while other threads are logging. */
+    void addSink(std::unique_ptr<LogSink> sink) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sinks.push_back(std::move(sink));
+    }
+
+    /** Append text to the line of the calling thread, and push every line that it completes */
+    void append(const char *text, size_t size) {
+        Line &line = currentLine();
+        if (line.owner != id) {
+            if (line.owner != 0 && line.size > 0)
+                pushTo(line.owner, line.text, line.size);
+            line.owner = id;
+            line.size = 0;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            if (text[i] == '\n') {
+                push(line.text, line.size);
+                line.size = 0;
+                continue;
+            }
+            if (line.size == line_capacity) {
+                push(line.text, line.size);
+                line.size = 0;
+            }
+            line.text[line.size++] = text[i];
+        }
+    }
+
+    void append(const char *text) {
+        append(text, std::strlen(text));
+    }
+
+    /** Finish the line of the calling thread, even if it is empty */
+    void endLine() {
+        append("\n", 1);
+    }
+
+    /**
+     * Push the unfinished line of the calling thread, and wait until the thread of the logger has written
+     * every line that was pushed so far. This blocks, so keep it out of the solver.
+     */
+    void flush() {
+        Line &line = currentLine();
+        if (line.owner == id && line.size > 0) {
+            push(line.text, line.size);
+            line.size = 0;
+        }
+        const size_t target = pushed.load(std::memory_order_relaxed);
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.notify_all();
+        drained.wait_for(lock, std::chrono::seconds(1), [this, target] {
+            return written.load(std::memory_order_acquire) >= target;
+        });
+    }
+
+    /** The logger that solveInterruptible attaches to Ipopt (see attachLogJournal), if any */
+    static std::atomic<AsyncLogger *> &ipoptLogger() {
+        static std::atomic<AsyncLogger *> instance{nullptr};
+        return instance;
+    }
+};
+
+/**
+ * The stream interface of an AsyncLogger, so it can replace std::cout. Strings and numbers are copied or
+ * formatted in place, and everything else goes through an ostringstream that each thread reuses.
+ */
+class Log {
+private:
+
+    AsyncLogger &logger;
+
+    static std::ostringstream &scratch() {
+        static thread_local std::ostringstream stream;
+        return stream;
+    }
+
+    template<typename T>
+    void appendNumber(const char *format, T value) {
+        char text[32];
+        const int size = std::snprintf(text, sizeof(text), format, value);
+        logger.append(text, static_cast<size_t>(size));
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    appendValue(const T &value) {
+        appendNumber("%lld", static_cast<long long>(value));
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+    appendValue(const T &value) {
+        appendNumber("%llu", static_cast<unsigned long long>(value));
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    appendValue(const T &value) {
+        appendNumber("%g", static_cast<double>(value));
+    }
+
+    template<typename T>
+    typename std::enable_if<!std::is_arithmetic<T>::value>::type
+    appendValue(const T &value) {
+        std::ostringstream &stream = scratch();
+        stream.str(std::string());
+        stream << value;
+        const std::string text = stream.str();
+        logger.append(text.data(), text.size());
+    }
+
+public:
+
+    explicit Log(AsyncLogger &logger) : logger(logger) {
+    }
+
+    template<typename T>
+    Log &operator<<(const T &value) {
+        appendValue(value);
+        return *this;
+    }
+
+    Log &operator<<(const char *text) {
+        logger.append(text);
+        return *this;
+    }
+
+    Log &operator<<(const std::string &text) {
+        logger.append(text.data(), text.size());
+        return *this;
+    }
+
+    Log &operator<<(char character) {
+        logger.append(&character, 1);
+        return *this;
+    }
+
+    Log &operator<<(bool value) {
+        logger.append(value ? "1" : "0", 1);
+        return *this;
+    }
+
+    /* Needed for handling endl. The other manipulators are applied to a scratch stream. */
+    Log &operator<<(std::ostream &(*pf)(std::ostream &)) {
+        if (pf == static_cast<std::ostream &(*)(std::ostream &)>(std::endl)) {
+            logger.endLine();
+        } else {
+            std::ostringstream &stream = scratch();
+            stream.str(std::string());
+            stream << pf;
+            const std::string text = stream.str();
+            logger.append(text.data(), text.size());
+        }
+        return *this;
+    }
+};
+
+/**
+ * An Ipopt journal that writes to an AsyncLogger, so Ipopt's output costs the solver a copy instead of a write.
+ */
+class LogJournal : public Ipopt::Journal {
+private:
+
+    AsyncLogger &logger;
+
+protected:
+
+    void PrintImpl(Ipopt::EJournalCategory category, Ipopt::EJournalLevel level, const char *str) override {
+        logger.append(str);
+    }
+
+    void PrintfImpl(Ipopt::EJournalCategory category, Ipopt::EJournalLevel level,
+                    const char *pformat, va_list ap) override {
+        char text[1024];
+        const int size = std::vsnprintf(text, sizeof(text), pformat, ap);
+        if (size > 0)
+            logger.append(text, std::min(static_cast<size_t>(size), sizeof(text) - 1));
+    }
+
+    void FlushBufferImpl() override {
+    }
+
+public:
+
+    LogJournal(const std::string &name, Ipopt::EJournalLevel level, AsyncLogger &logger)
+            : Ipopt::Journal(name, level), logger(logger) {
+    }
+};
+
+/**
+ * Send the output of an initialized application to the logger at its print_level,
+ * and silence the console journal, which would format the same output again.
+ */
+inline void attachLogJournal(Ipopt::IpoptApplication &app, AsyncLogger &logger) {
+    Ipopt::Index print_level = 5;
+    app.Options()->GetIntegerValue("print_level", print_level, "");
+    Ipopt::SmartPtr<Ipopt::Journal> console = app.Jnlst()->GetJournal("console");
+    if (Ipopt::IsValid(console))
+        console->SetAllPrintLevels(Ipopt::J_NONE);
+    app.Jnlst()->AddJournal(new LogJournal("async_log", static_cast<Ipopt::EJournalLevel>(print_level), logger));
+}
+
+#endif /* ASYNC_LOG_HEADER */
@@ -0,0 +1,83 @@
+#include "batch_solver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <numeric>
+
+namespace {
+
+using Clock = SolveControl::Clock;
+
+double secondsBetween(Clock::time_point start, Clock::time_point finish) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count() / 1e9;
+}
+
+}
+
+std::vector<BatchResult> solveBatch(const std::vector<BatchProblem> &problems,
+                                    WorkStealingPool &pool,
+                                    const TrajectorySolver &solver) {
+
+    const Clock::time_point start = Clock::now();
+    std::vector<BatchResult> results(problems.size());
+
+    /* The tasks are not bound to problems. Whichever task a worker runs, or steals, takes the problem with the
+     * earliest deadline that no other task has taken yet, so the whole batch is served earliest deadline first. */
+    auto limit = [&problems](size_t i) {
+        return problems[i].time_limit > 0 ? problems[i].time_limit : std::numeric_limits<double>::infinity();
+    };
+    std::vector<size_t> order(problems.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&limit](size_t a, size_t b) { return limit(a) < limit(b); });
+    std::atomic<size_t> next{0};
+
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining = problems.size();
+
+    for (size_t k = 0; k < problems.size(); ++k) {
+        pool.submit([&] {
+            const size_t i = order[next++];
+            const BatchProblem &batch_problem = problems[i];
+            BatchResult &result = results[i];
+
+            SolveControl control;
+            if (batch_problem.time_limit > 0)
+                control.setDeadline(start + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(batch_problem.time_limit)));
+
+            const Clock::time_point taken = Clock::now();
+            result.queue_seconds = secondsBetween(start, taken);
+            result.worker = pool.workerIndex();
+            if (taken < control.getDeadline()) {
+                result.started = true;
+
+                /* An exception must not escape the worker, and the batch still waits for this problem */
+                try {
+                    result.solution = solver(batch_problem.problem, batch_problem.n_c, batch_problem.options,
+                                             &control);
+                } catch (const std::exception &exception) {
+                    result.error = exception.what();
+                } catch (...) {
+                    result.error = "unknown exception";
+                }
+                result.expired = control.hasExpired();
+                result.iterations = control.getIterations();
+                result.solve_seconds = secondsBetween(taken, Clock::now());
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0)
+                done.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&remaining] { return remaining == 0; });
+    return results;
+}
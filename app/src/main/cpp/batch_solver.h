@@ -0,0 +1,63 @@
+#ifndef BATCH_SOLVER_HEADER
+#define BATCH_SOLVER_HEADER
+
+#include <string>
+#include <vector>
+#include "trajectory_solver.h"
+#include "work_stealing_pool.h"
+
+/** One problem of a batch, with the discretization and Ipopt options to solve it with */
+struct BatchProblem {
+
+    QuadrotorProblem problem;
+
+    /** The number of collocation points of each waypoint */
+    size_t n_c = 11;
+
+    /** The Ipopt options, in the format of CppAD::ipopt::solve */
+    std::string options;
+
+    /** The time allowed for this problem, in seconds from the start of the batch. Zero means no limit. */
+    double time_limit = 0;
+};
+
+/** The solution of one problem of a batch, and how it was solved */
+struct BatchResult {
+
+    QuadrotorSolution solution;
+
+    /** False if the deadline passed before a worker took the problem, so it was never solved */
+    bool started = false;
+
+    /** True if the solve was stopped at its deadline */
+    bool expired = false;
+
+    /** The number of Ipopt iterations */
+    int iterations = 0;
+
+    /** The time from the start of the batch until a worker took the problem, and the time that the solve took */
+    double queue_seconds = 0;
+    double solve_seconds = 0;
+
+    /** The index of the worker of the pool that solved the problem */
+    size_t worker = 0;
+
+    /** What the solve threw, if it threw. The solution is then left as it was. */
+    std::string error;
+};
+
+/**
+ * Solve every problem on the workers of the pool, and return the results in the same order. Each solve runs
+ * on a single worker, with its own CppAD tape and Ipopt application, so the throughput scales with the number
+ * of workers as long as the linear solver is reentrant (the MUMPS that ships with Ipopt 3.12 is not,
+ * so use one of the HSL solvers through the "linear_solver" option when the pool has more than one worker).
+ *
+ * The problems with the earliest deadlines are taken first. This blocks until every problem was solved
+ * or skipped. Do not call it from a worker of the same pool. Debug builds need a pool that was prepared by
+ * solving one problem of each size sequentially (see CppADThreads).
+ */
+std::vector<BatchResult> solveBatch(const std::vector<BatchProblem> &problems,
+                                    WorkStealingPool &pool,
+                                    const TrajectorySolver &solver = solveTrajectory);
+
+#endif /* BATCH_SOLVER_HEADER */
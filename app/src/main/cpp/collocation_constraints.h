@@ -1,6 +1,7 @@
 #ifndef COLLOCATION_CONSTRAINTS_HEADER
 #define COLLOCATION_CONSTRAINTS_HEADER
 
+#include "derivative_demand.h"
 #include "variable_getter.h"
 #include "Eigen/Dense"
 #include "equality_constraint.h"
@@ -12,21 +13,27 @@
  * This gives us (n_x + n_u) * (n_w-1) conditions that must be checked.
  * Note that we have (n_w-1) here because we don't have redundant
  * estimates at the initial time.
+ *
+ * When the layout shares the boundary nodes (see SharedVariableGetter), these
+ * conditions hold trivially and this class should be left out of the fused constraint.
  */
-template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
 struct CollocationConstraints
     : EqualityConstraint<
         CollocationConstraints<
-            Scalar, Index, n_x, n_u, n_c, n_w>, Scalar, Index, (n_x + n_u) * (n_w - 1)> {
+            Scalar, Index, n_x, n_u, n_c, n_w, Getter>, Scalar, Index, (n_x + n_u) * (n_w - 1)> {
 
 private:
 
-    using Get = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Get = Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
     using Map = Eigen::Map<Eigen::Matrix<Scalar, n_x + n_u, n_w - 1 >>;
 
 public:
 
     static const Index derivatives = 0;
+    static const unsigned derivative_rows = NoRows;
+    static const unsigned derivative_columns = NoColumns;
 
     /** Evaluate the constraint at x and store the values in g.
      * Then return a pointer to g + n_constraints. */
@@ -43,6 +50,23 @@ public:
         G = c_0.template rightCols<n_w - 1>() - c_end.template leftCols<n_w - 1>();
         return g + this->n_constraints;
     }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return i_w == 0 ? 0 : (n_x + n_u) * (i_w - 1);
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Waypoint i_w > 0 compares its first collocation point with the last one of waypoint i_w-1,
+     * and waypoint 0 has no rows. Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        if (i_w == 0)
+            return g;
+        Eigen::Map<Eigen::Matrix<Scalar, n_x + n_u, 1>> G(g);
+        G = Get::varsAtWaypoint(x, i_w).col(0) - Get::varsAtWaypoint(x, i_w - 1).col(n_c - 1);
+        return g + n_x + n_u;
+    }
 };
 
 #endif /* COLLOCATION_CONSTRAINTS_HEADER */
\ No newline at end of file
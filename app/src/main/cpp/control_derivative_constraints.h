@@ -0,0 +1,78 @@
+#ifndef CONTROL_DERIVATIVE_CONSTRAINTS_HEADER
+#define CONTROL_DERIVATIVE_CONSTRAINTS_HEADER
+
+#include "derivative_demand.h"
+#include "variable_getter.h"
+#include "Eigen/Dense"
+#include "ranged_constraint.h"
+
+/**
+ * This set of constraints ensures that the derivatives of the specified degree of the controls lie
+ * within the specified bounds, that is,
+ *
+ * lower_bound <= d^degree u / dt^degree <= upper_bound
+ *
+ * The thrust and the attitude set the acceleration of the vehicle, so degree = 1 bounds the jerk
+ * (this is the same as the ControlRateConstraints) and degree = 2 bounds the snap. Use an infinite
+ * bound (for example, +/-1e19 for Ipopt) to leave a control free.
+ *
+ * Like the ControlRateConstraints, this yields n_u * n_c * n_w constraints.
+*/
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w, Index degree,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
+struct ControlDerivativeConstraints
+        : RangedConstraint<
+                ControlDerivativeConstraints<
+                        Scalar, Index, n_x, n_u, n_c, n_w, degree, Getter>, Scalar, Index, n_u * n_w * n_c, n_u> {
+
+private:
+
+    static_assert(degree >= 1, "The derivative degree must be at least 1");
+
+    using Base = RangedConstraint<ControlDerivativeConstraints, Scalar, Index, n_u * n_w * n_c, n_u>;
+    /* The derivatives are always stored waypoint by waypoint, regardless of the layout of x */
+    using DGet = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_u, n_c>>;
+
+public:
+
+    static const Index derivatives = degree;
+    static const unsigned derivative_rows = ControlRows;
+    static const unsigned derivative_columns = AllColumns;
+
+    template<typename Bound>
+    ControlDerivativeConstraints(const Bound &lower_bound,
+                                 const Bound &upper_bound)
+            : Base(lower_bound, upper_bound) {
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+
+        const Scalar *dx = lagrange_derivatives.template get<degree>();
+        for (Index i_w = 0; i_w < n_w; ++i_w) {
+            Map G(g);
+            G = DGet::controlsAtWaypoint(dx, i_w);
+            g += n_u * n_c;
+        }
+        return g;
+    }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return n_u * n_c * i_w;
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        Map G(g);
+        G = DGet::controlsAtWaypoint(lagrange_derivatives.template get<degree>(), i_w);
+        return g + n_u * n_c;
+    }
+};
+
+#endif /* CONTROL_DERIVATIVE_CONSTRAINTS_HEADER */
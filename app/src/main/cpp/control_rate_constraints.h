@@ -1,47 +1,43 @@
 #ifndef CONTROL_RATE_CONSTRAINTS_HEADER
 #define CONTROL_RATE_CONSTRAINTS_HEADER
 
+#include "derivative_demand.h"
 #include "variable_getter.h"
 #include "Eigen/Dense"
-#include "inequality_constraint.h"
+#include "ranged_constraint.h"
 
 /**
  * This set of constraints simply ensures that control rates lie within the specified bounds, that is,
  *
  * lower_bound <= u_dot <= upper_bound
  *
- * In general, an inequality bound is true if it is negative. So we reformulate the above to
- * the two bounds
- *
- * u_dot - upper_bound <= 0
- * lower_bound - u_dot <= 0
- *
- * @tparam Scalar: Only used to construct the lower and upper bounds.
- * @tparam n_constraints
+ * Since this is a ranged constraint, we simply write u_dot to g and let the solver enforce
+ * both bounds on the same row. This yields n_u * n_c * n_w constraints.
 */
-template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
 struct ControlRateConstraints
-        : InequalityConstraint<
+        : RangedConstraint<
                 ControlRateConstraints<
-                        Scalar, Index, n_x, n_u, n_c, n_w>, Scalar, Index, 2 * n_u * n_w * n_c> {
+                        Scalar, Index, n_x, n_u, n_c, n_w, Getter>, Scalar, Index, n_u * n_w * n_c, n_u> {
 
 private:
 
-    const Eigen::Matrix<Scalar, n_u, 1> lower_bound;
-    const Eigen::Matrix<Scalar, n_u, 1> upper_bound;
-
-    using Get = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Base = RangedConstraint<ControlRateConstraints, Scalar, Index, n_u * n_w * n_c, n_u>;
+    /* The derivatives are always stored waypoint by waypoint, regardless of the layout of x */
+    using DGet = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
     using Map = Eigen::Map<Eigen::Matrix<Scalar, n_u, n_c>>;
 
 public:
 
     static const Index derivatives = 1;
+    static const unsigned derivative_rows = ControlRows;
+    static const unsigned derivative_columns = AllColumns;
 
     template<typename Bound>
     ControlRateConstraints(const Bound &lower_bound,
                            const Bound &upper_bound)
-            : lower_bound(lower_bound.template cast<Scalar>()),
-              upper_bound(upper_bound.template cast<Scalar>()) {
+            : Base(lower_bound, upper_bound) {
     }
 
     /** Evaluate the constraint at x and store the values in g.
@@ -51,17 +47,26 @@ public:
 
         const Scalar *dx = lagrange_derivatives.template get<1>();
         for (Index i_w = 0; i_w < n_w; ++i_w) {
-
-            Map upper(g);
-            upper = Get::controlsAtWaypoint(dx, i_w).colwise() - upper_bound;
-            g += n_u * n_c;
-
-            Map lower(g);
-            lower = (-Get::controlsAtWaypoint(dx, i_w)).colwise() + lower_bound;
+            Map G(g);
+            G = DGet::controlsAtWaypoint(dx, i_w);
             g += n_u * n_c;
         }
         return g;
     }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return n_u * n_c * i_w;
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        Map G(g);
+        G = DGet::controlsAtWaypoint(lagrange_derivatives.template get<1>(), i_w);
+        return g + n_u * n_c;
+    }
 };
 
 #endif /* CONTROL_RATE_CONSTRAINTS_HEADER */
\ No newline at end of file
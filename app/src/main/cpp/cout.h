@@ -13,41 +13,28 @@ using std::endl;
 
 #include <jni.h>
 #include <android/log.h>
-#include <sstream>
+#include "async_log.h"
 
 #define LOG_TAG "Solution Info"
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 
-class Log {
-private:
-
-    template<typename T>
-    std::string to_string(T value) {
-        std::ostringstream os;
-        os << value;
-        return os.str();
-    }
-
-public:
-
-    Log() {};
-
-    template<typename T>
-    Log &operator<<(const T &value) {
-        LOGE("%s", to_string(value).c_str());
-        return *this;
-    }
-
-    /* Needed for handling endl */
-    Log &operator<<(std::ostream &(*pf)(std::ostream &)) {
-        LOGE("%s", to_string(pf).c_str());
-        return *this;
-    }
-};
-
-Log cout;
-//using std::cout;
+/**
+ * The logger behind cout. Each line becomes one record in the error log, and Ipopt's output
+ * goes to the same place (see attachLogJournal).
+ */
+inline AsyncLogger &androidLogger() {
+    static AsyncLogger logger;
+    static const bool installed = [] {
+        logger.addSink(std::unique_ptr<LogSink>(new LogcatSink(LOG_TAG, ANDROID_LOG_ERROR)));
+        AsyncLogger::ipoptLogger() = &logger;
+        return true;
+    }();
+    (void) installed;
+    return logger;
+}
+
+static Log cout(androidLogger());
 
 #else
 
@@ -0,0 +1,53 @@
+#ifndef DERIVATIVE_DEMAND_HEADER
+#define DERIVATIVE_DEMAND_HEADER
+
+#include <cstddef>
+
+/*
+ * Each constraint class declares which parts of the Lagrange derivatives it reads, next to the
+ * number of derivatives that it needs:
+ *
+ * static const Index derivatives = 1;
+ * static const unsigned derivative_rows = ControlRows;
+ * static const unsigned derivative_columns = BoundaryColumns;
+ *
+ * means that the class reads the first derivatives of the controls at the first and the last
+ * collocation points of each waypoint. A class only reads the derivative of degree "derivatives".
+ * The FusedConstraint collects these declarations at compile time
+ * and hands them to the LagrangeDerivatives as a demand (see FullDerivativeDemand), so that only the
+ * derivatives that somebody reads are computed.
+ */
+
+/** The rows of the derivatives, as a bit mask */
+enum DerivativeRows : unsigned {
+    NoRows = 0,
+    StateRows = 1,
+    ControlRows = 2,
+    AllRows = StateRows | ControlRows
+};
+
+/** The collocation points (columns) of the derivatives within each waypoint, as a bit mask */
+enum DerivativeColumns : unsigned {
+    NoColumns = 0,
+    FirstColumn = 1,
+    LastColumn = 2,
+    InteriorColumns = 4,
+    BoundaryColumns = FirstColumn | LastColumn,
+    AllColumns = FirstColumn | LastColumn | InteriorColumns
+};
+
+/**
+ * A demand returns the columns of the derivative of the specified degree that must be computed for
+ * the specified rows (either StateRows or ControlRows). This one computes everything.
+ *
+ * Since the LagrangeDerivatives compute every degree straight from x, the degrees do not depend
+ * on each other, so a demand only needs to list what is actually read.
+ */
+struct FullDerivativeDemand {
+
+    static constexpr unsigned columns(std::size_t degree, unsigned rows) {
+        return AllColumns;
+    }
+};
+
+#endif /* DERIVATIVE_DEMAND_HEADER */
@@ -1,9 +1,11 @@
 #ifndef DYNAMICS_CONSTRAINTS_HEADER
 #define DYNAMICS_CONSTRAINTS_HEADER
 
+#include "derivative_demand.h"
 #include "variable_getter.h"
 #include "Eigen/Dense"
 #include "equality_constraint.h"
+#include "quadrotor_dynamics.h"
 
 /**
  * This set of constraints simply ensures that the dynamics are actually satisfied,
@@ -11,47 +13,41 @@
  * equal the actual dynamics. These should hold at every collocation and waypoint for
  * each state variables, yielding n_c * n_x * n_w constraints.
  */
-template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
 struct DynamicsConstraints
     : EqualityConstraint<
         DynamicsConstraints<
-            Scalar, Index, n_x, n_u, n_c, n_w>, Scalar, Index, n_c * n_x * n_w> {
+            Scalar, Index, n_x, n_u, n_c, n_w, Getter>, Scalar, Index, n_c * n_x * n_w> {
 
 private:
 
-    using Get = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Get = Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
+
+    /* The derivatives are always stored waypoint by waypoint, regardless of the layout of x */
+    using DGet = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
     using Map = Eigen::Map<Eigen::Matrix<Scalar, n_x, n_c >>;
 
-    const Scalar mass = 1.0;
-    const Scalar gravity = 9.81;
-    const Scalar mass_gravity = mass * gravity;
+    const QuadrotorDynamics<Scalar> model;
 
 public:
 
     static const Index derivatives = 1;
+    static const unsigned derivative_rows = StateRows;
+    static const unsigned derivative_columns = AllColumns;
 
     /**
-     * The dynamics have the state vector
-     *
-     * x = [ px, py, pz, vx, vy, vz  ]
+     * Evaluate the dynamics at every collocation point of the specified waypoint,
+     * and store the n_x x n_c matrix of state derivatives in dx.
+     * See QuadrotorDynamics for the definition of the states and controls.
      */
     void dynamics(const Scalar *x, Scalar *dx, Index waypoint_index) const {
 
         static_assert(n_x == 6, "This function is only valid for states of size 6");
         static_assert(n_u == 4, "This function is only valid for controls of size 4");
 
-        Eigen::Ref<const Eigen::Matrix<Scalar, n_u, n_c>>
-            u = Get::controlsAtWaypoint(x, waypoint_index);
-        auto thrust = u.row(0).array();
-        auto phi = u.row(1).array();
-        auto theta = u.row(2).array();
-        auto psi = u.row(3).array();
-
         Eigen::Map<Eigen::Matrix<Scalar, n_x, n_c >> dX(dx);
-        dX.topRows(3) = Get::statesAtWaypoint(x, waypoint_index).bottomRows(3).eval();
-        dX.row(3) = -thrust * (sin(phi) * sin(psi) + cos(phi) * cos(psi) * sin(theta));
-        dX.row(4) = thrust * (cos(psi) * sin(phi) - cos(phi) * sin(psi) * sin(theta));
-        dX.row(5) = -thrust * cos(phi) * cos(theta) + mass_gravity;
+        model(Get::statesAtWaypoint(x, waypoint_index), Get::controlsAtWaypoint(x, waypoint_index), dX);
     }
 
     /** Evaluate the constraint at x and store the values in g.
@@ -64,11 +60,26 @@ public:
         for (Index i_w = 0; i_w < n_w; ++i_w) {
             dynamics(x, g, i_w);
             Map G(g);
-            G -= Get::statesAtWaypoint(dx, i_w);
+            G -= DGet::statesAtWaypoint(dx, i_w);
             g += n_x * n_c;
         }
         return g;
     }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return n_x * n_c * i_w;
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        dynamics(x, g, i_w);
+        Map G(g);
+        G -= DGet::statesAtWaypoint(lagrange_derivatives.template get<1>(), i_w);
+        return g + n_x * n_c;
+    }
 };
 
 #endif /* DYNAMICS_CONSTRAINTS_HEADER */
\ No newline at end of file
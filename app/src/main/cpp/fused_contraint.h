@@ -2,9 +2,26 @@
 #define FUSED_CONSTRAINT_HEADER
 
 #include <tuple>
+#include <type_traits>
+#include "derivative_demand.h"
 #include "lagrange_derivatives.h"
+#include "storage.h"
 #include "template_integer.h"
 
+/**
+ * The order in which the FusedConstraint evaluates its constraints.
+ *
+ * ClassMajor calls each constraint class in turn, and each one loops over all of the waypoints.
+ * WaypointMajor loops over the waypoints, generates the derivatives of one waypoint at a time, and asks
+ * every constraint class for the rows of that waypoint while its variables and derivatives are still in cache.
+ * Every class keeps its own block of rows in both orders, so the constraint vector and its sparsity
+ * structure are the same.
+ */
+enum class EvaluationOrder {
+    ClassMajor,
+    WaypointMajor
+};
+
 /**
  *
  * @tparam Tuple
@@ -19,8 +36,16 @@
  *
  * Array<n_constraints> bound = ...
  *
+ * @tparam Getter The layout of the variables, for example, VariableGetter or SharedVariableGetter.
+ * This must match the layout used by the constraints in the tuple.
+ * @tparam Storage Whether the bounds and the derivatives are stored inline or on the heap, see storage.h.
+ * The bounds have the scalar type of the Array.
+ * @tparam order Whether the constraints are evaluated class by class or waypoint by waypoint, see EvaluationOrder.
+ * Waypoint by waypoint requires every constraint class to implement waypointOffset and evaluateWaypoint.
  */
-template<typename Tuple, typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w, template<Index size> class Array>
+template<typename Tuple, typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w, template<Index size> class Array,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter, typename Storage = AutoStorage<>,
+    EvaluationOrder order = EvaluationOrder::ClassMajor>
 struct FusedConstraint {
 
 private:
@@ -59,6 +84,46 @@ private:
                ? std::tuple_element<i, Tuple>::type::derivatives : maxDerivative(Integer<i - 1>());
     }
 
+    /*
+     * ------------------------------------
+     *
+     * Offset of the rows of each constraint class
+     *
+     * ------------------------------------
+     */
+    static constexpr Index constraintOffset(Integer<0>) {
+        return 0;
+    }
+
+    template<Index i>
+    static constexpr Index constraintOffset(Integer<i>) {
+        return std::tuple_element<i - 1, Tuple>::type::n_constraints + constraintOffset(Integer<i - 1>());
+    }
+
+    /*
+     * ------------------------------------
+     *
+     * Derivatives read by the constraints
+     *
+     * ------------------------------------
+     */
+    /** The columns of the derivative of the specified degree that the Constraint needs for the specified rows */
+    template<typename Constraint>
+    static constexpr unsigned constraintColumns(std::size_t degree, unsigned rows) {
+        return (Constraint::derivative_rows & rows) && Constraint::derivatives == degree
+               ? +Constraint::derivative_columns : +NoColumns;
+    }
+
+    static constexpr unsigned derivativeColumns(std::size_t degree, unsigned rows, Integer<0>) {
+        return constraintColumns<typename std::tuple_element<0, Tuple>::type>(degree, rows);
+    }
+
+    template<Index i>
+    static constexpr unsigned derivativeColumns(std::size_t degree, unsigned rows, Integer<i>) {
+        return constraintColumns<typename std::tuple_element<i, Tuple>::type>(degree, rows)
+               | derivativeColumns(degree, rows, Integer<i - 1>());
+    }
+
 public:
 
     /** The number of constraint classes that are fused together */
@@ -73,6 +138,8 @@ public:
 
     using ArrayScalar =typename Array<n_constraints>::Scalar;
 
+    using Bound = typename Storage::template Matrix<ArrayScalar, n_constraints, 1>;
+
 private:
 
     /*
@@ -82,19 +149,24 @@ private:
      *
      * ------------------------------------
      */
-    static constexpr ArrayScalar *fillUpperBound(ArrayScalar *bound, Integer<n_constraint_classes - 1>) {
-        return std::tuple_element<n_constraint_classes - 1, Tuple>::type::template writeUpperBound<ArrayScalar>(bound);
+    static ArrayScalar *fillUpperBound(const Tuple &constraints,
+                                       ArrayScalar *bound,
+                                       Integer<n_constraint_classes - 1>) {
+        return std::get<n_constraint_classes - 1>(constraints).template writeUpperBound<ArrayScalar>(bound);
     }
 
     template<Index i>
-    static constexpr ArrayScalar *fillUpperBound(ArrayScalar *bound, Integer<i>) {
-        return fillUpperBound(std::tuple_element<i, Tuple>::type::template writeUpperBound<ArrayScalar>(bound),
+    static ArrayScalar *fillUpperBound(const Tuple &constraints, ArrayScalar *bound, Integer<i>) {
+        return fillUpperBound(constraints,
+                              std::get<i>(constraints).template writeUpperBound<ArrayScalar>(bound),
                               Integer<i + 1>());
     }
 
-    static Array<n_constraints> createUpperBound() {
-        Array<n_constraints> bound;
-        fillUpperBound(bound.data(), Integer<0>());
+    /** The bounds are written by the constraint instances since
+     * ranged constraints carry their bounds as data. */
+    static Bound createUpperBound(const Tuple &constraints) {
+        Bound bound = Bound::Zero(n_constraints);
+        fillUpperBound(constraints, bound.data(), Integer<0>());
         return bound;
     }
 
@@ -105,30 +177,42 @@ private:
      *
      * ------------------------------------
      */
-    static constexpr ArrayScalar *fillLowerBound(ArrayScalar *bound, Integer<n_constraint_classes - 1>) {
-        return std::tuple_element<n_constraint_classes - 1, Tuple>::type::template writeLowerBound<ArrayScalar>(bound);
+    static ArrayScalar *fillLowerBound(const Tuple &constraints,
+                                       ArrayScalar *bound,
+                                       Integer<n_constraint_classes - 1>) {
+        return std::get<n_constraint_classes - 1>(constraints).template writeLowerBound<ArrayScalar>(bound);
     }
 
     template<Index i>
-    static constexpr ArrayScalar *fillLowerBound(ArrayScalar *bound, Integer<i>) {
-        return fillLowerBound(std::tuple_element<i, Tuple>::type::template writeLowerBound<ArrayScalar>(bound),
+    static ArrayScalar *fillLowerBound(const Tuple &constraints, ArrayScalar *bound, Integer<i>) {
+        return fillLowerBound(constraints,
+                              std::get<i>(constraints).template writeLowerBound<ArrayScalar>(bound),
                               Integer<i + 1>());
     }
 
-    static Array<n_constraints> createLowerBound() {
-        Array<n_constraints> bound;
-        fillLowerBound(bound.data(), Integer<0>());
+    /** The bounds are written by the constraint instances since
+     * ranged constraints carry their bounds as data. */
+    static Bound createLowerBound(const Tuple &constraints) {
+        Bound bound = Bound::Zero(n_constraints);
+        fillLowerBound(constraints, bound.data(), Integer<0>());
         return bound;
     }
 
-    using LD = LagrangeDerivatives<Scalar, Index, n_x, n_u, n_c, n_w, max_derivative>;
+    /** The union of the derivatives read by the constraints, which are the only ones that we generate */
+    struct Demand {
+        static constexpr unsigned columns(std::size_t degree, unsigned rows) {
+            return derivativeColumns(degree, rows, Integer<n_constraint_classes - 1>());
+        }
+    };
+
+    using LD = LagrangeDerivatives<Scalar, Index, n_x, n_u, n_c, n_w, max_derivative, Getter, Storage, Demand>;
     LD lagrange_derivatives;
 
 public:
 
-    const Array<n_constraints> lower_bound = createLowerBound();
+    const Bound lower_bound;
 
-    const Array<n_constraints> upper_bound = createUpperBound();
+    const Bound upper_bound;
 
     /** A tuple of the constraint classes that we fuse together.
      * Note that we are referencing the passed-in constraints to avoid making copies */
@@ -138,15 +222,16 @@ public:
     template<typename CollocationPoints>
     FusedConstraint(const Tuple &constraints,
                     const CollocationPoints &collocation_points)
-            : constraints(constraints),
-              lagrange_derivatives(LD(collocation_points.template cast<Scalar>())) {
+            : lagrange_derivatives(collocation_points),
+              lower_bound(createLowerBound(constraints)),
+              upper_bound(createUpperBound(constraints)),
+              constraints(constraints) {
     }
 
     /** Evaluate the constraint at x and store the values in g.
      * Then return a pointer to g + n_constraints. */
     Scalar *operator()(Scalar *g, const Scalar *x) {
-        lagrange_derivatives.template generate<max_derivative>(x);
-        return evaluateConstraintsTuple(g, x, Integer<0>());
+        return evaluate(g, x, std::integral_constant<EvaluationOrder, order>());
     }
 
     /** Evaluate the constraint at x and store the values in g.
@@ -165,6 +250,21 @@ private:
      *
      * ------------------------------------
      */
+    /** Evaluate the constraint classes one after the other */
+    Scalar *evaluate(Scalar *g, const Scalar *x, std::integral_constant<EvaluationOrder, EvaluationOrder::ClassMajor>) {
+        lagrange_derivatives.template generate<max_derivative>(x);
+        return evaluateConstraintsTuple(g, x, Integer<0>());
+    }
+
+    /** Evaluate the waypoints one after the other */
+    Scalar *evaluate(Scalar *g, const Scalar *x, std::integral_constant<EvaluationOrder, EvaluationOrder::WaypointMajor>) {
+        for (Index i_w = 0; i_w < n_w; ++i_w) {
+            lagrange_derivatives.template generateAtWaypoint<max_derivative>(x, i_w);
+            evaluateWaypointTuple(g, x, i_w, Integer<0>());
+        }
+        return g + n_constraints;
+    }
+
     /** Evaluate the constraint at x and store the values in g.
      * Then return a pointer to g + n_constraints. */
     Scalar *evaluateConstraintsTuple(Scalar *g, const Scalar *x, Integer<n_constraint_classes - 1>) {
@@ -179,6 +279,21 @@ private:
                                         x,
                                         Integer<i + 1>());
     }
+
+    /** Evaluate the rows of waypoint i_w of every constraint class, where g points to the start
+     * of the constraint vector. */
+    void evaluateWaypointTuple(Scalar *g, const Scalar *x, Index i_w, Integer<n_constraint_classes>) {
+    }
+
+    template<Index i>
+    void evaluateWaypointTuple(Scalar *g, const Scalar *x, Index i_w, Integer<i>) {
+        using Constraint = typename std::tuple_element<i, Tuple>::type;
+        std::get<i>(constraints).evaluateWaypoint(g + constraintOffset(Integer<i>()) + Constraint::waypointOffset(i_w),
+                                                  x,
+                                                  lagrange_derivatives,
+                                                  i_w);
+        evaluateWaypointTuple(g, x, i_w, Integer<i + 1>());
+    }
 };
 
 #endif /* FUSED_CONSTRAINT_HEADER */
\ No newline at end of file
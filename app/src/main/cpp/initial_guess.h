@@ -0,0 +1,177 @@
+#ifndef INITIAL_GUESS_HEADER
+#define INITIAL_GUESS_HEADER
+
+#include <algorithm>
+#include <cmath>
+#include "Eigen/Dense"
+#include "quadrotor_dynamics.h"
+#include "runtime_variable_getter.h"
+#include "utils.h"
+
+/*
+ * A dynamically consistent initial guess, built in closed form:
+ *
+ * 1. Each waypoint gets the duration of a bang-coast-bang profile over the distance from the previous
+ *    waypoint, for the specified velocity and acceleration limits.
+ * 2. The position from one waypoint to the next follows the degree 7 polynomial that minimizes the snap,
+ *    with the positions and velocities of the waypoints, and zero acceleration and jerk at both ends.
+ * 3. The controls are recovered from the acceleration of the polynomial by inverting the quadrotor
+ *    dynamics, since the position is a flat output of the model (with the yaw fixed at 0).
+ */
+
+/**
+ * The duration of the fastest motion over the distance that starts and ends at rest, with
+ * |velocity| <= max_velocity and |acceleration| <= max_acceleration. The profile accelerates at
+ * max_acceleration, coasts at max_velocity, and decelerates at max_acceleration. If the distance is too
+ * short to reach max_velocity, there is no coasting phase.
+ */
+template<typename Scalar>
+Scalar bangCoastBangTime(Scalar distance, Scalar max_velocity, Scalar max_acceleration) {
+    if (distance * max_acceleration >= max_velocity * max_velocity)
+        return distance / max_velocity + max_velocity / max_acceleration;
+    return 2 * std::sqrt(distance / max_acceleration);
+}
+
+/**
+ * The minimum-snap polynomial between two waypoints, in the time s in [0, 1] scaled by the duration of the
+ * waypoint. Since the acceleration and jerk are zero at both ends, the 8 coefficients of each axis are
+ * a fixed linear combination of the positions and velocities at the ends.
+ */
+template<typename Scalar>
+class MinimumSnapSegment {
+private:
+
+    using Vector3 = Eigen::Matrix<Scalar, 3, 1>;
+
+    /** The coefficients of s^0, ..., s^7, one row per axis */
+    Eigen::Matrix<Scalar, 3, 8> coefficients;
+
+    const Scalar duration;
+
+    /** The inverse of the matrix that maps the coefficients to the derivatives 0 to 3 at s = 0 and s = 1.
+     * This is only computed once. */
+    static const Eigen::Matrix<double, 8, 8> &boundaryInverse() {
+        static const Eigen::Matrix<double, 8, 8> inverse = [] {
+            Eigen::Matrix<double, 8, 8> boundary = Eigen::Matrix<double, 8, 8>::Zero();
+            for (int k = 0; k < 4; ++k) {
+                for (int j = k; j < 8; ++j) {
+                    /* d^k/ds^k s^j = j! / (j-k)! s^(j-k) */
+                    double factor = 1;
+                    for (int i = 0; i < k; ++i)
+                        factor *= j - i;
+                    if (j == k)
+                        boundary(k, j) = factor;
+                    boundary(4 + k, j) = factor;
+                }
+            }
+            return Eigen::Matrix<double, 8, 8>(boundary.inverse());
+        }();
+        return inverse;
+    }
+
+    /** Evaluate the derivative of the specified degree with respect to s */
+    Vector3 evaluate(Scalar s, int degree) const {
+        Eigen::Matrix<Scalar, 8, 1> basis = Eigen::Matrix<Scalar, 8, 1>::Zero();
+        for (int j = degree; j < 8; ++j) {
+            Scalar factor = 1;
+            for (int i = 0; i < degree; ++i)
+                factor *= j - i;
+            basis(j) = factor * std::pow(s, j - degree);
+        }
+        return coefficients * basis;
+    }
+
+public:
+
+    MinimumSnapSegment(const Vector3 &initial_position, const Vector3 &initial_velocity,
+                       const Vector3 &final_position, const Vector3 &final_velocity,
+                       Scalar duration)
+        : duration(duration) {
+        const Eigen::Matrix<Scalar, 8, 8> inverse = boundaryInverse().template cast<Scalar>();
+        coefficients = initial_position * inverse.col(0).transpose()
+                       + duration * initial_velocity * inverse.col(1).transpose()
+                       + final_position * inverse.col(4).transpose()
+                       + duration * final_velocity * inverse.col(5).transpose();
+    }
+
+    Vector3 position(Scalar s) const {
+        return evaluate(s, 0);
+    }
+
+    Vector3 velocity(Scalar s) const {
+        return evaluate(s, 1) / duration;
+    }
+
+    Vector3 acceleration(Scalar s) const {
+        return evaluate(s, 2) / (duration * duration);
+    }
+};
+
+/**
+ * Invert the quadrotor dynamics (see QuadrotorDynamics) for the acceleration a, with the z axis pointing down
+ * and the yaw psi = 0. Then
+ *
+ * thrust = || (ax, ay, az - g) ||, phi = asin(ay / thrust), theta = atan2(-ax, g - az)
+ */
+template<typename Scalar>
+Eigen::Matrix<Scalar, 4, 1> flatControls(const Eigen::Matrix<Scalar, 3, 1> &acceleration) {
+    const Scalar gravity = QuadrotorDynamics<Scalar>().mass_gravity;
+    const Scalar thrust = Eigen::Matrix<Scalar, 3, 1>(
+        acceleration(0), acceleration(1), acceleration(2) - gravity).norm();
+    Eigen::Matrix<Scalar, 4, 1> controls;
+    controls << thrust,
+        thrust > 0 ? std::asin(acceleration(1) / thrust) : Scalar(0),
+        std::atan2(-acceleration(0), gravity - acceleration(2)),
+        0;
+    return controls;
+}
+
+/**
+ * Fill x, in the layout of the RuntimeVariableGetter, with the minimum-snap trajectory through the waypoints,
+ * starting from the initial state. The duration of each waypoint is the bang-coast-bang time for
+ * max_velocity and max_acceleration, clamped to [time_lower, time_upper]. If a waypoint is at the same
+ * position as the previous one, it gets fallback_time instead.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, typename Waypoints>
+void minimumSnapGuess(const Eigen::Matrix<Scalar, n_x, 1> &initial_state,
+                      const Waypoints &waypoints,
+                      Scalar max_velocity,
+                      Scalar max_acceleration,
+                      Scalar time_lower,
+                      Scalar time_upper,
+                      Scalar fallback_time,
+                      CollocationScheme scheme,
+                      const RuntimeVariableGetter<Scalar, Index, n_x, n_u> &get,
+                      Scalar *x) {
+
+    static_assert(n_x == 6, "This function is only valid for states of size 6");
+    static_assert(n_u == 4, "This function is only valid for controls of size 4");
+
+    using Vector3 = Eigen::Matrix<Scalar, 3, 1>;
+
+    get.setZero(x);
+    for (Index i_w = 0; i_w < Index(waypoints.cols()); ++i_w) {
+
+        const Eigen::Matrix<Scalar, n_x, 1> initial =
+            i_w == 0 ? initial_state : Eigen::Matrix<Scalar, n_x, 1>(waypoints.col(i_w - 1));
+        const Eigen::Matrix<Scalar, n_x, 1> final = waypoints.col(i_w);
+
+        const Scalar distance = (final.template head<3>() - initial.template head<3>()).norm();
+        Scalar duration = distance > 0 ? bangCoastBangTime(distance, max_velocity, max_acceleration) : fallback_time;
+        duration = std::min(std::max(duration, time_lower), time_upper);
+        get.times(x)(i_w) = duration;
+
+        const MinimumSnapSegment<Scalar> segment(initial.template head<3>(), initial.template tail<3>(),
+                                                 final.template head<3>(), final.template tail<3>(),
+                                                 duration);
+        const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> points = generateCollocationPoints<Scalar>(get.n_c(i_w), scheme);
+        auto states = get.statesAtWaypoint(x, i_w);
+        auto controls = get.controlsAtWaypoint(x, i_w);
+        for (Index i_c = 0; i_c < get.n_c(i_w); ++i_c) {
+            states.col(i_c) << segment.position(points(i_c)), segment.velocity(points(i_c));
+            controls.col(i_c) = flatControls(Vector3(segment.acceleration(points(i_c))));
+        }
+    }
+}
+
+#endif /* INITIAL_GUESS_HEADER */
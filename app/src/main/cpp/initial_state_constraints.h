@@ -1,6 +1,7 @@
 #ifndef INITIAL_STATE_CONSTRAINTS_HEADER
 #define INITIAL_STATE_CONSTRAINTS_HEADER
 
+#include "derivative_demand.h"
 #include "variable_getter.h"
 #include "Eigen/Dense"
 #include "equality_constraint.h"
@@ -10,15 +11,16 @@
  * estimate of the state at collocation point 0, waypoint 0 is
  * equal to the value of the initial state provided during construction of this constraint.
  */
-template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
 struct InitialStateConstraints
         : EqualityConstraint<
                 InitialStateConstraints<
-                        Scalar, Index, n_x, n_u, n_c, n_w>, Scalar, Index, n_x> {
+                        Scalar, Index, n_x, n_u, n_c, n_w, Getter>, Scalar, Index, n_x> {
 
 private:
 
-    using Get = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Get = Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
     using Map = Eigen::Map<Eigen::Matrix<Scalar, n_x, 1>>;
 
     const Eigen::Matrix<Scalar, n_x, 1> initial_state;
@@ -26,6 +28,8 @@ private:
 public:
 
     static const Index derivatives = 0;
+    static const unsigned derivative_rows = NoRows;
+    static const unsigned derivative_columns = NoColumns;
 
     template<typename InitialState>
     InitialStateConstraints(const InitialState &initial_state)
@@ -40,6 +44,18 @@ public:
         G = Get::state(x, 0, 0) - initial_state;
         return g + this->n_constraints;
     }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return 0;
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * All of the rows belong to waypoint 0. Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        return i_w == 0 ? (*this)(g, x, lagrange_derivatives) : g;
+    }
 };
 
 #endif /* COLLOCATION_CONSTRAINTS_HEADER */
\ No newline at end of file
@@ -0,0 +1,243 @@
+#ifndef INTERLEAVED_VARIABLE_GETTER_HEADER
+#define INTERLEAVED_VARIABLE_GETTER_HEADER
+
+/* iostream is just imported to get the endl operator. */
+#include <iostream>
+#include <sstream>
+#include "Eigen/Dense"
+
+using std::endl;
+
+/**
+ * This class provides the same accessors as the VariableGetter, but for a layout in which
+ * the time of each waypoint directly follows the states and controls of that waypoint.
+ * The variables sit in memory like this (in column-major format):
+ *
+ *            waypoint 1                              waypoint n_w
+ *    [ x[0], ..., x[n_c-1] ]                 [ x[0], ..., x[n_c-1] ]
+ *    [ u[0], ..., u[n_c-1] ], t_1, ..., [ u[0], ..., u[n_c-1] ], t_{n_w}
+ *
+ * Each time only couples to the constraints of its own waypoint, so this keeps every variable
+ * of a waypoint together and the Jacobian and Hessian of the problem banded, instead of
+ * appending n_w dense columns at the very end. The variables are also ordered by physical time.
+ *
+ * @tparam n_x: The size of the state
+ * @tparam n_u: The size of the control input
+ * @tparam n_c: The number of collocation points
+ * @tparam n_w: The number of waypoints
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+class InterleavedVariableGetter {
+private:
+
+    /** The number of variables of each waypoint, including its time */
+    static const Index n_block = (n_x + n_u) * n_c + 1;
+
+    /** The distance between the same collocation point of two adjacent waypoints */
+    using Stride = Eigen::OuterStride<n_block>;
+
+    /** The distance between the times of two adjacent waypoints */
+    using TimeStride = Eigen::InnerStride<n_block>;
+
+public:
+
+    static const Index n_vars = n_block * n_w;
+
+    /** Set all of the variables to zero */
+    static void setZero(Scalar *raw_ptr) {
+        Eigen::Map<Eigen::Matrix<Scalar, n_vars, 1>>(raw_ptr).setZero();
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ x[i,0], ..., x[i,n_w-1]]
+     * [ u[i,0], ..., u[i,n_w-1]]
+     *
+     * that is, a matrix of shape (n_x+n_u) x n_w,
+     * holding all of the states and controls at collocation point i_c.
+     */
+    static constexpr auto
+    varsAtCollocationPoint(const Scalar *raw_ptr, Index i_c)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, n_x + n_u, n_w>, Eigen::Unaligned, Stride>(raw_ptr)) {
+        return Eigen::Map<const Eigen::Matrix<Scalar, n_x + n_u, n_w>, Eigen::Unaligned, Stride>(
+            raw_ptr + (n_x + n_u) * i_c);
+    }
+
+    static constexpr auto
+    varsAtCollocationPoint(Scalar *raw_ptr, Index i_c)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, n_x + n_u, n_w>, Eigen::Unaligned, Stride>(raw_ptr)) {
+        return Eigen::Map<Eigen::Matrix<Scalar, n_x + n_u, n_w>, Eigen::Unaligned, Stride>(
+            raw_ptr + (n_x + n_u) * i_c);
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ x[i,0], ..., x[i,n_w-1]]
+     *
+     * that is, a matrix of shape n_x x n_w,
+     * holding all of the states at collocation point i_c.
+     */
+    static constexpr auto statesAtCollocationPoint(const Scalar *raw_ptr, Index i_c)
+    -> decltype(varsAtCollocationPoint(raw_ptr, i_c).template topRows<n_x>()) {
+        return varsAtCollocationPoint(raw_ptr, i_c).template topRows<n_x>();
+    }
+
+    static constexpr auto statesAtCollocationPoint(Scalar *raw_ptr, Index i_c)
+    -> decltype(varsAtCollocationPoint(raw_ptr, i_c).template topRows<n_x>()) {
+        return varsAtCollocationPoint(raw_ptr, i_c).template topRows<n_x>();
+    }
+
+    /** Return a reference to
+     *
+     * x[i,j]
+     *
+     * that is, a matrix of shape n_x x 1,
+     * holding the state at collocation point i_c and waypoint i_w.
+     */
+    static constexpr auto state(const Scalar *raw_ptr, Index i_c, Index i_w)
+    -> decltype(statesAtCollocationPoint(raw_ptr, i_c).col(i_w)) {
+        return statesAtCollocationPoint(raw_ptr, i_c).col(i_w);
+    }
+
+    static constexpr auto state(Scalar *raw_ptr, Index i_c, Index i_w)
+    -> decltype(statesAtCollocationPoint(raw_ptr, i_c).col(i_w)) {
+        return statesAtCollocationPoint(raw_ptr, i_c).col(i_w);
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ u[i,0], ..., u[i,n_w-1]]
+     *
+     * that is, a matrix of shape n_u x n_w,
+     * holding all of the controls at collocation point i_c.
+     */
+    static constexpr auto controlsAtCollocationPoint(const Scalar *raw_ptr, Index i_c)
+    -> decltype(varsAtCollocationPoint(raw_ptr, i_c).template bottomRows<n_u>()) {
+        return varsAtCollocationPoint(raw_ptr, i_c).template bottomRows<n_u>();
+    }
+
+    static constexpr auto controlsAtCollocationPoint(Scalar *raw_ptr, Index i_c)
+    -> decltype(varsAtCollocationPoint(raw_ptr, i_c).template bottomRows<n_u>()) {
+        return varsAtCollocationPoint(raw_ptr, i_c).template bottomRows<n_u>();
+    }
+
+    /** Return a reference to
+     *
+     * u[i,j]
+     *
+     * that is, a matrix of shape n_u x 1,
+     * holding all of the controls at collocation point i_c and waypoint i_w.
+     */
+    static constexpr auto control(const Scalar *raw_ptr, Index i_c, Index i_w)
+    -> decltype(controlsAtCollocationPoint(raw_ptr, i_c).col(i_w)) {
+        return controlsAtCollocationPoint(raw_ptr, i_c).col(i_w);
+    }
+
+    static constexpr auto control(Scalar *raw_ptr, Index i_c, Index i_w)
+    -> decltype(controlsAtCollocationPoint(raw_ptr, i_c).col(i_w)) {
+        return controlsAtCollocationPoint(raw_ptr, i_c).col(i_w);
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ x[0,i], ..., x[n_c-1,i]]
+     * [ u[0,i], ..., u[n_c-1,i]]
+     *
+     * that is, a matrix of shape (n_x + n_u) x n_c,
+     * holding all of the states and controls at waypoint i_w.
+     */
+    static constexpr auto varsAtWaypoint(const Scalar *raw_ptr, Index i_w)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, n_x + n_u, n_c>>(raw_ptr)) {
+        return Eigen::Map<const Eigen::Matrix<Scalar, n_x + n_u, n_c>>(raw_ptr + n_block * i_w);
+    }
+
+    static constexpr auto varsAtWaypoint(Scalar *raw_ptr, Index i_w)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, n_x + n_u, n_c>>(raw_ptr)) {
+        return Eigen::Map<Eigen::Matrix<Scalar, n_x + n_u, n_c>>(raw_ptr + n_block * i_w);
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ x[0,i], ..., x[n_c-1,i]]
+     *
+     * that is, a matrix of shape n_x x n_c,
+     * holding all of the states at waypoint i_w.
+     */
+    static constexpr auto statesAtWaypoint(const Scalar *raw_ptr, Index i_w)
+    -> decltype(varsAtWaypoint(raw_ptr, i_w).template topRows<n_x>()) {
+        return varsAtWaypoint(raw_ptr, i_w).template topRows<n_x>();
+    }
+
+    static constexpr auto statesAtWaypoint(Scalar *raw_ptr, Index i_w)
+    -> decltype(varsAtWaypoint(raw_ptr, i_w).template topRows<n_x>()) {
+        return varsAtWaypoint(raw_ptr, i_w).template topRows<n_x>();
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ u[0,i], ..., u[n_c-1,i]]
+     *
+     * that is, a matrix of shape n_u x n_c,
+     * holding all of the controls at waypoint i_w.
+     */
+    static constexpr auto controlsAtWaypoint(const Scalar *raw_ptr, Index i_w)
+    -> decltype(varsAtWaypoint(raw_ptr, i_w).template bottomRows<n_u>()) {
+        return varsAtWaypoint(raw_ptr, i_w).template bottomRows<n_u>();
+    }
+
+    static constexpr auto controlsAtWaypoint(Scalar *raw_ptr, Index i_w)
+    -> decltype(varsAtWaypoint(raw_ptr, i_w).template bottomRows<n_u>()) {
+        return varsAtWaypoint(raw_ptr, i_w).template bottomRows<n_u>();
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ t[0], ..., t[n_w-1]]
+     *
+     * that is, a matrix of shape 1 x n_w,
+     * holding all of the times.
+     */
+    static constexpr auto times(const Scalar *raw_ptr)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, 1, n_w>, Eigen::Unaligned, TimeStride>(raw_ptr)) {
+        return Eigen::Map<const Eigen::Matrix<Scalar, 1, n_w>, Eigen::Unaligned, TimeStride>(raw_ptr + n_block - 1);
+    }
+
+    static constexpr auto times(Scalar *raw_ptr)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, 1, n_w>, Eigen::Unaligned, TimeStride>(raw_ptr)) {
+        return Eigen::Map<Eigen::Matrix<Scalar, 1, n_w>, Eigen::Unaligned, TimeStride>(raw_ptr + n_block - 1);
+    }
+
+    /** Return a nice formatted string of all of the variables */
+    static std::string asString(const Scalar *raw_vars) {
+        std::stringstream out;
+
+        /* First, write the times to the string  */
+        out << endl;
+        out << endl;
+        out << "Times: " << times(raw_vars) << endl;
+
+        out << "----------------------------" << endl;
+        out << endl;
+        out << "Controls: " << endl;
+        out << endl;
+        for (Index i_c = 0; i_c < n_c; ++i_c) {
+            out << "Collocation point " << i_c << endl;
+            out << controlsAtCollocationPoint(raw_vars, i_c) << endl;
+        }
+        out << endl;
+        out << "----------------------------" << endl;
+
+        out << endl;
+        out << "States: " << endl;
+        out << endl;
+        for (Index i_c = 0; i_c < n_c; ++i_c) {
+            out << "Collocation point " << i_c << endl;
+            out << statesAtCollocationPoint(raw_vars, i_c) << endl;
+        }
+        out << endl;
+        out << "----------------------------" << endl;
+        return out.str();
+    }
+};
+
+#endif /* INTERLEAVED_VARIABLE_GETTER_HEADER */
@@ -0,0 +1,278 @@
+#ifndef INTERRUPTIBLE_SOLVE_HEADER
+#define INTERRUPTIBLE_SOLVE_HEADER
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+#include "cppad/ipopt/solve.hpp"
+#include "IpIpoptCalculatedQuantities.hpp"
+#include "IpIpoptData.hpp"
+#include "IpOrigIpoptNLP.hpp"
+#include "IpTNLPAdapter.hpp"
+#include "async_log.h"
+#include "iterate_stream.h"
+
+/** The state of a solve after one of its iterations */
+struct SolveProgress {
+    int iteration;
+    double objective;
+    double infeasibility;
+};
+
+/**
+ * This is shared between a solve and the threads that watch it. Ipopt checks it once per iteration,
+ * and stops with user_requested_stop once it is cancelled or past its deadline.
+ * It also counts the iterations and keeps the cost and constraint violation of the latest iterate,
+ * so the caller can report them or compare solves that were stopped early.
+ */
+class SolveControl {
+public:
+
+    using Clock = std::chrono::steady_clock;
+    using Progress = std::function<void(const SolveProgress &)>;
+
+private:
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> expired{false};
+    std::atomic<int> iterations{0};
+    std::atomic<double> objective{std::numeric_limits<double>::infinity()};
+    std::atomic<double> infeasibility{std::numeric_limits<double>::infinity()};
+    Clock::time_point deadline = Clock::time_point::max();
+    Progress progress;
+    IterateStream *stream = nullptr;
+
+public:
+
+    /** Stop the solve at its next iteration. This may be called from any thread. */
+    void cancel() {
+        cancelled = true;
+    }
+
+    bool isCancelled() const {
+        return cancelled;
+    }
+
+    /** Stop the solve at the first iteration after the deadline. Set this before the solve starts. */
+    void setDeadline(Clock::time_point time) {
+        deadline = time;
+    }
+
+    Clock::time_point getDeadline() const {
+        return deadline;
+    }
+
+    /** Call progress on the solving thread after every iteration. Set this before the solve starts. */
+    void setProgress(Progress callback) {
+        progress = std::move(callback);
+    }
+
+    /** Publish the iterates of the solve to stream (see iterate_stream.h). Set this before the solve starts. */
+    void setIterateStream(IterateStream *iterate_stream) {
+        stream = iterate_stream;
+    }
+
+    IterateStream *getIterateStream() const {
+        return stream;
+    }
+
+    /** True if the solve was stopped because it ran past its deadline */
+    bool hasExpired() const {
+        return expired;
+    }
+
+    /** The number of iterations that Ipopt has completed */
+    int getIterations() const {
+        return iterations;
+    }
+
+    /** The cost of the latest iterate, in the scaling of Ipopt */
+    double getObjective() const {
+        return objective;
+    }
+
+    /** The largest constraint violation of the latest iterate */
+    double getInfeasibility() const {
+        return infeasibility;
+    }
+
+    /** Called by Ipopt after every iteration. Return false to stop the solve. */
+    bool iterate(double objective_value, double primal_infeasibility) {
+        const int iteration = ++iterations;
+        objective = objective_value;
+        infeasibility = primal_infeasibility;
+        if (progress)
+            progress(SolveProgress{iteration, objective_value, primal_infeasibility});
+        if (cancelled)
+            return false;
+        if (deadline != Clock::time_point::max() && Clock::now() >= deadline) {
+            expired = true;
+            return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * Receives the iterates of a solve in the variables of the problem that was passed to solveInterruptible,
+ * which the caller maps back to its own layout. Only the iterates that the stream accepts are passed on.
+ */
+struct IterateHandler {
+    IterateStream *stream = nullptr;
+    std::function<void(const double *x, const SolveProgress &progress)> publish;
+};
+
+/**
+ * CppAD's interface from Ipopt to the problem, which also reports every iteration to a SolveControl,
+ * and passes the iterates to an IterateHandler if it has a stream.
+ */
+template<class Dvector, class ADvector, class FG_eval>
+class InterruptibleCallback : public CppAD::ipopt::solve_callback<Dvector, ADvector, FG_eval> {
+private:
+
+    using Base = CppAD::ipopt::solve_callback<Dvector, ADvector, FG_eval>;
+
+    SolveControl &control;
+    const IterateHandler &handler;
+
+    /** The current iterate, in the variables of the problem */
+    Dvector x;
+
+    /**
+     * Ipopt 3.12 has no get_curr_iterate, so take the iterate from its internal data. Ipopt may have removed the
+     * fixed variables and scaled the rest, and the TNLPAdapter undoes both. In the restoration phase, the
+     * problem is not the original one, so nothing is published.
+     */
+    void publish(Ipopt::AlgorithmMode mode,
+                 const SolveProgress &progress,
+                 const Ipopt::IpoptData *ip_data,
+                 Ipopt::IpoptCalculatedQuantities *ip_cq) {
+        if (!handler.stream || !handler.publish || mode != Ipopt::RegularMode || !ip_data || !ip_cq
+            || !handler.stream->accepts(progress.infeasibility))
+            return;
+        Ipopt::OrigIpoptNLP *original = dynamic_cast<Ipopt::OrigIpoptNLP *>(Ipopt::GetRawPtr(ip_cq->GetIpoptNLP()));
+        if (!original)
+            return;
+        Ipopt::TNLPAdapter *adapter = dynamic_cast<Ipopt::TNLPAdapter *>(Ipopt::GetRawPtr(original->nlp()));
+        if (!adapter)
+            return;
+        adapter->ResortX(*original->NLP_scaling()->unapply_vector_scaling_x(ip_data->curr()->x()), x.data());
+        handler.publish(x.data(), progress);
+    }
+
+public:
+
+    InterruptibleCallback(size_t nx, size_t ng,
+                          const Dvector &xi, const Dvector &xl, const Dvector &xu,
+                          const Dvector &gl, const Dvector &gu,
+                          FG_eval &fg_eval,
+                          bool retape, bool sparse_forward, bool sparse_reverse,
+                          CppAD::ipopt::solve_result<Dvector> &solution,
+                          SolveControl &control,
+                          const IterateHandler &handler)
+        : Base(1, nx, ng, xi, xl, xu, gl, gu, fg_eval, retape, sparse_forward, sparse_reverse, solution),
+          control(control),
+          handler(handler),
+          x(nx) {
+    }
+
+    virtual bool intermediate_callback(Ipopt::AlgorithmMode mode,
+                                       Ipopt::Index iter, Ipopt::Number obj_value,
+                                       Ipopt::Number inf_pr, Ipopt::Number inf_du,
+                                       Ipopt::Number mu, Ipopt::Number d_norm,
+                                       Ipopt::Number regularization_size,
+                                       Ipopt::Number alpha_du, Ipopt::Number alpha_pr,
+                                       Ipopt::Index ls_trials,
+                                       const Ipopt::IpoptData *ip_data,
+                                       Ipopt::IpoptCalculatedQuantities *ip_cq) {
+        const bool proceed = control.iterate(obj_value, inf_pr);
+        publish(mode, SolveProgress{control.getIterations(), obj_value, inf_pr}, ip_data, ip_cq);
+        return proceed;
+    }
+};
+
+/**
+ * Apply the options, in the format of CppAD::ipopt::solve, to the application, and return the
+ * Retape and Sparse settings. Return false if a line cannot be parsed.
+ */
+inline bool applyIpoptOptions(const std::string &options,
+                              Ipopt::IpoptApplication &app,
+                              bool &retape,
+                              bool &sparse_forward,
+                              bool &sparse_reverse) {
+    retape = false;
+    sparse_forward = false;
+    sparse_reverse = false;
+
+    std::istringstream lines(options);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream tokens(line);
+        std::string kind, name, value;
+        if (!(tokens >> kind))
+            continue;
+        if (!(tokens >> name))
+            return false;
+        if (kind == "Retape") {
+            retape = name == "true";
+            continue;
+        }
+        if (!(tokens >> value))
+            return false;
+        if (kind == "Sparse") {
+            sparse_forward = name == "true" && value == "forward";
+            sparse_reverse = name == "true" && value == "reverse";
+        } else if (kind == "String") {
+            app.Options()->SetStringValue(name, value);
+        } else if (kind == "Numeric") {
+            app.Options()->SetNumericValue(name, std::atof(value.c_str()));
+        } else if (kind == "Integer") {
+            app.Options()->SetIntegerValue(name, std::atoi(value.c_str()));
+        } else {
+            return false;
+        }
+    }
+    return !(retape && (sparse_forward || sparse_reverse));
+}
+
+/**
+ * The same as CppAD::ipopt::solve, but the solve can be cancelled or given a deadline through the control,
+ * and its iterates can be streamed through the handler.
+ * Ipopt 3.12 has no wall clock limit of its own (max_cpu_time counts the CPU time of the whole process,
+ * which is wrong once several solves run in parallel), so the deadline is checked in the intermediate callback.
+ */
+template<class Dvector, class FG_eval>
+void solveInterruptible(const std::string &options,
+                        const Dvector &xi,
+                        const Dvector &xl,
+                        const Dvector &xu,
+                        const Dvector &gl,
+                        const Dvector &gu,
+                        FG_eval &fg_eval,
+                        CppAD::ipopt::solve_result<Dvector> &solution,
+                        SolveControl &control,
+                        const IterateHandler &handler = IterateHandler()) {
+
+    using ADvector = typename FG_eval::ADvector;
+
+    Ipopt::SmartPtr<Ipopt::IpoptApplication> app = new Ipopt::IpoptApplication();
+    bool retape, sparse_forward, sparse_reverse;
+    if (!applyIpoptOptions(options, *app, retape, sparse_forward, sparse_reverse)
+        || app->Initialize() != Ipopt::Solve_Succeeded) {
+        solution.status = CppAD::ipopt::solve_result<Dvector>::unknown;
+        return;
+    }
+    if (AsyncLogger *logger = AsyncLogger::ipoptLogger())
+        attachLogJournal(*app, *logger);
+
+    Ipopt::SmartPtr<Ipopt::TNLP> nlp = new InterruptibleCallback<Dvector, ADvector, FG_eval>(
+        xi.size(), gl.size(), xi, xl, xu, gl, gu, fg_eval, retape, sparse_forward, sparse_reverse, solution, control,
+        handler);
+    app->OptimizeTNLP(nlp);
+}
+
+#endif /* INTERRUPTIBLE_SOLVE_HEADER */
@@ -0,0 +1,138 @@
+#ifndef ITERATE_STREAM_HEADER
+#define ITERATE_STREAM_HEADER
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "Eigen/Dense"
+
+/**
+ * A bounded lock-free queue between exactly one producer thread and one consumer thread.
+ * The elements are filled and read in place, so elements that own memory keep it from one use to the next,
+ * and the producer does not allocate once every slot has been used at the largest size.
+ */
+template<typename T>
+class SpscQueue {
+private:
+
+    std::vector<T> slots;
+    const size_t mask;
+
+    /** The next slot to write and to read. They sit on separate cache lines, so the two threads do not contend. */
+    char padding_0[64];
+    std::atomic<size_t> head{0};
+    char padding_1[64];
+    std::atomic<size_t> tail{0};
+    char padding_2[64];
+
+    static size_t roundUp(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+        return size;
+    }
+
+public:
+
+    /** Make room for capacity elements, rounded up to a power of two */
+    explicit SpscQueue(size_t capacity) : slots(roundUp(capacity)), mask(roundUp(capacity) - 1) {
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    size_t capacity() const {
+        return slots.size();
+    }
+
+    /** The slot that the producer may fill next, or nullptr if the queue is full */
+    T *producerSlot() {
+        const size_t position = head.load(std::memory_order_relaxed);
+        if (position - tail.load(std::memory_order_acquire) > mask)
+            return nullptr;
+        return &slots[position & mask];
+    }
+
+    /** Hand the slot from producerSlot to the consumer */
+    void publish() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** The oldest element that the consumer has not released, or nullptr if the queue is empty */
+    T *consumerSlot() {
+        const size_t position = tail.load(std::memory_order_relaxed);
+        if (position == head.load(std::memory_order_acquire))
+            return nullptr;
+        return &slots[position & mask];
+    }
+
+    /** Give the slot from consumerSlot back to the producer */
+    void release() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** Swap the oldest element into value. Return false if the queue is empty. */
+    bool tryPop(T &value) {
+        T *slot = consumerSlot();
+        if (!slot)
+            return false;
+        std::swap(*slot, value);
+        release();
+        return true;
+    }
+};
+
+/**
+ * An iterate of a solve, in the same layout as the solution (see TrajectorySolution), so it can be tracked
+ * as a provisional trajectory until the solve returns.
+ */
+struct TrajectoryIterate {
+    int iteration = 0;
+    double objective = 0;
+    /** The largest constraint violation */
+    double infeasibility = 0;
+    std::vector<size_t> node_counts;
+    Eigen::VectorXd x;
+};
+
+/**
+ * The iterates that a solve publishes from Ipopt's intermediate callback, for a consumer thread.
+ * Only the iterates whose constraint violation is at most max_infeasibility are published, and iterates
+ * are dropped, not waited for, when the consumer falls behind. The restoration phase is never published.
+ *
+ * The solver is the only producer, so a stream must not be shared by solves that run at the same time.
+ */
+class IterateStream : public SpscQueue<TrajectoryIterate> {
+private:
+
+    const double max_infeasibility;
+    std::atomic<size_t> dropped{0};
+
+public:
+
+    explicit IterateStream(size_t capacity = 8,
+                           double max_infeasibility = std::numeric_limits<double>::infinity())
+            : SpscQueue<TrajectoryIterate>(capacity), max_infeasibility(max_infeasibility) {
+    }
+
+    bool accepts(double infeasibility) const {
+        return infeasibility <= max_infeasibility;
+    }
+
+    /** The slot for the next iterate, or nullptr if the consumer has fallen behind, which is counted */
+    TrajectoryIterate *producerSlot() {
+        TrajectoryIterate *slot = SpscQueue<TrajectoryIterate>::producerSlot();
+        if (!slot)
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    /** The number of iterates that were dropped because the queue was full */
+    size_t getDropped() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+};
+
+#endif /* ITERATE_STREAM_HEADER */
@@ -1,28 +1,128 @@
 #ifndef LAGRANGE_DERIVATIVES_HEADER
 #define LAGRANGE_DERIVATIVES_HEADER
 
+#include "derivative_demand.h"
 #include "variable_getter.h"
+#include "storage.h"
+#include "template_integer.h"
 #include "Eigen/Dense"
 #include "utils.h"
 
-template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w, Index max_derivatives>
+/**
+ * This computes the time derivatives of the states and controls by differentiating the
+ * Lagrange interpolation polynomials of each waypoint.
+ *
+ * The k^th derivative of a waypoint with duration t is x * D^k * t^-k, where D is the differentiation
+ * matrix of the collocation points. The powers D^k are computed once, in double precision, so every
+ * derivative degree costs a single matrix product and is read straight from x rather than from the
+ * previous derivative.
+ *
+ * The variables x are read with the specified Getter, but the derivatives are always stored
+ * waypoint by waypoint in the VariableGetter layout, since the derivatives at a shared node
+ * differ depending on whether they are estimated from the left or from the right.
+ *
+ * The Storage policy (see storage.h) decides whether the derivatives are stored inline or on the heap.
+ *
+ * The Demand (see derivative_demand.h) decides which columns of the state and control rows are computed
+ * for each derivative degree. The other entries keep whatever they held before, so reading them is undefined.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w, Index max_derivatives,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter, typename Storage = AutoStorage<>,
+    typename Demand = FullDerivativeDemand>
 class LagrangeDerivatives {
 private:
 
-    using Get = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Get = Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using DGet = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
 
-    /** These are the coefficients used to generate the derivatives */
-    const Eigen::Matrix<Scalar, n_c, n_c> derivative_coefficients;
+    /* Keep at least one block, so that the fixed-size blocks below are valid when no constraint
+     * reads the derivatives (for example, the local transcriptions of local_dynamics_constraints.h) */
+    static constexpr Index n_powers = max_derivatives > 0 ? max_derivatives : 1;
+
+    using Powers = typename Storage::template Matrix<Scalar, n_c, n_c * n_powers>;
+
+    /** These are the coefficients used to generate the derivatives. The i^th block of n_c columns holds D^(i+1) */
+    const Powers derivative_coefficients;
+
+    using Derivatives = typename Storage::template Matrix<Scalar, DGet::n_vars, max_derivatives>;
 
     /** These are the derivatives. The i^th column holds the (i+1)^th derivatives */
-    Eigen::Matrix<Scalar, Get::n_vars, max_derivatives> derivatives;
+    Derivatives derivatives;
+
+    /** Compute D, D^2, ..., D^max_derivatives in double precision, and then cast them to Scalar */
+    template<typename CP>
+    static Powers createPowers(const CP &collocation_points) {
+        const Eigen::Matrix<double, n_c, n_c> coefficients =
+                lagrangeDerivativeCoefficients(collocation_points.template cast<double>());
+        Powers powers = Powers::Zero(n_c, n_c * n_powers);
+        Eigen::Matrix<double, n_c, n_c> power = coefficients;
+        for (Index i = 0; i < max_derivatives; ++i) {
+            powers.template middleCols<n_c>(n_c * i) = power.template cast<Scalar>();
+            power = (power * coefficients).eval();
+        }
+        return powers;
+    }
+
+    /** Differentiate the rows x of one waypoint with the coefficients D^k, scale the result by t^-k,
+     * but only store the specified columns in dx */
+    template<typename Source, typename Destination, typename Coefficients>
+    static void differentiate(const Source &x,
+                              Destination dx,
+                              const Coefficients &coefficients,
+                              unsigned columns,
+                              const Scalar &scale) {
+        if (columns == AllColumns) {
+            dx = x * coefficients * scale;
+            return;
+        }
+        if (columns & FirstColumn)
+            dx.col(0) = x * coefficients.col(0) * scale;
+        if (columns & InteriorColumns)
+            dx.template middleCols<n_c - 2>(1) = x * coefficients.template middleCols<n_c - 2>(1) * scale;
+        if (columns & LastColumn)
+            dx.col(n_c - 1) = x * coefficients.col(n_c - 1) * scale;
+    }
+
+    /** Differentiate waypoint i_w of x, and store the derivative of the specified degree in dx, where
+     * scale = t^-degree. If the Demand asks for everything, this is a single matrix product. */
+    void differentiateWaypoint(const Scalar *x, Scalar *dx, Index i_w, Index degree, const Scalar &scale) const {
+        const auto coefficients = derivative_coefficients.template middleCols<n_c>(n_c * (degree - 1));
+        const unsigned state_columns = Demand::columns(degree, StateRows);
+        const unsigned control_columns = Demand::columns(degree, ControlRows);
+        if (state_columns == AllColumns && control_columns == AllColumns) {
+            DGet::varsAtWaypoint(dx, i_w) = Get::varsAtWaypoint(x, i_w) * coefficients * scale;
+            return;
+        }
+        differentiate(Get::statesAtWaypoint(x, i_w), DGet::statesAtWaypoint(dx, i_w),
+                      coefficients, state_columns, scale);
+        differentiate(Get::controlsAtWaypoint(x, i_w), DGet::controlsAtWaypoint(dx, i_w),
+                      coefficients, control_columns, scale);
+    }
+
+    /** There is nothing to generate. This overload does not read the states or controls of x, so it also
+     * works with Getters that do not store them at every collocation point (see multiple_shooting.h) */
+    void generateAtWaypoint(const Scalar *x0, Index i_w, Integer<0>) {
+    }
+
+    template<size_t up_to_derivative>
+    void generateAtWaypoint(const Scalar *x0, Index i_w, Integer<up_to_derivative>) {
+
+        /* Every degree reads x in its own layout, so only the scale depends on the previous degree */
+        const Scalar inverse_time = Scalar(1) / Get::times(x0)(i_w);
+        Scalar scale = inverse_time;
+        for (Index i = 0; i < up_to_derivative; ++i) {
+            if (i > 0)
+                scale *= inverse_time;
+            differentiateWaypoint(x0, derivatives.col(i).data(), i_w, i + 1, scale);
+        }
+    }
 
 public:
 
     template<typename CP>
     LagrangeDerivatives(const CP &collocation_points)
-            : derivative_coefficients(lagrangeDerivativeCoefficients(collocation_points.template cast<Scalar>())),
-              derivatives(Eigen::Matrix<Scalar, Get::n_vars, max_derivatives>::Zero()) {
+            : derivative_coefficients(createPowers(collocation_points)),
+              derivatives(Derivatives::Zero(DGet::n_vars, max_derivatives)) {
     }
 
     /**
@@ -38,20 +138,29 @@ public:
         static_assert(up_to_derivative <= max_derivatives,
                       "The number of derivatives must be less than or equal to number specified in the LagrangeDerivatives template.");
 
-        const Scalar *x = x0;
-        for (Index i = 0; i < up_to_derivative; ++i) {
-            Scalar *dx = derivatives.col(i).data();
-            for (Index i_w = 0; i_w < n_w; ++i_w)
-                Get::varsAtWaypoint(dx, i_w) =
-                        Get::varsAtWaypoint(x, i_w) * derivative_coefficients / Get::times(x)(i_w);
-            x = dx;
-        }
+        for (Index i_w = 0; i_w < n_w; ++i_w)
+            generateAtWaypoint<up_to_derivative>(x0, i_w);
+    }
+
+    /**
+     * Generate the derivatives up to the degree specified by "up_to_derivative", but only for waypoint i_w.
+     * Since the waypoints are differentiated independently, calling this for every waypoint is the same
+     * as calling `generate`.
+     */
+    template<Index up_to_derivative>
+    void generateAtWaypoint(const Scalar *x0, Index i_w) {
+
+        static_assert(up_to_derivative <= max_derivatives,
+                      "The number of derivatives must be less than or equal to number specified in the LagrangeDerivatives template.");
+
+        generateAtWaypoint(x0, i_w, Integer<up_to_derivative>());
     }
 
     /** Return the specified derivative degree of the data from the last time that you called
      * `generate`. For instance, specify degree=1 means that this function
      * will return the first derivative, etc. If you did not called generate
-     * with a degree >= the order that you specify here, then the output is undefined.
+     * with a degree >= the order that you specify here, or if the Demand did not ask for an entry,
+     * then the output is undefined.
      */
     template<Index degree>
     Scalar *get() {
@@ -0,0 +1,321 @@
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include "cppad/example/cppad_eigen.hpp"
+
+/* Other STL libraries that we are using */
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/* Our classes */
+#include "fused_contraint.h"
+#include "fg_eval.h"
+#include "variable_getter.h"
+#include "shared_variable_getter.h"
+#include "interleaved_variable_getter.h"
+#include "reduced_control_variable_getter.h"
+
+#include "collocation_constraints.h"
+#include "control_rate_constraints.h"
+#include "dynamics_constraints.h"
+#include "initial_state_constraints.h"
+#include "local_control_rate_constraints.h"
+#include "local_dynamics_constraints.h"
+#include "multiple_shooting.h"
+#include "smooth_control_constraints.h"
+#include "waypoint_constraints.h"
+
+/* Eigen */
+#include "Eigen/Dense"
+#include "Eigen/Sparse"
+#include "Eigen/SparseCholesky"
+#include "Eigen/OrderingMethods"
+
+/*
+ * This compares the variable layouts by the structure of the KKT matrix that Ipopt factorizes,
+ *
+ * [ H + delta I     J^T    ]
+ * [     J       -delta I   ]
+ *
+ * where J is the constraint Jacobian and H is the Hessian of the Lagrangian, evaluated at a random point.
+ * The small regularization delta makes the matrix quasi-definite, so it can be factorized without pivoting.
+ *
+ * For each layout, we report the fill-in (the number of nonzeros in L) and the factorization time of Eigen's
+ * sparse LDLT with two orderings:
+ *
+ * 1) The layout ordering keeps the variables in the order of the layout, and places each constraint
+ *    right after the last variable that it depends on. This shows the structure of the layout as is.
+ * 2) An AMD ordering, which is close to what MUMPS does by default.
+ *
+ * The ReducedControls layout stores fewer control nodes than collocation points, so it also shrinks the
+ * number of variables. Its nodes use the same (uniform) scheme as the collocation points of the benchmark.
+ *
+ * Finally, we compare the Lagrange transcription with the local Hermite-Simpson transcription
+ * (see local_dynamics_constraints.h), whose rows only couple neighbouring collocation points, and with
+ * multiple shooting (see multiple_shooting.h), which only keeps the states at the shooting nodes.
+ */
+
+/* Types */
+using Scalar = double;
+using ADScalar = CppAD::AD<Scalar>;
+using Index = size_t;
+
+template<Index size>
+using Array = Eigen::Matrix<Scalar, size, 1>;
+
+template<typename T>
+using Vector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+
+using Sparsity = std::vector<std::set<size_t>>;
+using SparseMatrix = Eigen::SparseMatrix<Scalar>;
+
+const Index n_x = 6;
+const Index n_u = 4;
+
+/** The constraints of the problem for a given layout. Every layout except the SharedVariableGetter
+ * holds separate copies of the boundary nodes, so it needs the CollocationConstraints. */
+template<template<typename, typename I, I, I, I, I> class Getter, Index n_c, Index n_w>
+struct LayoutConstraints {
+
+    template<typename Bound, typename State, typename Waypoints>
+    static auto create(const Bound &lower, const Bound &upper, const State &initial_state, const Waypoints &waypoints)
+    -> decltype(std::make_tuple(CollocationConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(),
+                                ControlRateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(lower, upper),
+                                DynamicsConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(),
+                                InitialStateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(initial_state),
+                                SmoothControlConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(),
+                                WaypointConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(waypoints))) {
+        return std::make_tuple(CollocationConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(),
+                               ControlRateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(lower, upper),
+                               DynamicsConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(),
+                               InitialStateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(initial_state),
+                               SmoothControlConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(),
+                               WaypointConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(waypoints));
+    }
+};
+
+template<Index n_c, Index n_w>
+struct LayoutConstraints<SharedVariableGetter, n_c, n_w> {
+
+    template<typename Bound, typename State, typename Waypoints>
+    static auto create(const Bound &lower, const Bound &upper, const State &initial_state, const Waypoints &waypoints)
+    -> decltype(std::make_tuple(ControlRateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(lower, upper),
+                                DynamicsConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(),
+                                InitialStateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(initial_state),
+                                SmoothControlConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(),
+                                WaypointConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(waypoints))) {
+        return std::make_tuple(ControlRateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(lower, upper),
+                               DynamicsConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(),
+                               InitialStateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(initial_state),
+                               SmoothControlConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(),
+                               WaypointConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(waypoints));
+    }
+};
+
+/** The constraints of the local Hermite-Simpson transcription for a layout that holds separate copies
+ * of the boundary nodes. The control rates are bounded, and made continuous between waypoints,
+ * with finite differences. */
+template<template<typename, typename I, I, I, I, I> class Getter, Index n_c, Index n_w>
+struct LocalConstraints {
+
+    template<typename Bound, typename State, typename Waypoints>
+    static auto create(const Bound &lower, const Bound &upper, const State &initial_state, const Waypoints &waypoints)
+    -> decltype(std::make_tuple(CollocationConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(),
+                                LocalControlRateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(
+                                        generateCollocationPoints<Scalar, Index, n_c>(), lower, upper),
+                                HermiteSimpsonDynamicsConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(
+                                        generateCollocationPoints<Scalar, Index, n_c>()),
+                                InitialStateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(initial_state),
+                                LocalSmoothControlConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(
+                                        generateCollocationPoints<Scalar, Index, n_c>()),
+                                WaypointConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(waypoints))) {
+        const auto points = generateCollocationPoints<Scalar, Index, n_c>();
+        return std::make_tuple(CollocationConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(),
+                               LocalControlRateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(points, lower, upper),
+                               HermiteSimpsonDynamicsConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(points),
+                               InitialStateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(initial_state),
+                               LocalSmoothControlConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(points),
+                               WaypointConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(waypoints));
+    }
+};
+
+/** The constraints of the multiple shooting transcription, which must use the ShootingVariableGetter */
+template<template<typename, typename I, I, I, I, I> class Getter, Index n_c, Index n_w>
+struct ShootingConstraints {
+
+    template<typename Bound, typename State, typename Waypoints>
+    static auto create(const Bound &lower, const Bound &upper, const State &initial_state, const Waypoints &waypoints)
+    -> decltype(std::make_tuple(InitialStateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(initial_state),
+                                ShootingDynamicsConstraints<ADScalar, Index, n_x, n_u, n_c, n_w>(
+                                        generateCollocationPoints<Scalar, Index, n_c>()),
+                                ShootingControlConstraints<ADScalar, Index, n_x, n_u, n_c, n_w>(),
+                                LocalControlRateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(
+                                        generateCollocationPoints<Scalar, Index, n_c>(), lower, upper),
+                                WaypointConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(waypoints))) {
+        const auto points = generateCollocationPoints<Scalar, Index, n_c>();
+        return std::make_tuple(InitialStateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(initial_state),
+                               ShootingDynamicsConstraints<ADScalar, Index, n_x, n_u, n_c, n_w>(points),
+                               ShootingControlConstraints<ADScalar, Index, n_x, n_u, n_c, n_w>(),
+                               LocalControlRateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(points, lower, upper),
+                               WaypointConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, Getter>(waypoints));
+    }
+};
+
+/** Factorize the KKT matrix repeatedly and print the fill-in and the average time */
+template<typename Ordering>
+void factorize(const SparseMatrix &kkt, const std::string &name) {
+    Eigen::SimplicialLDLT<SparseMatrix, Eigen::Lower, Ordering> ldlt;
+    ldlt.analyzePattern(kkt);
+
+    const int repetitions = 100;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < repetitions; ++i)
+        ldlt.factorize(kkt);
+    auto finish = std::chrono::high_resolution_clock::now();
+    const double microseconds =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count() / 1e3 / repetitions;
+
+    cout << "    " << name << ": nnz(L) = " << ldlt.matrixL().nestedExpression().nonZeros()
+         << ", factorization = " << microseconds << " us"
+         << (ldlt.info() == Eigen::Success ? "" : " (failed)") << endl;
+}
+
+/** Build the KKT matrix of the problem in the layout of the Getter, and benchmark its factorization */
+template<template<typename, typename I, I, I, I, I> class Getter, Index n_c, Index n_w,
+    typename Constraints = LayoutConstraints<Getter, n_c, n_w>>
+void benchmark(const std::string &name) {
+
+    using Get = Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using GetAD = Getter<ADScalar, Index, n_x, n_u, n_c, n_w>;
+    const Index n_vars = Get::n_vars;
+
+    /* The problem data only affects the values, not the structure */
+    Array<n_x> initial_state = Array<n_x>::Zero();
+    Eigen::Matrix<Scalar, n_x, n_w> waypoints = Eigen::Matrix<Scalar, n_x, n_w>::Random();
+    Array<n_u> control_rate_upper = Array<n_u>::Ones();
+    Array<n_u> control_rate_lower = -control_rate_upper;
+
+    auto constraints = Constraints::create(control_rate_lower, control_rate_upper, initial_state, waypoints);
+    using Fused = FusedConstraint<decltype(constraints), ADScalar, Index, n_x, n_u, n_c, n_w, Array, Getter>;
+    Fused fused_constraints(constraints, generateCollocationPoints<Scalar, Index, n_c>());
+    const Index n_constraints = Fused::n_constraints;
+    FG_eval<Vector, Scalar, Fused, GetAD> fg_eval(fused_constraints);
+
+    /* Tape the problem at a random point with positive times */
+    Vector<Scalar> x0 = Vector<Scalar>::Random(n_vars);
+    Get::times(x0.data()).setOnes();
+    Vector<ADScalar> x = x0.template cast<ADScalar>();
+    CppAD::Independent(x);
+    Vector<ADScalar> fg(1 + n_constraints);
+    fg_eval(fg, x);
+    CppAD::ADFun<Scalar> fun(x, fg);
+
+    /* The sparsity patterns of the Jacobian and of the Hessian of the Lagrangian */
+    Sparsity identity(n_vars);
+    for (Index j = 0; j < n_vars; ++j)
+        identity[j].insert(j);
+    Sparsity jacobian_pattern = fun.ForSparseJac(n_vars, identity);
+    Sparsity all_rows(1);
+    for (Index i = 0; i < 1 + n_constraints; ++i)
+        all_rows[0].insert(i);
+    Sparsity hessian_pattern = fun.RevSparseHes(n_vars, all_rows);
+
+    /* And their values, with random multipliers: the constraint rows of the Jacobian,
+     * and the lower triangle of the Hessian */
+    std::vector<size_t> jacobian_rows, jacobian_cols, hessian_rows, hessian_cols;
+    for (Index i = 0; i < n_constraints; ++i) {
+        for (Index j : jacobian_pattern[1 + i]) {
+            jacobian_rows.push_back(1 + i);
+            jacobian_cols.push_back(j);
+        }
+    }
+    for (Index i = 0; i < n_vars; ++i) {
+        for (Index j : hessian_pattern[i]) {
+            if (j <= i) {
+                hessian_rows.push_back(i);
+                hessian_cols.push_back(j);
+            }
+        }
+    }
+    Vector<Scalar> weights = Vector<Scalar>::Random(1 + n_constraints);
+    weights(0) = 1;
+    Vector<Scalar> jacobian(jacobian_rows.size());
+    Vector<Scalar> hessian(hessian_rows.size());
+    CppAD::sparse_jacobian_work jacobian_work;
+    CppAD::sparse_hessian_work hessian_work;
+    fun.SparseJacobianForward(x0, jacobian_pattern, jacobian_rows, jacobian_cols, jacobian, jacobian_work);
+    fun.SparseHessian(x0, weights, hessian_pattern, hessian_rows, hessian_cols, hessian, hessian_work);
+
+    /* The layout ordering: each constraint follows the last variable that it depends on */
+    const Index n_kkt = n_vars + n_constraints;
+    std::vector<std::pair<Index, Index>> keys;
+    for (Index j = 0; j < n_vars; ++j)
+        keys.emplace_back(2 * j, j);
+    for (Index i = 0; i < n_constraints; ++i) {
+        const Index last = jacobian_pattern[1 + i].empty() ? 0 : *jacobian_pattern[1 + i].rbegin();
+        keys.emplace_back(2 * last + 1, n_vars + i);
+    }
+    std::stable_sort(keys.begin(), keys.end());
+    std::vector<Index> position(n_kkt);
+    for (Index k = 0; k < n_kkt; ++k)
+        position[keys[k].second] = k;
+
+    /* Assemble the lower triangle of the permuted KKT matrix */
+    const Scalar delta = 1e-4;
+    std::vector<Eigen::Triplet<Scalar>> triplets;
+    auto add = [&](Index row, Index col, Scalar value) {
+        const Index r = position[row];
+        const Index c = position[col];
+        triplets.emplace_back(std::max(r, c), std::min(r, c), value);
+    };
+    for (Index i = 0; i < n_vars; ++i)
+        add(i, i, delta);
+    for (Index k = 0; k < hessian_rows.size(); ++k)
+        add(hessian_rows[k], hessian_cols[k], hessian[k]);
+    for (Index i = 0; i < n_constraints; ++i)
+        add(n_vars + i, n_vars + i, -delta);
+    for (Index k = 0; k < jacobian_rows.size(); ++k)
+        add(n_vars + jacobian_rows[k] - 1, jacobian_cols[k], jacobian[k]);
+    SparseMatrix kkt(n_kkt, n_kkt);
+    kkt.setFromTriplets(triplets.begin(), triplets.end());
+
+    cout << name << " (n_c = " << n_c << ", n_w = " << n_w << "): "
+         << n_vars << " variables, " << n_constraints << " constraints, nnz(KKT) = " << kkt.nonZeros() << endl;
+    factorize<Eigen::NaturalOrdering<int>>(kkt, "layout ordering");
+    factorize<Eigen::AMDOrdering<int>>(kkt, "AMD ordering   ");
+}
+
+template<Index n_c, Index n_w>
+void benchmarkLayouts() {
+    benchmark<VariableGetter, n_c, n_w>("VariableGetter           ");
+    benchmark<SharedVariableGetter, n_c, n_w>("SharedVariableGetter     ");
+    benchmark<InterleavedVariableGetter, n_c, n_w>("InterleavedVariableGetter");
+    benchmark<ReducedControls<4, CollocationScheme::Uniform>::Getter, n_c, n_w>("ReducedControls<4>       ");
+    cout << endl;
+}
+
+template<Index n_c, Index n_w>
+void benchmarkTranscriptions() {
+    benchmark<InterleavedVariableGetter, n_c, n_w>("Lagrange                 ");
+    benchmark<InterleavedVariableGetter, n_c, n_w, LocalConstraints<InterleavedVariableGetter, n_c, n_w>>(
+            "Hermite-Simpson          ");
+    benchmark<ShootingVariableGetter, n_c, n_w, ShootingConstraints<ShootingVariableGetter, n_c, n_w>>(
+            "Multiple shooting        ");
+    cout << endl;
+}
+
+int main() {
+    std::srand(0);
+    benchmarkLayouts<11, 6>();
+    benchmarkLayouts<7, 20>();
+    benchmarkTranscriptions<11, 6>();
+    benchmarkTranscriptions<31, 4>();
+    return 0;
+}
@@ -0,0 +1,152 @@
+#ifndef LOCAL_CONTROL_RATE_CONSTRAINTS_HEADER
+#define LOCAL_CONTROL_RATE_CONSTRAINTS_HEADER
+
+#include "derivative_demand.h"
+#include "variable_getter.h"
+#include "Eigen/Dense"
+#include "equality_constraint.h"
+#include "ranged_constraint.h"
+
+/**
+ * This is the ControlRateConstraints for the local transcriptions (see local_dynamics_constraints.h).
+ * Instead of differentiating the Lagrange polynomial of the whole waypoint, the control rate over each
+ * interval of length h between the collocation points k and k+1 is estimated by finite differences,
+ *
+ * lower_bound <= ( u[k+1] - u[k] ) / h <= upper_bound
+ *
+ * so every row only depends on two collocation points and the time of the waypoint.
+ * This yields n_u * (n_c - 1) * n_w constraints.
+*/
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
+struct LocalControlRateConstraints
+        : RangedConstraint<
+                LocalControlRateConstraints<
+                        Scalar, Index, n_x, n_u, n_c, n_w, Getter>, Scalar, Index, n_u * (n_c - 1) * n_w, n_u> {
+
+private:
+
+    static_assert(n_c >= 2, "The finite differences need at least two collocation points");
+
+    using Base = RangedConstraint<LocalControlRateConstraints, Scalar, Index, n_u * (n_c - 1) * n_w, n_u>;
+    using Get = Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_u, n_c - 1>>;
+    using Steps = Eigen::Matrix<Scalar, n_c - 1, 1>;
+
+    /** The reciprocal of the length of each interval, as a fraction of the time of the waypoint */
+    const Steps inverse_steps;
+
+public:
+
+    static const Index derivatives = 0;
+    static const unsigned derivative_rows = NoRows;
+    static const unsigned derivative_columns = NoColumns;
+
+    template<typename CollocationPoints, typename Bound>
+    LocalControlRateConstraints(const CollocationPoints &collocation_points,
+                                const Bound &lower_bound,
+                                const Bound &upper_bound)
+            : Base(lower_bound, upper_bound),
+              inverse_steps((collocation_points.template tail<n_c - 1>() - collocation_points.template head<n_c - 1>())
+                                .cwiseInverse().template cast<Scalar>()) {
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+        for (Index i_w = 0; i_w < n_w; ++i_w)
+            g = evaluateWaypoint(g, x, lagrange_derivatives, i_w);
+        return g;
+    }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return n_u * (n_c - 1) * i_w;
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        const Eigen::Matrix<Scalar, n_u, n_c> controls = Get::controlsAtWaypoint(x, i_w);
+        const Steps scale = inverse_steps / Get::times(x)(i_w);
+        Map G(g);
+        G = (controls.template rightCols<n_c - 1>() - controls.template leftCols<n_c - 1>()) * scale.asDiagonal();
+        return g + n_u * (n_c - 1);
+    }
+};
+
+/**
+ * This is the SmoothControlConstraints for the local transcriptions. The control rate at the end of waypoint
+ * i-1 is estimated by the finite difference over its last interval, and the one at the start of waypoint i by
+ * the finite difference over its first interval, and the two must be equal,
+ *
+ * ( u_i[1] - u_i[0] ) / h_i - ( u_i-1[n_c-1] - u_i-1[n_c-2] ) / h_i-1 = 0
+ *
+ * Like the rates of the LocalControlRateConstraints, these are first order estimates, so they hold exactly when
+ * the controls are linear across the boundary. Every row only depends on the two intervals next to the boundary
+ * and the times of both waypoints, which keeps the Jacobian banded.
+ *
+ * This gives us n_u * (n_w-1) constraints.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
+struct LocalSmoothControlConstraints
+        : EqualityConstraint<
+                LocalSmoothControlConstraints<
+                        Scalar, Index, n_x, n_u, n_c, n_w, Getter>, Scalar, Index, n_u * (n_w - 1)> {
+
+private:
+
+    static_assert(n_c >= 2, "The finite differences need at least two collocation points");
+
+    using Get = Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
+
+    /** The reciprocal of the length of the first and the last interval, as a fraction of the time of the waypoint */
+    const Scalar inverse_first_step;
+    const Scalar inverse_last_step;
+
+public:
+
+    static const Index derivatives = 0;
+    static const unsigned derivative_rows = NoRows;
+    static const unsigned derivative_columns = NoColumns;
+
+    template<typename CollocationPoints>
+    LocalSmoothControlConstraints(const CollocationPoints &collocation_points)
+            : inverse_first_step(1 / (collocation_points(1) - collocation_points(0))),
+              inverse_last_step(1 / (collocation_points(n_c - 1) - collocation_points(n_c - 2))) {
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+        for (Index i_w = 1; i_w < n_w; ++i_w)
+            g = evaluateWaypoint(g, x, lagrange_derivatives, i_w);
+        return g;
+    }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return i_w == 0 ? 0 : n_u * (i_w - 1);
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Waypoint i_w > 0 compares its first control rate with the last one of waypoint i_w-1,
+     * and waypoint 0 has no rows. Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        if (i_w == 0)
+            return g;
+        const Eigen::Matrix<Scalar, n_u, n_c> controls = Get::controlsAtWaypoint(x, i_w);
+        const Eigen::Matrix<Scalar, n_u, n_c> previous = Get::controlsAtWaypoint(x, i_w - 1);
+        Eigen::Map<Eigen::Matrix<Scalar, n_u, 1>> G(g);
+        G = (controls.col(1) - controls.col(0)) * (inverse_first_step / Get::times(x)(i_w))
+            - (previous.col(n_c - 1) - previous.col(n_c - 2)) * (inverse_last_step / Get::times(x)(i_w - 1));
+        return g + n_u;
+    }
+};
+
+#endif /* LOCAL_CONTROL_RATE_CONSTRAINTS_HEADER */
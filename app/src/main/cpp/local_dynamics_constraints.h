@@ -0,0 +1,194 @@
+#ifndef LOCAL_DYNAMICS_CONSTRAINTS_HEADER
+#define LOCAL_DYNAMICS_CONSTRAINTS_HEADER
+
+#include "derivative_demand.h"
+#include "variable_getter.h"
+#include "Eigen/Dense"
+#include "equality_constraint.h"
+#include "quadrotor_dynamics.h"
+
+/*
+ * These replace the DynamicsConstraints with a local transcription. Instead of comparing the dynamics
+ * with the derivative of the Lagrange polynomial through all n_c collocation points of a waypoint, each
+ * defect only integrates the dynamics over the interval between two neighbouring collocation points.
+ * Every row therefore depends on the states and controls of two collocation points and the time of the
+ * waypoint, so the Jacobian is banded instead of having dense n_c x n_c blocks. They do not read
+ * the Lagrange derivatives.
+ *
+ * Each gives n_x * (n_c - 1) * n_w constraints. The collocation points must be the ones given to the
+ * FusedConstraint.
+ *
+ * The ControlRateConstraints and SmoothControlConstraints read the Lagrange derivatives, so a local
+ * transcription pairs these with the LocalControlRateConstraints and LocalSmoothControlConstraints of
+ * local_control_rate_constraints.h instead.
+ */
+
+/**
+ * The trapezoidal rule, that is, for each interval of length h between the collocation points k and k+1,
+ *
+ * x[k+1] - x[k] - h / 2 * ( f[k] + f[k+1] ) = 0
+ *
+ * where f are the dynamics. The defect of each interval is of order h^3, so this is second order accurate.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
+struct TrapezoidalDynamicsConstraints
+    : EqualityConstraint<
+        TrapezoidalDynamicsConstraints<
+            Scalar, Index, n_x, n_u, n_c, n_w, Getter>, Scalar, Index, n_x * (n_c - 1) * n_w> {
+
+private:
+
+    static_assert(n_c >= 2, "The trapezoidal rule needs at least two collocation points");
+
+    using Get = Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_x, n_c - 1>>;
+    using Steps = Eigen::Matrix<Scalar, n_c - 1, 1>;
+
+    const QuadrotorDynamics<Scalar> model;
+
+    /** The length of each interval, as a fraction of the time of the waypoint */
+    const Steps steps;
+
+public:
+
+    static const Index derivatives = 0;
+    static const unsigned derivative_rows = NoRows;
+    static const unsigned derivative_columns = NoColumns;
+
+    template<typename CollocationPoints>
+    TrapezoidalDynamicsConstraints(const CollocationPoints &collocation_points)
+        : steps((collocation_points.template tail<n_c - 1>() - collocation_points.template head<n_c - 1>())
+                    .template cast<Scalar>()) {
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+        for (Index i_w = 0; i_w < n_w; ++i_w)
+            g = evaluateWaypoint(g, x, lagrange_derivatives, i_w);
+        return g;
+    }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return n_x * (n_c - 1) * i_w;
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+
+        static_assert(n_x == 6, "This function is only valid for states of size 6");
+        static_assert(n_u == 4, "This function is only valid for controls of size 4");
+
+        const Eigen::Matrix<Scalar, n_x, n_c> states = Get::statesAtWaypoint(x, i_w);
+        Eigen::Matrix<Scalar, n_x, n_c> f;
+        model(states, Get::controlsAtWaypoint(x, i_w), f);
+
+        const Steps half_steps = steps * (Get::times(x)(i_w) / Scalar(2));
+        Map G(g);
+        G = states.template rightCols<n_c - 1>() - states.template leftCols<n_c - 1>()
+            - (f.template leftCols<n_c - 1>() + f.template rightCols<n_c - 1>()) * half_steps.asDiagonal();
+        return g + n_x * (n_c - 1);
+    }
+};
+
+/**
+ * The compressed Hermite-Simpson rule, that is, for each interval of length h between the collocation
+ * points k and k+1, the state at the middle of the interval is estimated with the cubic Hermite polynomial,
+ *
+ * x[m] = ( x[k] + x[k+1] ) / 2 + h / 8 * ( f[k] - f[k+1] )
+ * u[m] = ( u[k] + u[k+1] ) / 2
+ *
+ * and the dynamics are integrated with Simpson's rule,
+ *
+ * x[k+1] - x[k] - h / 6 * ( f[k] + 4 f[m] + f[k+1] ) = 0
+ *
+ * The midpoint is eliminated, so this needs no extra variables. The defect of each interval is of order h^5,
+ * so this is fourth order accurate in the states, as long as the controls are linear over each interval.
+ * Otherwise the interpolated middle control is off by O(h^2) and the defect falls to order h^3, as for the
+ * trapezoidal rule.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
+struct HermiteSimpsonDynamicsConstraints
+    : EqualityConstraint<
+        HermiteSimpsonDynamicsConstraints<
+            Scalar, Index, n_x, n_u, n_c, n_w, Getter>, Scalar, Index, n_x * (n_c - 1) * n_w> {
+
+private:
+
+    static_assert(n_c >= 2, "The Hermite-Simpson rule needs at least two collocation points");
+
+    using Get = Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_x, n_c - 1>>;
+    using Steps = Eigen::Matrix<Scalar, n_c - 1, 1>;
+
+    const QuadrotorDynamics<Scalar> model;
+
+    /** The length of each interval, as a fraction of the time of the waypoint */
+    const Steps steps;
+
+public:
+
+    static const Index derivatives = 0;
+    static const unsigned derivative_rows = NoRows;
+    static const unsigned derivative_columns = NoColumns;
+
+    template<typename CollocationPoints>
+    HermiteSimpsonDynamicsConstraints(const CollocationPoints &collocation_points)
+        : steps((collocation_points.template tail<n_c - 1>() - collocation_points.template head<n_c - 1>())
+                    .template cast<Scalar>()) {
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+        for (Index i_w = 0; i_w < n_w; ++i_w)
+            g = evaluateWaypoint(g, x, lagrange_derivatives, i_w);
+        return g;
+    }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return n_x * (n_c - 1) * i_w;
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+
+        static_assert(n_x == 6, "This function is only valid for states of size 6");
+        static_assert(n_u == 4, "This function is only valid for controls of size 4");
+
+        const Eigen::Matrix<Scalar, n_x, n_c> states = Get::statesAtWaypoint(x, i_w);
+        const Eigen::Matrix<Scalar, n_u, n_c> controls = Get::controlsAtWaypoint(x, i_w);
+        Eigen::Matrix<Scalar, n_x, n_c> f;
+        model(states, controls, f);
+
+        const Steps interval_steps = steps * Get::times(x)(i_w);
+        const Steps eighth_steps = interval_steps / Scalar(8);
+        const Steps sixth_steps = interval_steps / Scalar(6);
+
+        /* The states and controls at the middle of each interval */
+        const Eigen::Matrix<Scalar, n_x, n_c - 1> middle_states =
+                (states.template leftCols<n_c - 1>() + states.template rightCols<n_c - 1>()) / Scalar(2)
+                + (f.template leftCols<n_c - 1>() - f.template rightCols<n_c - 1>()) * eighth_steps.asDiagonal();
+        const Eigen::Matrix<Scalar, n_u, n_c - 1> middle_controls =
+                (controls.template leftCols<n_c - 1>() + controls.template rightCols<n_c - 1>()) / Scalar(2);
+        Eigen::Matrix<Scalar, n_x, n_c - 1> f_middle;
+        model(middle_states, middle_controls, f_middle);
+
+        Map G(g);
+        G = states.template rightCols<n_c - 1>() - states.template leftCols<n_c - 1>()
+            - (f.template leftCols<n_c - 1>() + Scalar(4) * f_middle + f.template rightCols<n_c - 1>()) * sixth_steps.asDiagonal();
+        return g + n_x * (n_c - 1);
+    }
+};
+
+#endif /* LOCAL_DYNAMICS_CONSTRAINTS_HEADER */
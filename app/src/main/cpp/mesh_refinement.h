@@ -0,0 +1,194 @@
+#ifndef MESH_REFINEMENT_HEADER
+#define MESH_REFINEMENT_HEADER
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "Eigen/Dense"
+#include "quadrotor_dynamics.h"
+#include "runtime_variable_getter.h"
+#include "trajectory_problem.h"
+#include "utils.h"
+
+/** The parameters of the mesh refinement loop */
+struct MeshRefinementOptions {
+
+    /** The number of collocation points of every waypoint in the first (coarse) solve */
+    size_t initial_nodes = 5;
+
+    /** No waypoint gets more collocation points than this */
+    size_t max_nodes = 15;
+
+    /** A waypoint is refined while its dynamics defect is larger than this */
+    double tolerance = 1e-3;
+
+    /** The maximum number of solves, including the coarse one */
+    size_t max_solves = 4;
+};
+
+/** The result of the mesh refinement loop */
+template<typename Scalar, typename Index>
+struct MeshRefinementResult {
+
+    /** The number of collocation points of each waypoint in the final solve */
+    std::vector<Index> node_counts;
+
+    /** The final solution, in the layout of RuntimeVariableGetter(node_counts) */
+    CppAD::ipopt::solve_result<TrajectoryVector<Scalar>> solution;
+
+    /** The dynamics defect of each waypoint at the final solution */
+    std::vector<Scalar> defects;
+
+    /** The number of solves */
+    Index solves = 0;
+};
+
+/**
+ * Estimate how well the interpolation polynomials satisfy the dynamics between the collocation points.
+ * The dynamics only hold at the collocation points by construction, so for each waypoint, we evaluate
+ *
+ * | dX/dt(tau) - f(X(tau), U(tau)) |
+ *
+ * at the midpoints between neighbouring collocation points, where X and U are the interpolated
+ * states and controls, and return the largest entry for each waypoint.
+ * The defect has the units of the state derivatives.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+std::vector<Scalar> dynamicsDefects(const RuntimeVariableGetter<Scalar, Index, n_x, n_u> &get,
+                                    const Scalar *x,
+                                    CollocationScheme scheme) {
+
+    const QuadrotorDynamics<Scalar> model;
+    auto times = get.times(x);
+    std::vector<Scalar> defects(get.n_w, 0);
+    for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+
+        const Index n_c = get.n_c(i_w);
+        const TrajectoryVector<Scalar> points = generateCollocationPoints<Scalar>(n_c, scheme);
+        const TrajectoryVector<Scalar> weights = barycentricWeights(points);
+
+        /* Gather the interpolation coefficients of all of the midpoints */
+        Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> values(n_c, n_c - 1);
+        Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> derivatives(n_c, n_c - 1);
+        for (Index i_c = 0; i_c + 1 < n_c; ++i_c) {
+            const Scalar tau = (points(i_c) + points(i_c + 1)) / 2;
+            values.col(i_c) = lagrangeInterpolationCoefficients(points, weights, tau);
+            derivatives.col(i_c) = lagrangeInterpolationDerivativeCoefficients(points, weights, tau);
+        }
+
+        const Eigen::Matrix<Scalar, n_x, Eigen::Dynamic> states = get.statesAtWaypoint(x, i_w) * values;
+        const Eigen::Matrix<Scalar, n_u, Eigen::Dynamic> controls = get.controlsAtWaypoint(x, i_w) * values;
+        Eigen::Matrix<Scalar, n_x, Eigen::Dynamic> dynamics(n_x, n_c - 1);
+        model(states, controls, dynamics);
+
+        const Eigen::Matrix<Scalar, n_x, Eigen::Dynamic> interpolated =
+                get.statesAtWaypoint(x, i_w) * derivatives / times(i_w);
+        defects[i_w] = (interpolated - dynamics).cwiseAbs().maxCoeff();
+    }
+    return defects;
+}
+
+/**
+ * Evaluate the interpolation polynomials of the solution x (in the layout of from)
+ * at the collocation points of the layout of to, and store the result in y.
+ * The times are copied over unchanged.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+void interpolateSolution(const RuntimeVariableGetter<Scalar, Index, n_x, n_u> &from,
+                         const Scalar *x,
+                         const RuntimeVariableGetter<Scalar, Index, n_x, n_u> &to,
+                         Scalar *y,
+                         CollocationScheme scheme) {
+
+    for (Index i_w = 0; i_w < from.n_w; ++i_w) {
+        const TrajectoryVector<Scalar> points = generateCollocationPoints<Scalar>(from.n_c(i_w), scheme);
+        const TrajectoryVector<Scalar> weights = barycentricWeights(points);
+        const TrajectoryVector<Scalar> new_points = generateCollocationPoints<Scalar>(to.n_c(i_w), scheme);
+
+        Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> coefficients(from.n_c(i_w), to.n_c(i_w));
+        for (Index i_c = 0; i_c < to.n_c(i_w); ++i_c)
+            coefficients.col(i_c) = lagrangeInterpolationCoefficients(points, weights, new_points(i_c));
+        to.varsAtWaypoint(y, i_w) = from.varsAtWaypoint(x, i_w) * coefficients;
+    }
+    to.times(y) = from.times(x);
+}
+
+/**
+ * Choose the number of collocation points for the next solve. A waypoint whose defect e exceeds the
+ * tolerance grows from n_c to n_c + ceil(log(e / tolerance) / log(n_c)) points, since the
+ * interpolation error of a smooth solution falls roughly like n_c^-n_c. The others are left alone.
+ * Return false if no waypoint could be refined.
+ */
+template<typename Scalar, typename Index>
+bool refineNodeCounts(std::vector<Index> &node_counts,
+                      const std::vector<Scalar> &defects,
+                      const MeshRefinementOptions &options) {
+    bool refined = false;
+    for (Index i_w = 0; i_w < node_counts.size(); ++i_w) {
+        const Index n_c = node_counts[i_w];
+        if (defects[i_w] <= options.tolerance || n_c >= options.max_nodes)
+            continue;
+        const double ratio = std::log(defects[i_w] / options.tolerance) / std::log(std::max<double>(n_c, 2));
+        const Index increment = std::max<Index>(1, static_cast<Index>(std::ceil(ratio)));
+        node_counts[i_w] = std::min<Index>(n_c + increment, options.max_nodes);
+        refined = true;
+    }
+    return refined;
+}
+
+/**
+ * Solve the problem on a coarse mesh, with options.initial_nodes collocation points per waypoint,
+ * then add collocation points only to the waypoints whose dynamics defect is too large, and re-solve
+ * starting from the interpolated previous solution. This continues until every defect is within the
+ * tolerance, no waypoint can be refined any further, a solve fails, or we run out of solves.
+ *
+ * @param solve: Called as solve(get, x) for each mesh, where get is the RuntimeVariableGetter of the mesh and
+ * x the initial guess in its layout. It returns the CppAD::ipopt::solve_result, as solveRuntimeTrajectory does.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, typename Solve>
+MeshRefinementResult<Scalar, Index>
+refineMeshWith(const TrajectoryProblem<Scalar, Index, n_x, n_u> &problem,
+               const MeshRefinementOptions &options,
+               const Solve &solve) {
+
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+
+    MeshRefinementResult<Scalar, Index> result;
+    result.node_counts.assign(problem.n_w(), options.initial_nodes);
+
+    /* The coarse solve starts from the initial guess of the problem */
+    TrajectoryVector<Scalar> x(Get(result.node_counts).n_vars);
+    problem.initialGuess(Get(result.node_counts), x.data());
+
+    while (true) {
+        const Get get(result.node_counts);
+        result.solution = solve(get, x);
+        result.defects = dynamicsDefects(get, result.solution.x.data(), problem.scheme);
+        ++result.solves;
+
+        if (result.solution.status != CppAD::ipopt::solve_result<TrajectoryVector<Scalar>>::success
+            || result.solves >= options.max_solves
+            || !refineNodeCounts(result.node_counts, result.defects, options))
+            return result;
+
+        /* Warm start the next solve from the current solution */
+        const Get refined(result.node_counts);
+        x.resize(refined.n_vars);
+        interpolateSolution(get, result.solution.x.data(), refined, x.data(), problem.scheme);
+    }
+}
+
+/** Refine the mesh as above, solving each mesh with solveRuntimeTrajectory and the Ipopt options */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+MeshRefinementResult<Scalar, Index>
+refineMesh(const TrajectoryProblem<Scalar, Index, n_x, n_u> &problem,
+           const MeshRefinementOptions &options,
+           const std::string &ipopt_options) {
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    return refineMeshWith(problem, options, [&](const Get &get, const TrajectoryVector<Scalar> &x) {
+        return solveRuntimeTrajectory(problem, get, x, ipopt_options);
+    });
+}
+
+#endif /* MESH_REFINEMENT_HEADER */
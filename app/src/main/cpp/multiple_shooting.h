@@ -0,0 +1,313 @@
+#ifndef MULTIPLE_SHOOTING_HEADER
+#define MULTIPLE_SHOOTING_HEADER
+
+#include <cassert>
+#include "cppad/cppad.hpp"
+#include "cppad/utility/runge_45.hpp"
+#include "derivative_demand.h"
+#include "Eigen/Dense"
+#include "equality_constraint.h"
+#include "quadrotor_dynamics.h"
+
+/*
+ * The multiple shooting transcription. Instead of storing the states at every collocation point and
+ * comparing them with the dynamics, only the states at the shooting nodes (the start of the trajectory
+ * and the end of each waypoint) are variables. The states in between are found by integrating the
+ * dynamics inside the constraint function with CppAD's Runge45, and the continuity defects at the
+ * shooting nodes replace the DynamicsConstraints and the CollocationConstraints.
+ *
+ * The controls are still stored at the n_c collocation points of each waypoint, and they are linearly
+ * interpolated in time between them, so the LocalControlRateConstraints (see local_control_rate_constraints.h)
+ * bound their rates exactly.
+ *
+ * For long waypoints this removes n_x * (n_c - 1) * n_w state variables and as many dynamics rows,
+ * at the cost of denser Jacobian blocks, since every defect depends on all of the controls of its waypoint.
+ *
+ * The state bounds are variable bounds, so they only hold at the shooting nodes. The integrated states
+ * in between are not variables, and nothing keeps them within the bounds, so a trajectory that meets them
+ * at every node may still leave them inside a waypoint. Bounds that must hold throughout need the states
+ * at the collocation points, as in the collocation layouts, or waypoints short enough that the excursions
+ * between the nodes do not matter.
+ */
+
+/**
+ * This class provides the accessors of the VariableGetter that make sense for the multiple shooting
+ * layout. The variables sit in memory like this:
+ *
+ * [ x_0, u[0,0], ..., u[n_c-1,0], x_1, u[0,1], ..., u[n_c-1,1], x_2, ..., u[n_c-1,n_w-1], x_{n_w} ]
+ *
+ * followed by the vector of times for each waypoint, [ t_1,... t_{n_w} ]
+ *
+ * where x_0 is the initial state and x_{i+1} is the state at the end of waypoint i.
+ * Since only the states at the first and last collocation points are stored, statesAtCollocationPoint and
+ * state only accept i_c = 0 or i_c = n_c - 1, and there is no statesAtWaypoint or varsAtWaypoint. So the
+ * InitialStateConstraints, WaypointConstraints and LocalControlRateConstraints work with this layout,
+ * but the constraints that read the Lagrange derivatives do not.
+ *
+ * @tparam n_x: The size of the state
+ * @tparam n_u: The size of the control input
+ * @tparam n_c: The number of collocation points
+ * @tparam n_w: The number of waypoints
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+class ShootingVariableGetter {
+private:
+
+    /** The distance between two adjacent shooting nodes */
+    static const Index n_block = n_x + n_u * n_c;
+
+    using Stride = Eigen::OuterStride<n_block>;
+
+    /** The offset of the first node of the states at collocation point i_c */
+    static constexpr Index nodeOffset(Index i_c) {
+        return i_c == 0 ? 0 : n_block;
+    }
+
+public:
+
+    static const Index n_vars = n_x + n_block * n_w + n_w;
+
+    /** Set all of the variables to zero */
+    static void setZero(Scalar *raw_ptr) {
+        Eigen::Map<Eigen::Matrix<Scalar, n_vars, 1>>(raw_ptr).setZero();
+    }
+
+    /** Return a reference to the shooting node i_n, that is, the initial state for i_n = 0,
+     * or the state at the end of waypoint i_n - 1 */
+    static constexpr auto node(const Scalar *raw_ptr, Index i_n)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, n_x, 1>>(raw_ptr)) {
+        return Eigen::Map<const Eigen::Matrix<Scalar, n_x, 1>>(raw_ptr + n_block * i_n);
+    }
+
+    static constexpr auto node(Scalar *raw_ptr, Index i_n)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, n_x, 1>>(raw_ptr)) {
+        return Eigen::Map<Eigen::Matrix<Scalar, n_x, 1>>(raw_ptr + n_block * i_n);
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ u[0,i], ..., u[n_c-1,i]]
+     *
+     * that is, a matrix of shape n_u x n_c,
+     * holding all of the controls at waypoint i_w.
+     */
+    static constexpr auto controlsAtWaypoint(const Scalar *raw_ptr, Index i_w)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, n_u, n_c>>(raw_ptr)) {
+        return Eigen::Map<const Eigen::Matrix<Scalar, n_u, n_c>>(raw_ptr + n_block * i_w + n_x);
+    }
+
+    static constexpr auto controlsAtWaypoint(Scalar *raw_ptr, Index i_w)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, n_u, n_c>>(raw_ptr)) {
+        return Eigen::Map<Eigen::Matrix<Scalar, n_u, n_c>>(raw_ptr + n_block * i_w + n_x);
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ x[i,0], ..., x[i,n_w-1]]
+     *
+     * that is, a matrix of shape n_x x n_w,
+     * holding all of the states at collocation point i_c, which must be 0 or n_c - 1.
+     */
+    static auto statesAtCollocationPoint(const Scalar *raw_ptr, Index i_c)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, n_x, n_w>, Eigen::Unaligned, Stride>(raw_ptr)) {
+        assert(i_c == 0 || i_c == n_c - 1);
+        return Eigen::Map<const Eigen::Matrix<Scalar, n_x, n_w>, Eigen::Unaligned, Stride>(raw_ptr + nodeOffset(i_c));
+    }
+
+    static auto statesAtCollocationPoint(Scalar *raw_ptr, Index i_c)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, n_x, n_w>, Eigen::Unaligned, Stride>(raw_ptr)) {
+        assert(i_c == 0 || i_c == n_c - 1);
+        return Eigen::Map<Eigen::Matrix<Scalar, n_x, n_w>, Eigen::Unaligned, Stride>(raw_ptr + nodeOffset(i_c));
+    }
+
+    /** Return a reference to
+     *
+     * x[i,j]
+     *
+     * that is, a matrix of shape n_x x 1,
+     * holding the state at collocation point i_c and waypoint i_w, where i_c must be 0 or n_c - 1.
+     */
+    static auto state(const Scalar *raw_ptr, Index i_c, Index i_w) -> decltype(node(raw_ptr, i_w)) {
+        assert(i_c == 0 || i_c == n_c - 1);
+        return node(raw_ptr, i_c == 0 ? i_w : i_w + 1);
+    }
+
+    static auto state(Scalar *raw_ptr, Index i_c, Index i_w) -> decltype(node(raw_ptr, i_w)) {
+        assert(i_c == 0 || i_c == n_c - 1);
+        return node(raw_ptr, i_c == 0 ? i_w : i_w + 1);
+    }
+
+    /** Return a reference to the vector
+     *
+     * [ t_1,... t_{n_w} ]
+     *
+     * that is, a matrix of shape 1 x n_w,
+     * holding all of the times.
+     */
+    static constexpr auto times(const Scalar *raw_ptr)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, 1, n_w>>(raw_ptr)) {
+        return Eigen::Map<const Eigen::Matrix<Scalar, 1, n_w>>(raw_ptr + n_x + n_block * n_w);
+    }
+
+    static constexpr auto times(Scalar *raw_ptr)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, 1, n_w>>(raw_ptr)) {
+        return Eigen::Map<Eigen::Matrix<Scalar, 1, n_w>>(raw_ptr + n_x + n_block * n_w);
+    }
+};
+
+/**
+ * The continuity defects of the multiple shooting transcription. For each waypoint i, the dynamics are
+ * integrated from the shooting node x_i over the duration of the waypoint, with n_steps Runge45 steps
+ * between each pair of collocation points, and the result must match the next shooting node,
+ *
+ * x_{i+1} - Phi(x_i, u[.,i], t_i) = 0
+ *
+ * This yields n_x * n_w constraints. Runge45 is explicit, so it records a plain sequence of operations on the
+ * tape; Rosen34 would need the Jacobian of the dynamics inside the recording, and the quadrotor is not stiff.
+ *
+ * The collocation points must be the ones given to the FusedConstraint. This reads the ShootingVariableGetter layout.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w,
+    Index n_steps = 1>
+struct ShootingDynamicsConstraints
+    : EqualityConstraint<
+        ShootingDynamicsConstraints<Scalar, Index, n_x, n_u, n_c, n_w, n_steps>, Scalar, Index, n_x * n_w> {
+
+private:
+
+    static_assert(n_c >= 2, "The controls need at least two collocation points");
+    static_assert(n_steps >= 1, "Each interval needs at least one integration step");
+
+    using Get = ShootingVariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_x, 1>>;
+    using Points = Eigen::Matrix<Scalar, n_c, 1>;
+    using State = CppAD::vector<Scalar>;
+
+    /** The dynamics over one interval, in the time of the waypoint scaled to [0, 1], in the form
+     * that Runge45 expects */
+    struct Interval {
+
+        const QuadrotorDynamics<Scalar> &model;
+        const Points &points;
+        const Eigen::Matrix<Scalar, n_u, n_c> &controls;
+        const Scalar &duration;
+        const Index i_c;
+
+        void Ode(const Scalar &s, const State &x, State &f) const {
+            const Scalar fraction = (s - points(i_c)) / (points(i_c + 1) - points(i_c));
+            const Eigen::Matrix<Scalar, n_u, 1> u =
+                    controls.col(i_c) + (controls.col(i_c + 1) - controls.col(i_c)) * fraction;
+            Eigen::Map<Eigen::Matrix<Scalar, n_x, 1>> dx(f.data());
+            model(Eigen::Map<const Eigen::Matrix<Scalar, n_x, 1>>(x.data()), u, dx);
+            dx *= duration;
+        }
+    };
+
+    const QuadrotorDynamics<Scalar> model;
+
+    /** The collocation points, as fractions of the time of the waypoint */
+    const Points points;
+
+public:
+
+    static const Index derivatives = 0;
+    static const unsigned derivative_rows = NoRows;
+    static const unsigned derivative_columns = NoColumns;
+
+    template<typename CollocationPoints>
+    ShootingDynamicsConstraints(const CollocationPoints &collocation_points)
+        : points(collocation_points.template cast<Scalar>()) {
+    }
+
+    /** Integrate the dynamics over waypoint i_w of x, and return the state at its end */
+    Eigen::Matrix<Scalar, n_x, 1> integrate(const Scalar *x, Index i_w) const {
+
+        static_assert(n_x == 6, "This function is only valid for states of size 6");
+        static_assert(n_u == 4, "This function is only valid for controls of size 4");
+
+        const Eigen::Matrix<Scalar, n_u, n_c> controls = Get::controlsAtWaypoint(x, i_w);
+        const Scalar duration = Get::times(x)(i_w);
+
+        State state(n_x);
+        Eigen::Map<Eigen::Matrix<Scalar, n_x, 1>>(state.data()) = Get::node(x, i_w);
+        State error(n_x);
+        for (Index i_c = 0; i_c + 1 < n_c; ++i_c) {
+            Interval interval{model, points, controls, duration, i_c};
+            state = CppAD::Runge45(interval, n_steps, points(i_c), points(i_c + 1), state, error);
+        }
+        return Eigen::Map<const Eigen::Matrix<Scalar, n_x, 1>>(state.data());
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+        for (Index i_w = 0; i_w < n_w; ++i_w)
+            g = evaluateWaypoint(g, x, lagrange_derivatives, i_w);
+        return g;
+    }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return n_x * i_w;
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        Map G(g);
+        G = Get::node(x, i_w + 1) - integrate(x, i_w);
+        return g + n_x;
+    }
+};
+
+/**
+ * In the multiple shooting layout, each waypoint stores its own controls at both of its boundaries.
+ * This set of constraints ensures that the controls are continuous between consecutive waypoints, as the
+ * CollocationConstraints do for the other layouts. This yields n_u * (n_w - 1) constraints.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+struct ShootingControlConstraints
+    : EqualityConstraint<
+        ShootingControlConstraints<Scalar, Index, n_x, n_u, n_c, n_w>, Scalar, Index, n_u * (n_w - 1)> {
+
+private:
+
+    using Get = ShootingVariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_u, 1>>;
+
+public:
+
+    static const Index derivatives = 0;
+    static const unsigned derivative_rows = NoRows;
+    static const unsigned derivative_columns = NoColumns;
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+        for (Index i_w = 1; i_w < n_w; ++i_w)
+            g = evaluateWaypoint(g, x, lagrange_derivatives, i_w);
+        return g;
+    }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class.
+     * Waypoint 0 has no rows, so waypoint i_w starts at row n_u * (i_w - 1). */
+    static constexpr Index waypointOffset(Index i_w) {
+        return i_w == 0 ? 0 : n_u * (i_w - 1);
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        if (i_w == 0)
+            return g;
+        Map G(g);
+        G = Get::controlsAtWaypoint(x, i_w).col(0) - Get::controlsAtWaypoint(x, i_w - 1).col(n_c - 1);
+        return g + n_u;
+    }
+};
+
+#endif /* MULTIPLE_SHOOTING_HEADER */
@@ -0,0 +1,180 @@
+#include "portfolio_solver.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+
+namespace {
+
+using Clock = SolveControl::Clock;
+using Result = QuadrotorSolution::Result;
+
+double secondsBetween(Clock::time_point start, Clock::time_point finish) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count() / 1e9;
+}
+
+bool isConverged(Result::status_type status) {
+    return status == Result::success || status == Result::stop_at_acceptable_point;
+}
+
+/** The problem with the initial guess of the variant, as a warm start in the layout that solveTrajectory uses */
+QuadrotorProblem variantProblem(const QuadrotorProblem &problem, size_t n_c, const PortfolioVariant &variant) {
+    QuadrotorProblem result = problem;
+    result.guess = variant.guess;
+    if (variant.time_scale == 1 && variant.noise == 0)
+        return result;
+
+    const RuntimeVariableGetter<double, size_t, QuadrotorDynamics<double>::n_x, QuadrotorDynamics<double>::n_u>
+        get(n_c, problem.n_w());
+    TrajectoryVector<double> x(get.n_vars);
+    result.initialGuess(get, x.data());
+    get.times(x.data()) *= variant.time_scale;
+
+    /* The boundary nodes are pinned by the initial state and the waypoints, so leave them alone */
+    std::mt19937 generator(variant.seed);
+    std::uniform_real_distribution<double> offset(-variant.noise, variant.noise);
+    for (size_t i_w = 0; i_w < get.n_w; ++i_w) {
+        auto states = get.statesAtWaypoint(x.data(), i_w);
+        for (size_t i_c = 1; i_c + 1 < get.n_c(i_w); ++i_c)
+            for (size_t i_x = 0; i_x < QuadrotorDynamics<double>::n_x; ++i_x)
+                states(i_x, i_c) += offset(generator);
+    }
+
+    result.guess = InitialGuess::WarmStart;
+    result.warm_start = x;
+    result.warm_start_node_counts = get.node_counts;
+    return result;
+}
+
+}
+
+std::vector<PortfolioVariant> defaultPortfolio(size_t n_variants) {
+    const char *hessians[] = {"exact", "limited-memory"};
+    const char *strategies[] = {"adaptive", "monotone"};
+
+    std::vector<PortfolioVariant> variants(n_variants);
+    for (size_t i = 0; i < n_variants; ++i) {
+        PortfolioVariant &variant = variants[i];
+        variant.options += std::string("String  hessian_approximation  ") + hessians[i % 2] + "\n";
+        variant.options += std::string("String  mu_strategy  ") + strategies[i / 2 % 2] + "\n";
+        if (i >= 4) {
+            variant.time_scale = 1.5;
+            variant.noise = 0.1;
+            variant.seed = static_cast<unsigned>(i);
+        }
+    }
+    return variants;
+}
+
+PortfolioResult solvePortfolio(const QuadrotorProblem &problem,
+                               size_t n_c,
+                               const std::string &options,
+                               const std::vector<PortfolioVariant> &variants,
+                               double time_limit,
+                               WorkStealingPool &pool,
+                               const TrajectorySolver &solver) {
+
+    const Clock::time_point start = Clock::now();
+    const size_t n_variants = variants.size();
+
+    /* The losers may still be running when this returns, so everything that they touch is shared with them */
+    struct Race {
+        QuadrotorProblem problem;
+        std::string options;
+        std::vector<PortfolioVariant> variants;
+        TrajectorySolver solver;
+        std::vector<SolveControl> controls;
+        std::vector<QuadrotorSolution> solutions;
+        std::vector<bool> started;
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t remaining;
+        size_t winner;
+        double seconds = 0;
+
+        Race(const QuadrotorProblem &problem, const std::string &options,
+             const std::vector<PortfolioVariant> &variants, const TrajectorySolver &solver)
+            : problem(problem), options(options), variants(variants), solver(solver),
+              controls(variants.size()), solutions(variants.size()), started(variants.size(), false),
+              remaining(variants.size()), winner(variants.size()) {
+        }
+    };
+    const std::shared_ptr<Race> race = std::make_shared<Race>(problem, options, variants, solver);
+    if (time_limit > 0) {
+        const Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(time_limit));
+        for (SolveControl &control : race->controls)
+            control.setDeadline(deadline);
+    }
+
+    /* Every worker runs the newest task of its own queue first, so submit the first variants last */
+    for (size_t i = n_variants; i-- > 0;) {
+        pool.submit([race, n_c, start, i] {
+            const size_t n_variants = race->variants.size();
+            SolveControl &control = race->controls[i];
+            bool skip;
+            {
+                std::lock_guard<std::mutex> lock(race->mutex);
+                skip = race->winner < n_variants || control.isCancelled() || Clock::now() >= control.getDeadline();
+                race->started[i] = !skip;
+            }
+            QuadrotorSolution solution;
+            if (!skip) {
+                /* An exception must not escape the worker, and counts as a variant that did not converge */
+                try {
+                    const QuadrotorProblem variant_problem = variantProblem(race->problem, n_c, race->variants[i]);
+                    solution = race->solver(variant_problem, n_c, race->options + race->variants[i].options, &control);
+                } catch (...) {
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(race->mutex);
+            race->solutions[i] = std::move(solution);
+            if (!skip && race->winner == n_variants && isConverged(race->solutions[i].status)) {
+                race->winner = i;
+                race->seconds = secondsBetween(start, Clock::now());
+                for (size_t j = 0; j < n_variants; ++j)
+                    if (j != i)
+                        race->controls[j].cancel();
+            }
+            if (--race->remaining == 0 || race->winner == i)
+                race->done.notify_all();
+        });
+    }
+
+    PortfolioResult result;
+    std::unique_lock<std::mutex> lock(race->mutex);
+    race->done.wait(lock, [&race, n_variants] { return race->remaining == 0 || race->winner < n_variants; });
+    result.total_seconds = secondsBetween(start, Clock::now());
+    result.winner = race->winner;
+    result.converged = race->winner < n_variants;
+    result.seconds = race->seconds;
+
+    /* Nothing converged, so every variant has stopped. Take the iterate with the smallest violation,
+     * and then the smallest cost. */
+    if (!result.converged) {
+        double best_infeasibility = std::numeric_limits<double>::infinity();
+        double best_cost = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < n_variants; ++i) {
+            if (!race->started[i])
+                continue;
+            const double infeasibility = race->controls[i].getInfeasibility();
+            if (result.winner == n_variants || infeasibility < best_infeasibility
+                || (infeasibility == best_infeasibility && race->solutions[i].cost < best_cost)) {
+                result.winner = i;
+                best_infeasibility = infeasibility;
+                best_cost = race->solutions[i].cost;
+            }
+        }
+        result.seconds = result.total_seconds;
+    }
+
+    if (result.winner < n_variants)
+        result.solution = race->solutions[result.winner];
+    for (const SolveControl &control : race->controls)
+        result.iterations.push_back(control.getIterations());
+    return result;
+}
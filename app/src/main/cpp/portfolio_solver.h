@@ -0,0 +1,77 @@
+#ifndef PORTFOLIO_SOLVER_HEADER
+#define PORTFOLIO_SOLVER_HEADER
+
+#include <string>
+#include <vector>
+#include "trajectory_solver.h"
+#include "work_stealing_pool.h"
+
+/**
+ * One way to solve a problem: an initial guess, optionally retimed and perturbed, and the Ipopt options
+ * that are appended to the options of the portfolio (Ipopt keeps the last value of each option).
+ */
+struct PortfolioVariant {
+
+    InitialGuess guess = InitialGuess::MinimumSnap;
+
+    /** Multiplies the times of the initial guess */
+    double time_scale = 1;
+
+    /** The interior states of the initial guess are moved by up to this much, uniformly at random with seed */
+    double noise = 0;
+    unsigned seed = 0;
+
+    std::string options;
+};
+
+/** The result of a portfolio solve */
+struct PortfolioResult {
+
+    /** The solution of the winning variant */
+    QuadrotorSolution solution;
+
+    /** The index of the winning variant, or the number of variants if none was started */
+    size_t winner = 0;
+
+    /** True if the winner converged, false if it was only the best one at the deadline */
+    bool converged = false;
+
+    /** The time until the winner was found, and until solvePortfolio returned */
+    double seconds = 0;
+    double total_seconds = 0;
+
+    /** The number of Ipopt iterations of each variant when solvePortfolio returned. The losers that were
+     * still stopping may have completed one more. */
+    std::vector<int> iterations;
+};
+
+/**
+ * The variants that MainActivity exposes as toggles: the exact and limited-memory Hessians, each with the
+ * adaptive and monotone mu strategies, from the minimum-snap guess. With more than four variants,
+ * the rest start from guesses that are slower by 50% and perturbed with different seeds.
+ */
+std::vector<PortfolioVariant> defaultPortfolio(size_t n_variants);
+
+/**
+ * Race the variants on the workers of the pool. The first variant that converges (to tol, or to the acceptable
+ * tolerances) wins, and the others are cancelled at their next iteration. If none has converged by the
+ * time limit, every variant is stopped, and the one with the smallest constraint violation wins.
+ * A time limit of zero means no limit.
+ *
+ * This returns as soon as a variant has converged, without waiting for the others to stop. They finish
+ * their current iteration on the pool, and so does anything that was still setting up a solve, which may
+ * take much longer, so call pool.wait() before reusing the workers for something that is urgent. Only
+ * when nothing converges does this wait for every variant, to compare them, so the latency is bounded by the
+ * winner, or by the time limit plus one Ipopt iteration of the slowest variant. The pool should have a worker
+ * per variant, since variants that wait in a queue only start once another one has finished.
+ * See solveBatch for the requirements on the pool and on solver, which solves each variant.
+ */
+PortfolioResult solvePortfolio(const QuadrotorProblem &problem,
+                               size_t n_c,
+                               const std::string &options,
+                               const std::vector<PortfolioVariant> &variants,
+                               double time_limit,
+                               WorkStealingPool &pool,
+                               const TrajectorySolver &solver = solveTrajectory);
+
+#endif /* PORTFOLIO_SOLVER_HEADER */
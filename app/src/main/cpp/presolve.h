@@ -0,0 +1,352 @@
+#ifndef PRESOLVE_HEADER
+#define PRESOLVE_HEADER
+
+#include <cmath>
+#include <set>
+#include <vector>
+#include "cppad/cppad.hpp"
+#include "cppad/ipopt/solve_result.hpp"
+
+/**
+ * This removes the variables whose values are determined before the solve even starts, that is,
+ *
+ * 1) variables whose lower and upper bounds are equal, and
+ * 2) variables that are the only free variable of an equality constraint which is linear in them,
+ *    such as the InitialStateConstraints and the WaypointConstraints.
+ *
+ * The second rule is applied repeatedly, so that a constraint tying a free variable to a variable
+ * that was already removed (for example, a CollocationConstraint next to a waypoint) also
+ * determines its variable. The constraint rows that determined a variable are dropped.
+ *
+ * The reduced problem is described by xi, xl, xu, gl, gu and reduced_fg, which can be passed
+ * directly to CppAD::ipopt::solve. Afterwards, `expand` substitutes the removed variables back
+ * into the solution and recovers the multipliers of the removed rows and bounds from the
+ * stationarity conditions of the full problem.
+ *
+ * Note that Ipopt only sees the TNLP that CppAD::ipopt::solve creates internally,
+ * so we reduce the problem at the level of the FG_eval rather than wrapping the TNLP.
+ *
+ * @tparam Dvector: A vector of doubles, as used by CppAD::ipopt::solve
+ * @tparam FG_eval: The functor that evaluates the objective and constraints of the full problem
+ */
+template<typename Dvector, typename FG_eval>
+class Presolve {
+public:
+
+    using ADvector = typename FG_eval::ADvector;
+    using Sparsity = std::vector<std::set<size_t>>;
+
+    /** This evaluates the reduced problem by expanding x to the full set of variables
+     * and then selecting the remaining rows of fg. */
+    class ReducedFG {
+    private:
+
+        Presolve &presolve;
+
+    public:
+
+        using ADvector = typename FG_eval::ADvector;
+
+        ReducedFG(Presolve &presolve)
+                : presolve(presolve) {
+        }
+
+        void operator()(ADvector &fg, const ADvector &x) {
+
+            /* The removed variables enter as constants, so they never appear on the tape */
+            ADvector full_x(presolve.n_vars);
+            for (size_t i = 0; i < presolve.n_vars; ++i)
+                full_x[i] = presolve.values[i];
+            for (size_t i = 0; i < presolve.free_variables.size(); ++i)
+                full_x[presolve.free_variables[i]] = x[i];
+
+            ADvector full_fg(1 + presolve.n_constraints);
+            presolve.fg_eval(full_fg, full_x);
+
+            fg[0] = full_fg[0];
+            for (size_t i = 0; i < presolve.kept_rows.size(); ++i)
+                fg[1 + i] = full_fg[1 + presolve.kept_rows[i]];
+        }
+    };
+
+    /** The initial guess, variable bounds, and constraint bounds of the reduced problem */
+    Dvector xi;
+    Dvector xl;
+    Dvector xu;
+    Dvector gl;
+    Dvector gu;
+
+    /** The objective and constraints of the reduced problem */
+    ReducedFG reduced_fg;
+
+    Presolve(FG_eval &fg_eval,
+             const Dvector &xi,
+             const Dvector &xl,
+             const Dvector &xu,
+             const Dvector &gl,
+             const Dvector &gu)
+            : reduced_fg(*this),
+              fg_eval(fg_eval),
+              n_vars(xi.size()),
+              n_constraints(gl.size()),
+              values(xi),
+              fixed(n_vars, false),
+              removed(n_constraints, false) {
+
+        tape();
+
+        /* Variables that are fixed by their bounds */
+        for (size_t j = 0; j < n_vars; ++j) {
+            if (xl[j] == xu[j]) {
+                values[j] = xl[j];
+                fixed[j] = true;
+                bound_fixed.push_back(j);
+            }
+        }
+
+        /* Keep eliminating variables until no equality constraint determines a new one */
+        while (eliminate(xl, xu, gl, gu));
+
+        /* Now build the reduced problem */
+        for (size_t j = 0; j < n_vars; ++j)
+            if (!fixed[j])
+                free_variables.push_back(j);
+        for (size_t i = 0; i < n_constraints; ++i)
+            if (!removed[i])
+                kept_rows.push_back(i);
+
+        this->xi = select(xi, free_variables);
+        this->xl = select(xl, free_variables);
+        this->xu = select(xu, free_variables);
+        this->gl = select(gl, kept_rows);
+        this->gu = select(gu, kept_rows);
+    }
+
+    /* The reduced functor holds a reference to this object */
+    Presolve(const Presolve &) = delete;
+    Presolve &operator=(const Presolve &) = delete;
+
+    /** The number of variables that were removed */
+    size_t removedVariables() const {
+        return n_vars - free_variables.size();
+    }
+
+    /** The number of constraints that were removed */
+    size_t removedConstraints() const {
+        return n_constraints - kept_rows.size();
+    }
+
+    /** Substitute the removed variables back into x of the reduced problem. full_x must have n_vars entries. */
+    void expandVariables(const double *reduced_x, double *full_x) const {
+        for (size_t j = 0; j < n_vars; ++j)
+            full_x[j] = values[j];
+        for (size_t i = 0; i < free_variables.size(); ++i)
+            full_x[free_variables[i]] = reduced_x[i];
+    }
+
+    /**
+     * Map the solution of the reduced problem back to the full problem.
+     * If the solve stopped before it produced a solution (for example, because an option was invalid),
+     * the full solution holds the initial guess with zero multipliers, along with the status of the solve.
+     */
+    void expand(const CppAD::ipopt::solve_result<Dvector> &reduced,
+                CppAD::ipopt::solve_result<Dvector> &full) {
+
+        full.status = reduced.status;
+
+        /* Substitute the removed variables back into the solution */
+        const bool solved = static_cast<size_t>(reduced.x.size()) == free_variables.size()
+                            && static_cast<size_t>(reduced.lambda.size()) == kept_rows.size()
+                            && static_cast<size_t>(reduced.zl.size()) == free_variables.size()
+                            && static_cast<size_t>(reduced.zu.size()) == free_variables.size();
+        full.x.resize(n_vars);
+        expandVariables(solved ? reduced.x.data() : xi.data(), full.x.data());
+
+        /* Evaluate the full problem at the solution */
+        Dvector fg = fun.Forward(0, full.x);
+        full.obj_value = fg[0];
+        full.g.resize(n_constraints);
+        for (size_t i = 0; i < n_constraints; ++i)
+            full.g[i] = fg[1 + i];
+
+        /* The multipliers of the remaining rows and variables carry over directly */
+        full.lambda = Dvector::Zero(n_constraints);
+        full.zl = Dvector::Zero(n_vars);
+        full.zu = Dvector::Zero(n_vars);
+        if (!solved)
+            return;
+
+        for (size_t i = 0; i < kept_rows.size(); ++i)
+            full.lambda[kept_rows[i]] = reduced.lambda[i];
+        for (size_t i = 0; i < free_variables.size(); ++i) {
+            full.zl[free_variables[i]] = reduced.zl[i];
+            full.zu[free_variables[i]] = reduced.zu[i];
+        }
+
+        /* A removed row only involves its own variable and variables that were removed before it.
+         * So by going backwards, the stationarity condition of each eliminated variable
+         *
+         * df/dx_j + sum_i lambda_i dg_i/dx_j = 0
+         *
+         * has a single unknown multiplier, namely the one of the row that determined it. */
+        Dvector weights(1 + n_constraints);
+        weights[0] = 1;
+        for (size_t i = 0; i < n_constraints; ++i)
+            weights[1 + i] = full.lambda[i];
+
+        for (size_t k = eliminations.size(); k-- > 0;) {
+            const Elimination &e = eliminations[k];
+            Dvector gradient = fun.Reverse(1, weights);
+            full.lambda[e.row] = -gradient[e.variable] / e.coefficient;
+            weights[1 + e.row] = full.lambda[e.row];
+        }
+
+        /* Finally, the variables that were fixed by their bounds absorb the remaining gradient */
+        if (!bound_fixed.empty()) {
+            Dvector gradient = fun.Reverse(1, weights);
+            for (size_t j : bound_fixed) {
+                full.zl[j] = std::max(gradient[j], 0.0);
+                full.zu[j] = std::max(-gradient[j], 0.0);
+            }
+        }
+    }
+
+private:
+
+    /** A variable that was determined by a single equality constraint */
+    struct Elimination {
+        size_t variable;
+        size_t row;
+        double coefficient;
+    };
+
+    FG_eval &fg_eval;
+
+    const size_t n_vars;
+    const size_t n_constraints;
+
+    /** The full vector of variables, holding the values of the fixed variables */
+    Dvector values;
+
+    std::vector<bool> fixed;
+    std::vector<bool> removed;
+
+    std::vector<size_t> bound_fixed;
+    std::vector<Elimination> eliminations;
+
+    std::vector<size_t> free_variables;
+    std::vector<size_t> kept_rows;
+
+    /** The full problem, and the variables that each constraint row depends on */
+    CppAD::ADFun<double> fun;
+    Sparsity rows;
+
+    /** Record the full problem and compute its Jacobian sparsity pattern */
+    void tape() {
+        ADvector x(n_vars);
+        for (size_t j = 0; j < n_vars; ++j)
+            x[j] = values[j];
+        CppAD::Independent(x);
+        ADvector fg(1 + n_constraints);
+        fg_eval(fg, x);
+        fun.Dependent(x, fg);
+
+        Sparsity identity(n_vars);
+        for (size_t j = 0; j < n_vars; ++j)
+            identity[j].insert(j);
+        Sparsity jacobian = fun.ForSparseJac(n_vars, identity);
+        rows.assign(jacobian.begin() + 1, jacobian.end());
+        fun.size_forward_set(0);
+    }
+
+    /** Return true if the second derivative of row i with respect to x_j is structurally zero */
+    bool isLinear(size_t i, size_t j) {
+        Sparsity r(1);
+        r[0].insert(j);
+        fun.ForSparseJac(1, r, true);
+        Sparsity s(1);
+        s[0].insert(1 + i);
+        Sparsity h = fun.RevSparseHes(1, s);
+        fun.size_forward_set(0);
+        return h[0].count(j) == 0;
+    }
+
+    /** Make a single pass over the equality constraints, and return true if any variable was eliminated */
+    bool eliminate(const Dvector &xl, const Dvector &xu, const Dvector &gl, const Dvector &gu) {
+
+        /* Find the rows with a single free variable. Each variable is claimed by at most one row per pass,
+         * and the other rows that would determine it are revisited in the next pass. */
+        std::vector<Elimination> candidates;
+        std::vector<size_t> constant_rows;
+        std::set<size_t> claimed;
+        for (size_t i = 0; i < n_constraints; ++i) {
+            if (removed[i] || gl[i] != gu[i])
+                continue;
+            size_t n_free = 0;
+            size_t j_free = 0;
+            for (size_t j : rows[i]) {
+                if (!fixed[j]) {
+                    ++n_free;
+                    j_free = j;
+                }
+            }
+            if (n_free == 0)
+                constant_rows.push_back(i);
+            else if (n_free == 1 && claimed.insert(j_free).second && isLinear(i, j_free))
+                candidates.push_back(Elimination{j_free, i, 0.0});
+        }
+
+        if (candidates.empty() && constant_rows.empty())
+            return false;
+
+        /* Evaluate everything at the current values. Since each candidate row only depends on its own
+         * variable and on variables that were fixed in earlier passes, these values stay valid for the whole pass. */
+        Dvector fg = fun.Forward(0, values);
+
+        /* A row that only depends on fixed variables is redundant if it is satisfied */
+        for (size_t i : constant_rows)
+            if (std::abs(fg[1 + i] - gl[i]) <= tolerance * (1 + std::abs(gl[i])))
+                removed[i] = true;
+
+        bool progress = false;
+        Dvector direction = Dvector::Zero(n_vars);
+        for (Elimination &e : candidates) {
+
+            /* Since the row is linear in x_j, the first order coefficient is the same everywhere */
+            direction[e.variable] = 1;
+            e.coefficient = fun.Forward(1, direction)[1 + e.row];
+            direction[e.variable] = 0;
+            if (std::abs(e.coefficient) <= tolerance)
+                continue;
+
+            /* Solve g_i(x) = gl_i for x_j, but leave the variable alone if that violates its bounds */
+            const size_t j = e.variable;
+            const double value = values[j] + (gl[e.row] - fg[1 + e.row]) / e.coefficient;
+            const double slack = tolerance * (1 + std::abs(value));
+            if (value < xl[j] - slack || value > xu[j] + slack)
+                continue;
+
+            values[j] = std::min(std::max(value, xl[j]), xu[j]);
+            fixed[j] = true;
+            removed[e.row] = true;
+            eliminations.push_back(e);
+            progress = true;
+        }
+        return progress;
+    }
+
+    /** Return the entries of v at the specified indices */
+    static Dvector select(const Dvector &v, const std::vector<size_t> &indices) {
+        Dvector selected(indices.size());
+        for (size_t i = 0; i < indices.size(); ++i)
+            selected[i] = v[indices[i]];
+        return selected;
+    }
+
+    static constexpr double tolerance = 1e-10;
+};
+
+template<typename Dvector, typename FG_eval>
+constexpr double Presolve<Dvector, FG_eval>::tolerance;
+
+#endif /* PRESOLVE_HEADER */
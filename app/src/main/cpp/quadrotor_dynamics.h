@@ -0,0 +1,52 @@
+#ifndef QUADROTOR_DYNAMICS_HEADER
+#define QUADROTOR_DYNAMICS_HEADER
+
+#include "Eigen/Dense"
+
+/**
+ * The quadrotor model. The state vector is
+ *
+ * x = [ px, py, pz, vx, vy, vz ]
+ *
+ * and the control vector is
+ *
+ * u = [ thrust, phi, theta, psi ]
+ *
+ * where the z axis points down, so gravity accelerates the vehicle in the +z direction.
+ */
+template<typename Scalar>
+struct QuadrotorDynamics {
+
+    static const size_t n_x = 6;
+    static const size_t n_u = 4;
+
+    const Scalar mass = 1.0;
+    const Scalar gravity = 9.81;
+    const Scalar mass_gravity = mass * gravity;
+
+    /** Evaluate the dynamics for each column of the states and controls,
+     * and store the state derivatives in the corresponding columns of dx. */
+    template<typename States, typename Controls, typename Derivatives>
+    void operator()(const Eigen::MatrixBase<States> &x,
+                    const Eigen::MatrixBase<Controls> &u,
+                    const Eigen::MatrixBase<Derivatives> &dx_) const {
+
+        static_assert(States::RowsAtCompileTime == n_x, "This function is only valid for states of size 6");
+        static_assert(Controls::RowsAtCompileTime == n_u, "This function is only valid for controls of size 4");
+
+        /* This is the usual Eigen idiom for writing to an expression that was passed by const reference */
+        Eigen::MatrixBase<Derivatives> &dx = const_cast<Eigen::MatrixBase<Derivatives> &>(dx_);
+
+        auto thrust = u.row(0).array();
+        auto phi = u.row(1).array();
+        auto theta = u.row(2).array();
+        auto psi = u.row(3).array();
+
+        dx.topRows(3) = x.bottomRows(3).eval();
+        dx.row(3) = -thrust * (sin(phi) * sin(psi) + cos(phi) * cos(psi) * sin(theta));
+        dx.row(4) = thrust * (cos(psi) * sin(phi) - cos(phi) * sin(psi) * sin(theta));
+        dx.row(5) = -thrust * cos(phi) * cos(theta) + mass_gravity;
+    }
+};
+
+#endif /* QUADROTOR_DYNAMICS_HEADER */
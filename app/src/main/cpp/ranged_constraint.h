@@ -0,0 +1,64 @@
+#ifndef RANGED_CONSTRAINT_HEADER
+#define RANGED_CONSTRAINT_HEADER
+
+#include "Eigen/Dense"
+
+/**
+ * A ranged constraint bounds each row from both sides, that is,
+ *
+ * lower_bound <= g(x) <= upper_bound
+ *
+ * Ipopt handles these natively, so this takes a single row per constraint rather than
+ * the two rows we would need if we split it into a pair of inequality constraints.
+ *
+ * The bounds repeat every n_period rows. For example, a bound on the control rates at every
+ * collocation point has n_period = n_u, so row i is bounded by lower_bound(i % n_u) and
+ * upper_bound(i % n_u).
+ *
+ * Note that the bounds are never recorded on the tape, so we always store them as doubles.
+ */
+template<typename T, typename Scalar_, typename Index_, Index_ n_constraints_, Index_ n_period>
+struct RangedConstraint {
+
+    using Scalar = Scalar_;
+    using Index = Index_;
+    static const Index n_constraints = n_constraints_;
+
+    static_assert(n_constraints % n_period == 0,
+                  "The number of constraints must be a multiple of the bound period");
+
+    template<typename BT>
+    BT *writeLowerBound(BT *bounds) const {
+        return writeBound(bounds, lower_bound);
+    }
+
+    template<typename BT>
+    BT *writeUpperBound(BT *bounds) const {
+        return writeBound(bounds, upper_bound);
+    }
+
+private:
+
+    using Bound = Eigen::Matrix<double, n_period, 1, Eigen::DontAlign>;
+
+    const Bound lower_bound;
+    const Bound upper_bound;
+
+    template<typename B>
+    RangedConstraint(const B &lower_bound, const B &upper_bound)
+            : lower_bound(lower_bound.template cast<double>()),
+              upper_bound(upper_bound.template cast<double>()) {
+    };
+
+    friend T;
+
+    template<typename BT>
+    static BT *writeBound(BT *bounds, const Bound &bound) {
+        for (Index i = 0; i < n_constraints; i += n_period)
+            for (Index j = 0; j < n_period; ++j)
+                bounds[i + j] = static_cast<BT>(bound(j));
+        return bounds + n_constraints;
+    }
+};
+
+#endif /* RANGED_CONSTRAINT_HEADER */
@@ -0,0 +1,475 @@
+#ifndef REDUCED_CONTROL_VARIABLE_GETTER_HEADER
+#define REDUCED_CONTROL_VARIABLE_GETTER_HEADER
+
+#include <algorithm>
+/* iostream is just imported to get the endl operator. */
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "Eigen/Dense"
+#include "runtime_variable_getter.h"
+#include "utils.h"
+
+using std::endl;
+
+/**
+ * This class provides the same accessors as the VariableGetter, but for a layout in which each waypoint
+ * only stores the controls at n_k < n_c control nodes. The controls at the n_c collocation points are
+ * interpolated from the control nodes with a constant n_k x n_c matrix, so the controls of each waypoint
+ * form a polynomial of degree n_k - 1 rather than n_c - 1. The variables sit in memory like this
+ * (in column-major format):
+ *
+ *                      waypoint 1,    waypoint 2, ...,    waypoint n_w
+ * collocation 1:   [       x     ,        x     , ...,        x       ]
+ *     ...          [      ...    ,       ...    , ...,       ...      ]
+ * collocation n_c: [       x     ,        x     , ...,        x       ]
+ * control node 1:  [       u     ,        u     , ...,        u       ]
+ *     ...          [      ...    ,       ...    , ...,       ...      ]
+ * control node n_k:[       u     ,        u     , ...,        u       ]
+ *
+ * followed by the vector of times for each waypoint, [ t_1,... t_{n_w} ]
+ *
+ * Both the collocation points and the control nodes are generated with the specified scheme, which must
+ * match the collocation points given to the FusedConstraint. Since every constraint class reads the
+ * controls through the Getter, the DynamicsConstraints, ControlRateConstraints and SmoothControlConstraints
+ * see the interpolated controls, and the LagrangeDerivatives differentiate the interpolation polynomial.
+ *
+ * The accessors that include the controls return interpolated copies rather than references, so
+ * write the controls through controlNodesAtWaypoint or setControlsAtWaypoint.
+ *
+ * Use it through ReducedControls<n_k, scheme>::Getter, which has the signature of the other Getters.
+ *
+ * @tparam n_x: The size of the state
+ * @tparam n_u: The size of the control input
+ * @tparam n_c: The number of collocation points
+ * @tparam n_w: The number of waypoints
+ * @tparam n_k: The number of control nodes
+ * @tparam scheme: The distribution of both the collocation points and the control nodes
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w, Index n_k,
+    CollocationScheme scheme = CollocationScheme::LegendreGaussLobatto>
+class ReducedControlVariableGetter {
+private:
+
+    static_assert(n_k >= 1 && n_k <= n_c, "The number of control nodes must be between 1 and n_c");
+
+    /** The number of states and control nodes of each waypoint */
+    static const Index n_block = n_x * n_c + n_u * n_k;
+
+    /** The distance between the same collocation point of two adjacent waypoints */
+    using Stride = Eigen::OuterStride<n_block>;
+
+    using Interpolation = Eigen::Matrix<double, n_k, n_c>;
+
+    static constexpr auto asMatrix(const Scalar *raw_ptr)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, n_block, n_w>>(raw_ptr)) {
+        return Eigen::Map<const Eigen::Matrix<Scalar, n_block, n_w>>(raw_ptr);
+    }
+
+    static constexpr auto asMatrix(Scalar *raw_ptr)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, n_block, n_w>>(raw_ptr)) {
+        return Eigen::Map<Eigen::Matrix<Scalar, n_block, n_w>>(raw_ptr);
+    }
+
+    /** Evaluate the interpolation polynomials of the points "from" at the points "to" */
+    static Eigen::MatrixXd interpolationCoefficients(Index n_from, Index n_to) {
+        const Eigen::VectorXd from = generateCollocationPoints<double>(n_from, scheme);
+        const Eigen::VectorXd to = generateCollocationPoints<double>(n_to, scheme);
+        const Eigen::VectorXd weights = barycentricWeights(from);
+        Eigen::MatrixXd coefficients(n_from, n_to);
+        for (Index i = 0; i < n_to; ++i)
+            coefficients.col(i) = lagrangeInterpolationCoefficients(from, weights, to(i));
+        return coefficients;
+    }
+
+public:
+
+    static const Index n_vars = (n_block + 1) * n_w;
+
+    /** The matrix B such that the controls at the collocation points are u_nodes * B.
+     * This is only computed once. */
+    static const Interpolation &interpolation() {
+        static const Interpolation coefficients = interpolationCoefficients(n_k, n_c);
+        return coefficients;
+    }
+
+    /** Set all of the variables to zero */
+    static void setZero(Scalar *raw_ptr) {
+        Eigen::Map<Eigen::Matrix<Scalar, n_vars, 1>>(raw_ptr).setZero();
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ x[0,i], ..., x[n_c-1,i]]
+     *
+     * that is, a matrix of shape n_x x n_c,
+     * holding all of the states at waypoint i_w.
+     */
+    static constexpr auto statesAtWaypoint(const Scalar *raw_ptr, Index i_w)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, n_x, n_c>>(raw_ptr)) {
+        return Eigen::Map<const Eigen::Matrix<Scalar, n_x, n_c>>(asMatrix(raw_ptr).col(i_w).data());
+    }
+
+    static constexpr auto statesAtWaypoint(Scalar *raw_ptr, Index i_w)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, n_x, n_c>>(raw_ptr)) {
+        return Eigen::Map<Eigen::Matrix<Scalar, n_x, n_c>>(asMatrix(raw_ptr).col(i_w).data());
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ u_node[0,i], ..., u_node[n_k-1,i]]
+     *
+     * that is, a matrix of shape n_u x n_k,
+     * holding all of the control nodes at waypoint i_w.
+     */
+    static constexpr auto controlNodesAtWaypoint(const Scalar *raw_ptr, Index i_w)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, n_u, n_k>>(raw_ptr)) {
+        return Eigen::Map<const Eigen::Matrix<Scalar, n_u, n_k>>(asMatrix(raw_ptr).col(i_w).data() + n_x * n_c);
+    }
+
+    static constexpr auto controlNodesAtWaypoint(Scalar *raw_ptr, Index i_w)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, n_u, n_k>>(raw_ptr)) {
+        return Eigen::Map<Eigen::Matrix<Scalar, n_u, n_k>>(asMatrix(raw_ptr).col(i_w).data() + n_x * n_c);
+    }
+
+    /** Return a copy of the matrix
+     *
+     * [ u[0,i], ..., u[n_c-1,i]]
+     *
+     * that is, a matrix of shape n_u x n_c,
+     * holding all of the controls at waypoint i_w, interpolated from the control nodes.
+     */
+    static Eigen::Matrix<Scalar, n_u, n_c> controlsAtWaypoint(const Scalar *raw_ptr, Index i_w) {
+        return controlNodesAtWaypoint(raw_ptr, i_w) * interpolation().template cast<Scalar>();
+    }
+
+    /** Set the control nodes of waypoint i_w so that they match the n_u x n_c matrix of controls at the
+     * collocation points. The controls are sampled at the control nodes through their interpolation polynomial,
+     * so controls that are already a polynomial of degree n_k - 1 are reproduced exactly. */
+    template<typename Controls>
+    static void setControlsAtWaypoint(Scalar *raw_ptr, Index i_w, const Controls &controls) {
+        static const Eigen::Matrix<double, n_c, n_k> sampling = interpolationCoefficients(n_c, n_k);
+        controlNodesAtWaypoint(raw_ptr, i_w) = controls * sampling.template cast<Scalar>();
+    }
+
+    /** Return a copy of the matrix
+     *
+     * [ x[0,i], ..., x[n_c-1,i]]
+     * [ u[0,i], ..., u[n_c-1,i]]
+     *
+     * that is, a matrix of shape (n_x + n_u) x n_c,
+     * holding all of the states and controls at waypoint i_w.
+     */
+    static Eigen::Matrix<Scalar, n_x + n_u, n_c> varsAtWaypoint(const Scalar *raw_ptr, Index i_w) {
+        Eigen::Matrix<Scalar, n_x + n_u, n_c> vars;
+        vars.template topRows<n_x>() = statesAtWaypoint(raw_ptr, i_w);
+        vars.template bottomRows<n_u>() = controlsAtWaypoint(raw_ptr, i_w);
+        return vars;
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ x[i,0], ..., x[i,n_w-1]]
+     *
+     * that is, a matrix of shape n_x x n_w,
+     * holding all of the states at collocation point i_c.
+     */
+    static constexpr auto statesAtCollocationPoint(const Scalar *raw_ptr, Index i_c)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, n_x, n_w>, Eigen::Unaligned, Stride>(raw_ptr)) {
+        return Eigen::Map<const Eigen::Matrix<Scalar, n_x, n_w>, Eigen::Unaligned, Stride>(raw_ptr + n_x * i_c);
+    }
+
+    static constexpr auto statesAtCollocationPoint(Scalar *raw_ptr, Index i_c)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, n_x, n_w>, Eigen::Unaligned, Stride>(raw_ptr)) {
+        return Eigen::Map<Eigen::Matrix<Scalar, n_x, n_w>, Eigen::Unaligned, Stride>(raw_ptr + n_x * i_c);
+    }
+
+    /** Return a reference to
+     *
+     * x[i,j]
+     *
+     * that is, a matrix of shape n_x x 1,
+     * holding the state at collocation point i_c and waypoint i_w.
+     */
+    static constexpr auto state(const Scalar *raw_ptr, Index i_c, Index i_w)
+    -> decltype(statesAtWaypoint(raw_ptr, i_w).col(i_c)) {
+        return statesAtWaypoint(raw_ptr, i_w).col(i_c);
+    }
+
+    static constexpr auto state(Scalar *raw_ptr, Index i_c, Index i_w)
+    -> decltype(statesAtWaypoint(raw_ptr, i_w).col(i_c)) {
+        return statesAtWaypoint(raw_ptr, i_w).col(i_c);
+    }
+
+    /** Return a copy of the matrix
+     *
+     * [ u[i,0], ..., u[i,n_w-1]]
+     *
+     * that is, a matrix of shape n_u x n_w,
+     * holding all of the controls at collocation point i_c.
+     */
+    static Eigen::Matrix<Scalar, n_u, n_w> controlsAtCollocationPoint(const Scalar *raw_ptr, Index i_c) {
+        const Eigen::Matrix<Scalar, n_k, 1> coefficients = interpolation().col(i_c).template cast<Scalar>();
+        Eigen::Matrix<Scalar, n_u, n_w> controls;
+        for (Index i_w = 0; i_w < n_w; ++i_w)
+            controls.col(i_w) = controlNodesAtWaypoint(raw_ptr, i_w) * coefficients;
+        return controls;
+    }
+
+    /** Return a copy of
+     *
+     * u[i,j]
+     *
+     * that is, a matrix of shape n_u x 1,
+     * holding all of the controls at collocation point i_c and waypoint i_w.
+     */
+    static Eigen::Matrix<Scalar, n_u, 1> control(const Scalar *raw_ptr, Index i_c, Index i_w) {
+        return controlNodesAtWaypoint(raw_ptr, i_w) * interpolation().col(i_c).template cast<Scalar>();
+    }
+
+    /** Return a copy of the matrix
+     *
+     * [ x[i,0], ..., x[i,n_w-1]]
+     * [ u[i,0], ..., u[i,n_w-1]]
+     *
+     * that is, a matrix of shape (n_x+n_u) x n_w,
+     * holding all of the states and controls at collocation point i_c.
+     */
+    static Eigen::Matrix<Scalar, n_x + n_u, n_w> varsAtCollocationPoint(const Scalar *raw_ptr, Index i_c) {
+        Eigen::Matrix<Scalar, n_x + n_u, n_w> vars;
+        vars.template topRows<n_x>() = statesAtCollocationPoint(raw_ptr, i_c);
+        vars.template bottomRows<n_u>() = controlsAtCollocationPoint(raw_ptr, i_c);
+        return vars;
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ t[0], ..., t[n_w-1]]
+     *
+     * that is, a matrix of shape 1 x n_w,
+     * holding all of the times.
+     */
+    static constexpr auto times(const Scalar *raw_ptr)
+    -> decltype(Eigen::Map<const Eigen::Matrix<Scalar, 1, n_w>>(raw_ptr)) {
+        return Eigen::Map<const Eigen::Matrix<Scalar, 1, n_w>>(raw_ptr + n_block * n_w);
+    }
+
+    static constexpr auto times(Scalar *raw_ptr)
+    -> decltype(Eigen::Map<Eigen::Matrix<Scalar, 1, n_w>>(raw_ptr)) {
+        return Eigen::Map<Eigen::Matrix<Scalar, 1, n_w>>(raw_ptr + n_block * n_w);
+    }
+
+    /** Return a nice formatted string of all of the variables */
+    static std::string asString(const Scalar *raw_vars) {
+        std::stringstream out;
+
+        /* First, write the times to the string  */
+        out << endl;
+        out << endl;
+        out << "Times: " << times(raw_vars) << endl;
+
+        out << "----------------------------" << endl;
+        out << endl;
+        out << "Control nodes: " << endl;
+        out << endl;
+        for (Index i_w = 0; i_w < n_w; ++i_w) {
+            out << "Waypoint " << i_w << endl;
+            out << controlNodesAtWaypoint(raw_vars, i_w) << endl;
+        }
+        out << endl;
+        out << "----------------------------" << endl;
+
+        out << endl;
+        out << "States: " << endl;
+        out << endl;
+        for (Index i_c = 0; i_c < n_c; ++i_c) {
+            out << "Collocation point " << i_c << endl;
+            out << statesAtCollocationPoint(raw_vars, i_c) << endl;
+        }
+        out << endl;
+        out << "----------------------------" << endl;
+        return out.str();
+    }
+};
+
+/**
+ * This adapts the ReducedControlVariableGetter to the Getter signature of the other classes,
+ * for example,
+ *
+ * FusedConstraint<Tuple, Scalar, Index, n_x, n_u, n_c, n_w, Array, ReducedControls<4>::Getter>
+ */
+template<size_t n_k, CollocationScheme scheme = CollocationScheme::LegendreGaussLobatto>
+struct ReducedControls {
+
+    template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+    using Getter = ReducedControlVariableGetter<Scalar, Index, n_x, n_u, n_c, n_w, static_cast<Index>(n_k), scheme>;
+};
+
+/**
+ * The reduced control layout for the runtime-sized classes, which TrajectoryProblem::control_nodes selects.
+ * The variables that Ipopt sees hold, for each waypoint, its n_x x n_c(i_w) states followed by its n_u x n_k
+ * control nodes, and then the times. expand turns them into the layout of the RuntimeVariableGetter, with the
+ * controls at the collocation points interpolated as in the ReducedControlVariableGetter, so the FG wrapper below
+ * hands the RuntimeTranscription the variables that it expects. Waypoints with no more than n_k collocation points
+ * keep a control node at each of them.
+ *
+ * The expansion is linear, so it only adds the products with the interpolation matrices to the tape.
+ * The control bounds apply at the control nodes rather than at the collocation points.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+class RuntimeControlReduction {
+public:
+
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+
+    /** The layout of the expanded variables */
+    const Get get;
+
+    /** The number of control nodes of each waypoint */
+    const std::vector<Index> control_node_counts;
+
+private:
+
+    using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+    using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+
+    /** The offset of the reduced variables of each waypoint. The last entry is the offset of the times. */
+    const std::vector<Index> offsets;
+
+    /** For each waypoint, the matrix B such that the controls at its collocation points are nodes * B,
+     * and the matrix S such that the nodes that reproduce a polynomial of controls are controls * S */
+    std::vector<Matrix> interpolations;
+    std::vector<Matrix> samplings;
+
+    static std::vector<Index> controlNodeCounts(const Get &get, Index n_k) {
+        std::vector<Index> counts(get.n_w);
+        for (Index i_w = 0; i_w < get.n_w; ++i_w)
+            counts[i_w] = std::min(n_k, get.n_c(i_w));
+        return counts;
+    }
+
+    static std::vector<Index> offsetsOf(const Get &get, const std::vector<Index> &control_node_counts) {
+        std::vector<Index> offsets(get.n_w + 1, 0);
+        for (Index i_w = 0; i_w < get.n_w; ++i_w)
+            offsets[i_w + 1] = offsets[i_w] + n_x * get.n_c(i_w) + n_u * control_node_counts[i_w];
+        return offsets;
+    }
+
+    /** Evaluate the interpolation polynomials of the points "from" at the points "to" */
+    static Matrix interpolationCoefficients(Index n_from, Index n_to, CollocationScheme scheme) {
+        const Vector from = generateCollocationPoints<Scalar>(n_from, scheme);
+        const Vector to = generateCollocationPoints<Scalar>(n_to, scheme);
+        const Vector weights = barycentricWeights(from);
+        Matrix coefficients(n_from, n_to);
+        for (Index i = 0; i < n_to; ++i)
+            coefficients.col(i) = lagrangeInterpolationCoefficients(from, weights, to(i));
+        return coefficients;
+    }
+
+    template<typename T>
+    using Block = Eigen::Map<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>>;
+
+    template<typename T>
+    using ConstBlock = Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>>;
+
+public:
+
+    /** The number of reduced variables */
+    const Index n_vars;
+
+    RuntimeControlReduction(const Get &get, Index n_k, CollocationScheme scheme)
+            : get(get),
+              control_node_counts(controlNodeCounts(get, n_k)),
+              offsets(offsetsOf(get, control_node_counts)),
+              n_vars(offsets.back() + get.n_w) {
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            interpolations.push_back(interpolationCoefficients(control_node_counts[i_w], get.n_c(i_w), scheme));
+            samplings.push_back(interpolationCoefficients(get.n_c(i_w), control_node_counts[i_w], scheme));
+        }
+    }
+
+    /** Fill x, in the layout of get, from the reduced variables z. T is Scalar or its AD type. */
+    template<typename T>
+    void expand(const T *z, T *x) const {
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            const Index n_c = get.n_c(i_w);
+            const Index n_k = control_node_counts[i_w];
+            auto vars = Block<T>(x + get.offsets[i_w], n_x + n_u, n_c);
+            vars.topRows(n_x) = ConstBlock<T>(z + offsets[i_w], n_x, n_c);
+            vars.bottomRows(n_u) = ConstBlock<T>(z + offsets[i_w] + n_x * n_c, n_u, n_k)
+                                   * interpolations[i_w].template cast<T>();
+        }
+        for (Index i_w = 0; i_w < get.n_w; ++i_w)
+            x[get.offsets.back() + i_w] = z[offsets.back() + i_w];
+    }
+
+    /** Fill z from x, in the layout of get. Controls that are polynomials of degree n_k - 1 are kept exactly. */
+    void reduce(const Scalar *x, Scalar *z) const {
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            const Index n_c = get.n_c(i_w);
+            const Index n_k = control_node_counts[i_w];
+            Block<Scalar>(z + offsets[i_w], n_x, n_c) = get.statesAtWaypoint(x, i_w);
+            Block<Scalar>(z + offsets[i_w] + n_x * n_c, n_u, n_k) = get.controlsAtWaypoint(x, i_w) * samplings[i_w];
+        }
+        for (Index i_w = 0; i_w < get.n_w; ++i_w)
+            z[offsets.back() + i_w] = x[get.offsets.back() + i_w];
+    }
+
+    /**
+     * Fill the bounds of z from those of x, in the layout of get. Each control node takes the bounds of
+     * the first collocation point of its waypoint, which is where TrajectoryProblem::variableBounds puts
+     * the same bounds as everywhere else, and which may be infinite.
+     */
+    void reduceBounds(const Scalar *lower, const Scalar *upper, Scalar *z_lower, Scalar *z_upper) const {
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            const Index n_c = get.n_c(i_w);
+            const Index n_k = control_node_counts[i_w];
+            Block<Scalar>(z_lower + offsets[i_w], n_x, n_c) = get.statesAtWaypoint(lower, i_w);
+            Block<Scalar>(z_upper + offsets[i_w], n_x, n_c) = get.statesAtWaypoint(upper, i_w);
+            Block<Scalar>(z_lower + offsets[i_w] + n_x * n_c, n_u, n_k).colwise() =
+                    get.controlsAtWaypoint(lower, i_w).col(0);
+            Block<Scalar>(z_upper + offsets[i_w] + n_x * n_c, n_u, n_k).colwise() =
+                    get.controlsAtWaypoint(upper, i_w).col(0);
+        }
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            z_lower[offsets.back() + i_w] = lower[get.offsets.back() + i_w];
+            z_upper[offsets.back() + i_w] = upper[get.offsets.back() + i_w];
+        }
+    }
+
+    /** Fill the bound multipliers of x from those of z. The controls at the collocation points have no bounds
+     * of their own, so their multipliers are zero. */
+    void expandBoundMultipliers(const Scalar *z_multipliers, Scalar *multipliers) const {
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            get.statesAtWaypoint(multipliers, i_w) = ConstBlock<Scalar>(z_multipliers + offsets[i_w], n_x, get.n_c(i_w));
+            get.controlsAtWaypoint(multipliers, i_w).setZero();
+        }
+        for (Index i_w = 0; i_w < get.n_w; ++i_w)
+            multipliers[get.offsets.back() + i_w] = z_multipliers[offsets.back() + i_w];
+    }
+
+    /** The objective and constraints of FG_eval, in terms of the reduced variables */
+    template<typename FG_eval>
+    class FG {
+    private:
+
+        const RuntimeControlReduction &reduction;
+        FG_eval &fg_eval;
+
+    public:
+
+        using ADvector = typename FG_eval::ADvector;
+
+        FG(const RuntimeControlReduction &reduction, FG_eval &fg_eval)
+                : reduction(reduction), fg_eval(fg_eval) {
+        }
+
+        void operator()(ADvector &fg, const ADvector &z) {
+            ADvector x(reduction.get.n_vars);
+            reduction.expand(z.data(), x.data());
+            fg_eval(fg, x);
+        }
+    };
+};
+
+#endif /* REDUCED_CONTROL_VARIABLE_GETTER_HEADER */
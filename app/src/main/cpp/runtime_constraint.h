@@ -0,0 +1,72 @@
+#ifndef RUNTIME_CONSTRAINT_HEADER
+#define RUNTIME_CONSTRAINT_HEADER
+
+#include <cassert>
+#include "Eigen/Dense"
+
+/**
+ * The base of the constraints whose number of rows is only known at runtime.
+ * This covers both equality constraints (the default, with zero bounds) and ranged constraints,
+ *
+ * lower_bound <= g(x) <= upper_bound
+ *
+ * where, as in the RangedConstraint, the bounds repeat every lower_bound.size() rows.
+ *
+ * Note that the bounds are never recorded on the tape, so we always store them as doubles.
+ */
+template<typename Scalar_, typename Index_>
+struct RuntimeConstraint {
+
+    using Scalar = Scalar_;
+    using Index = Index_;
+
+    /** The size of the constraint vector */
+    const Index n_constraints;
+
+    template<typename BT>
+    BT *writeLowerBound(BT *bounds) const {
+        return writeBound(bounds, lower_bound);
+    }
+
+    template<typename BT>
+    BT *writeUpperBound(BT *bounds) const {
+        return writeBound(bounds, upper_bound);
+    }
+
+protected:
+
+    using Bound = Eigen::Matrix<double, Eigen::Dynamic, 1>;
+
+    /** An equality constraint, g(x) = 0 */
+    RuntimeConstraint(Index n_constraints)
+            : n_constraints(n_constraints),
+              lower_bound(Bound::Zero(1)),
+              upper_bound(Bound::Zero(1)) {
+    }
+
+    /** A ranged constraint */
+    template<typename B>
+    RuntimeConstraint(Index n_constraints, const B &lower_bound, const B &upper_bound)
+            : n_constraints(n_constraints),
+              lower_bound(lower_bound.template cast<double>()),
+              upper_bound(upper_bound.template cast<double>()) {
+        assert(lower_bound.size() == upper_bound.size());
+        assert(n_constraints % lower_bound.size() == 0);
+    }
+
+private:
+
+    const Bound lower_bound;
+    const Bound upper_bound;
+
+    template<typename BT>
+    BT *writeBound(BT *bounds, const Bound &bound) const {
+        const Index n_period = bound.size();
+        for (Index i = 0; i < n_constraints; i += n_period)
+            for (Index j = 0; j < n_period; ++j)
+                bounds[i + j] = static_cast<BT>(bound(j));
+        return bounds + n_constraints;
+    }
+};
+
+#endif /* RUNTIME_CONSTRAINT_HEADER */
@@ -0,0 +1,265 @@
+#ifndef RUNTIME_CONSTRAINTS_HEADER
+#define RUNTIME_CONSTRAINTS_HEADER
+
+#include "runtime_variable_getter.h"
+#include "runtime_constraint.h"
+#include "quadrotor_dynamics.h"
+#include "Eigen/Dense"
+
+/*
+ * These are the constraint classes for the RuntimeVariableGetter, where each waypoint may have
+ * its own number of collocation points. Each one produces the same rows as the compile-time class
+ * of the same name (without the Runtime prefix), so see those classes for the details.
+ *
+ * Since the layout is only known at runtime, each constraint holds a copy of the getter.
+ * The derivatives are stored in the same layout as x.
+ */
+
+/**
+ * The runtime version of the CollocationConstraints,
+ * yielding (n_x + n_u) * (n_w-1) conditions.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+struct RuntimeCollocationConstraints : RuntimeConstraint<Scalar, Index> {
+
+private:
+
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_x + n_u, 1>>;
+
+    const Get get;
+
+public:
+
+    static const Index derivatives = 0;
+
+    RuntimeCollocationConstraints(const Get &get)
+            : RuntimeConstraint<Scalar, Index>((n_x + n_u) * (get.n_w - 1)),
+              get(get) {
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+        for (Index i_w = 1; i_w < get.n_w; ++i_w) {
+            Map G(g);
+            G = get.varsAtWaypoint(x, i_w).col(0) - get.varsAtWaypoint(x, i_w - 1).rightCols(1);
+            g += n_x + n_u;
+        }
+        return g;
+    }
+};
+
+/**
+ * The runtime version of the ControlRateConstraints,
+ * yielding n_u conditions for every collocation point.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+struct RuntimeControlRateConstraints : RuntimeConstraint<Scalar, Index> {
+
+private:
+
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_u, Eigen::Dynamic>>;
+
+    const Get get;
+
+public:
+
+    static const Index derivatives = 1;
+
+    template<typename Bound>
+    RuntimeControlRateConstraints(const Get &get,
+                                  const Bound &lower_bound,
+                                  const Bound &upper_bound)
+            : RuntimeConstraint<Scalar, Index>(n_u * get.n_nodes, lower_bound, upper_bound),
+              get(get) {
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+
+        const Scalar *dx = lagrange_derivatives.template get<1>();
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            Map G(g, n_u, get.n_c(i_w));
+            G = get.controlsAtWaypoint(dx, i_w);
+            g += n_u * get.n_c(i_w);
+        }
+        return g;
+    }
+};
+
+/**
+ * The runtime version of the DynamicsConstraints,
+ * yielding n_x conditions for every collocation point.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+struct RuntimeDynamicsConstraints : RuntimeConstraint<Scalar, Index> {
+
+private:
+
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_x, Eigen::Dynamic>>;
+
+    const Get get;
+
+    const QuadrotorDynamics<Scalar> model;
+
+public:
+
+    static const Index derivatives = 1;
+
+    RuntimeDynamicsConstraints(const Get &get)
+            : RuntimeConstraint<Scalar, Index>(n_x * get.n_nodes),
+              get(get) {
+    }
+
+    /**
+     * Evaluate the dynamics at every collocation point of the specified waypoint,
+     * and store the n_x x n_c(waypoint_index) matrix of state derivatives in dx.
+     */
+    void dynamics(const Scalar *x, Scalar *dx, Index waypoint_index) const {
+
+        static_assert(n_x == 6, "This function is only valid for states of size 6");
+        static_assert(n_u == 4, "This function is only valid for controls of size 4");
+
+        Map dX(dx, n_x, get.n_c(waypoint_index));
+        model(get.statesAtWaypoint(x, waypoint_index), get.controlsAtWaypoint(x, waypoint_index), dX);
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+
+        /* For each waypoint, compare the dynamics with the Lagrange interpolation polynomial */
+        const Scalar *dx = lagrange_derivatives.template get<1>();
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            dynamics(x, g, i_w);
+            Map G(g, n_x, get.n_c(i_w));
+            G -= get.statesAtWaypoint(dx, i_w);
+            g += n_x * get.n_c(i_w);
+        }
+        return g;
+    }
+};
+
+/**
+ * The runtime version of the InitialStateConstraints, yielding n_x conditions.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+struct RuntimeInitialStateConstraints : RuntimeConstraint<Scalar, Index> {
+
+private:
+
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_x, 1>>;
+
+    const Get get;
+
+    const Eigen::Matrix<Scalar, n_x, 1> initial_state;
+
+public:
+
+    static const Index derivatives = 0;
+
+    template<typename InitialState>
+    RuntimeInitialStateConstraints(const Get &get, const InitialState &initial_state)
+            : RuntimeConstraint<Scalar, Index>(n_x),
+              get(get),
+              initial_state(initial_state.template cast<Scalar>()) {
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+        Map G(g);
+        G = get.state(x, 0, 0) - initial_state;
+        return g + this->n_constraints;
+    }
+};
+
+/**
+ * The runtime version of the SmoothControlConstraints, yielding n_u * (n_w-1) conditions.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+struct RuntimeSmoothControlConstraints : RuntimeConstraint<Scalar, Index> {
+
+private:
+
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_u, 1>>;
+
+    const Get get;
+
+public:
+
+    static const Index derivatives = 1;
+
+    RuntimeSmoothControlConstraints(const Get &get)
+            : RuntimeConstraint<Scalar, Index>(n_u * (get.n_w - 1)),
+              get(get) {
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+
+        /* Compare the control derivatives at the first collocation point of waypoint i
+         * with those at the last collocation point of waypoint i-1 */
+        const Scalar *dx = lagrange_derivatives.template get<1>();
+        for (Index i_w = 1; i_w < get.n_w; ++i_w) {
+            Map G(g);
+            G = get.controlsAtWaypoint(dx, i_w).col(0) - get.controlsAtWaypoint(dx, i_w - 1).rightCols(1);
+            g += n_u;
+        }
+        return g;
+    }
+};
+
+/**
+ * The runtime version of the WaypointConstraints, yielding n_x * n_w conditions.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+struct RuntimeWaypointConstraints : RuntimeConstraint<Scalar, Index> {
+
+private:
+
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Map = Eigen::Map<Eigen::Matrix<Scalar, n_x, 1>>;
+
+    const Get get;
+
+    const Eigen::Matrix<Scalar, n_x, Eigen::Dynamic> waypoints;
+
+public:
+
+    static const Index derivatives = 0;
+
+    template<typename Waypoints>
+    RuntimeWaypointConstraints(const Get &get, const Waypoints &waypoints)
+            : RuntimeConstraint<Scalar, Index>(n_x * get.n_w),
+              get(get),
+              waypoints(waypoints.template cast<Scalar>()) {
+        assert(Index(waypoints.cols()) == get.n_w);
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    template<typename LD>
+    Scalar *operator()(Scalar *g, const Scalar *x, LD &lagrange_derivatives) const {
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            Map G(g);
+            G = get.statesAtWaypoint(x, i_w).rightCols(1) - waypoints.col(i_w);
+            g += n_x;
+        }
+        return g;
+    }
+};
+
+#endif /* RUNTIME_CONSTRAINTS_HEADER */
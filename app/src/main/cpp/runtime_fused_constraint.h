@@ -0,0 +1,215 @@
+#ifndef RUNTIME_FUSED_CONSTRAINT_HEADER
+#define RUNTIME_FUSED_CONSTRAINT_HEADER
+
+#include <tuple>
+#include "cppad/example/cppad_eigen.hpp"
+#include "runtime_lagrange_derivatives.h"
+#include "runtime_variable_getter.h"
+#include "template_integer.h"
+
+/**
+ * The FusedConstraint for the runtime constraint classes (see runtime_constraints.h).
+ * The number of constraint classes and the maximum derivative are still known at compile time,
+ * but the number of rows of each class is only known at runtime.
+ *
+ * @tparam Tuple A tuple of runtime constraint classes, all sharing the same RuntimeVariableGetter.
+ */
+template<typename Tuple, typename Scalar, typename Index, Index n_x, Index n_u>
+struct RuntimeFusedConstraint {
+
+private:
+
+    /*
+     * ------------------------------------
+     *
+     * Maximum derivative required by constraints
+     *
+     * ------------------------------------
+     */
+    static constexpr Index maxDerivative(Integer<0>) {
+        return std::tuple_element<0, Tuple>::type::derivatives;
+    }
+
+    template<Index i>
+    static constexpr Index maxDerivative(Integer<i>) {
+        return std::tuple_element<i, Tuple>::type::derivatives >= maxDerivative(Integer<i - 1>())
+               ? std::tuple_element<i, Tuple>::type::derivatives : maxDerivative(Integer<i - 1>());
+    }
+
+public:
+
+    /** The number of constraint classes that are fused together */
+    static const Index n_constraint_classes = std::tuple_size<Tuple>::value;
+    static_assert(n_constraint_classes > 0, "You must specify at least one constraint class");
+
+    /** The maximum derivative term required by the constraints */
+    static const Index max_derivative = maxDerivative(Integer<n_constraint_classes - 1>());
+
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Bound = Eigen::Matrix<double, Eigen::Dynamic, 1>;
+
+private:
+
+    /*
+     * ------------------------------------
+     *
+     * Number of Constraints
+     *
+     * ------------------------------------
+     */
+    static Index numberOfConstraints(const Tuple &constraints, Integer<n_constraint_classes - 1>) {
+        return std::get<n_constraint_classes - 1>(constraints).n_constraints;
+    }
+
+    template<Index i>
+    static Index numberOfConstraints(const Tuple &constraints, Integer<i>) {
+        return std::get<i>(constraints).n_constraints + numberOfConstraints(constraints, Integer<i + 1>());
+    }
+
+    /*
+     * ------------------------------------
+     *
+     * Bounds
+     *
+     * ------------------------------------
+     */
+    static double *fillUpperBound(const Tuple &constraints, double *bound, Integer<n_constraint_classes - 1>) {
+        return std::get<n_constraint_classes - 1>(constraints).template writeUpperBound<double>(bound);
+    }
+
+    template<Index i>
+    static double *fillUpperBound(const Tuple &constraints, double *bound, Integer<i>) {
+        return fillUpperBound(constraints,
+                              std::get<i>(constraints).template writeUpperBound<double>(bound),
+                              Integer<i + 1>());
+    }
+
+    static double *fillLowerBound(const Tuple &constraints, double *bound, Integer<n_constraint_classes - 1>) {
+        return std::get<n_constraint_classes - 1>(constraints).template writeLowerBound<double>(bound);
+    }
+
+    template<Index i>
+    static double *fillLowerBound(const Tuple &constraints, double *bound, Integer<i>) {
+        return fillLowerBound(constraints,
+                              std::get<i>(constraints).template writeLowerBound<double>(bound),
+                              Integer<i + 1>());
+    }
+
+    static Bound createUpperBound(const Tuple &constraints) {
+        Bound bound(numberOfConstraints(constraints, Integer<0>()));
+        fillUpperBound(constraints, bound.data(), Integer<0>());
+        return bound;
+    }
+
+    static Bound createLowerBound(const Tuple &constraints) {
+        Bound bound(numberOfConstraints(constraints, Integer<0>()));
+        fillLowerBound(constraints, bound.data(), Integer<0>());
+        return bound;
+    }
+
+    using LD = RuntimeLagrangeDerivatives<Scalar, Index, n_x, n_u, max_derivative>;
+    LD lagrange_derivatives;
+
+public:
+
+    /** The layout of the variables */
+    const Get get;
+
+    /** What the times of the variables are (see time_parameterization.h) */
+    const TimeVariable time;
+
+    /** The size of the constraint vector */
+    const Index n_constraints;
+
+    const Bound lower_bound;
+
+    const Bound upper_bound;
+
+    /** A tuple of the constraint classes that we fuse together. */
+    Tuple constraints;
+
+    /* Constructors */
+    RuntimeFusedConstraint(const Tuple &constraints,
+                           const Get &get,
+                           CollocationScheme scheme,
+                           TimeVariable time = TimeVariable::Duration)
+            : lagrange_derivatives(get, scheme, time),
+              get(get),
+              time(time),
+              n_constraints(numberOfConstraints(constraints, Integer<0>())),
+              lower_bound(createLowerBound(constraints)),
+              upper_bound(createUpperBound(constraints)),
+              constraints(constraints) {
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g + n_constraints. */
+    Scalar *operator()(Scalar *g, const Scalar *x) {
+        lagrange_derivatives.template generate<max_derivative>(x);
+        return evaluateConstraintsTuple(g, x, Integer<0>());
+    }
+
+    /** Evaluate the constraint at x and store the values in g.
+     * Then return a pointer to g.data() + n_constraints. */
+    template<typename U, typename V>
+    auto operator()(U &g, const V &x) -> decltype(g.data()) {
+        return (*this)(g.data(), x.data());
+    }
+
+private:
+
+    /*
+     * ------------------------------------
+     *
+     * Evaluate
+     *
+     * ------------------------------------
+     */
+    Scalar *evaluateConstraintsTuple(Scalar *g, const Scalar *x, Integer<n_constraint_classes - 1>) {
+        return std::get<n_constraint_classes - 1>(constraints)(g, x, lagrange_derivatives);
+    }
+
+    template<Index i>
+    Scalar *evaluateConstraintsTuple(Scalar *g, const Scalar *x, Integer<i>) {
+        return evaluateConstraintsTuple(std::get<i>(constraints)(g, x, lagrange_derivatives),
+                                        x,
+                                        Integer<i + 1>());
+    }
+};
+
+/**
+ * The FG_eval for the RuntimeFusedConstraint. The cost function is the sum of the durations of the waypoints.
+ */
+template<template<typename T> class Vector, typename Scalar, typename RuntimeFusedConstraints>
+struct RuntimeFG_eval {
+
+private:
+
+    RuntimeFusedConstraints &fused_constraints;
+
+public:
+
+    RuntimeFG_eval(RuntimeFusedConstraints &fused_constraints)
+            : fused_constraints(fused_constraints) {
+    }
+
+    using ADvector = Vector<CppAD::AD<Scalar>>;
+
+    void operator()(ADvector &fg, const ADvector &x) {
+
+        assert(size_t(fg.size()) == 1 + fused_constraints.n_constraints);
+        assert(size_t(x.size()) == fused_constraints.get.n_vars);
+
+        /* The first entry in fg is the cost function.
+         * In our case, this is simply the sum of the durations */
+        auto times = fused_constraints.get.times(x.data());
+        fg[0] = 0;
+        for (Eigen::Index i = 0; i < times.size(); ++i)
+            fg[0] += duration(fused_constraints.time, times(i));
+
+        /* The remaining entries are the constraints */
+        fused_constraints(fg.data() + 1, x.data());
+    }
+};
+
+#endif /* RUNTIME_FUSED_CONSTRAINT_HEADER */
@@ -0,0 +1,95 @@
+#ifndef RUNTIME_LAGRANGE_DERIVATIVES_HEADER
+#define RUNTIME_LAGRANGE_DERIVATIVES_HEADER
+
+#include <map>
+#include <vector>
+#include "runtime_variable_getter.h"
+#include "time_parameterization.h"
+#include "Eigen/Dense"
+#include "utils.h"
+
+/**
+ * This is the LagrangeDerivatives for the RuntimeVariableGetter, where each waypoint
+ * may have its own number of collocation points. Each waypoint is differentiated with
+ * the differentiation matrix of its own collocation points, and the derivatives are stored
+ * in the same layout as x. As in LagrangeDerivatives, the k^th derivative is computed straight
+ * from x with the k^th power of the differentiation matrix.
+ *
+ * The times of x are the time variables of the TimeVariable policy (see time_parameterization.h).
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index max_derivatives>
+class RuntimeLagrangeDerivatives {
+private:
+
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Coefficients = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+
+    const Get layout;
+
+    const TimeVariable time;
+
+    /** The powers D, D^2, ..., D^max_derivatives of the differentiation matrix,
+     * for each number of collocation points in use */
+    std::map<Index, std::vector<Coefficients>> derivative_coefficients;
+
+    /** These are the derivatives. The i^th column holds the (i+1)^th derivatives */
+    Eigen::Matrix<Scalar, Eigen::Dynamic, max_derivatives> derivatives;
+
+public:
+
+    RuntimeLagrangeDerivatives(const Get &get, CollocationScheme scheme, TimeVariable time = TimeVariable::Duration)
+            : layout(get),
+              time(time),
+              derivatives(Eigen::Matrix<Scalar, Eigen::Dynamic, max_derivatives>::Zero(get.n_vars, max_derivatives)) {
+        for (Index n_c : get.node_counts) {
+            if (derivative_coefficients.find(n_c) != derivative_coefficients.end())
+                continue;
+            const Eigen::MatrixXd coefficients = lagrangeDerivativeCoefficients(generateCollocationPoints<double>(n_c, scheme));
+            Eigen::MatrixXd power = coefficients;
+            std::vector<Coefficients> &powers = derivative_coefficients[n_c];
+            for (Index i = 0; i < max_derivatives; ++i) {
+                powers.push_back(power.template cast<Scalar>());
+                power = (power * coefficients).eval();
+            }
+        }
+    }
+
+    /**
+     * Generate all of the derivatives up to the degree specified by "up_to_derivative".
+     * See LagrangeDerivatives::generate.
+     */
+    template<Index up_to_derivative>
+    void generate(const Scalar *x0) {
+
+        static_assert(up_to_derivative <= max_derivatives,
+                      "The number of derivatives must be less than or equal to number specified in the RuntimeLagrangeDerivatives template.");
+
+        if (up_to_derivative == 0)
+            return;
+
+        auto times = layout.times(x0);
+        for (Index i_w = 0; i_w < layout.n_w; ++i_w) {
+            const std::vector<Coefficients> &powers = derivative_coefficients.at(layout.n_c(i_w));
+            const Scalar inverse_time = inverseDuration(time, times(i_w));
+            Scalar scale = inverse_time;
+            for (Index i = 0; i < up_to_derivative; ++i) {
+                if (i > 0)
+                    scale *= inverse_time;
+                layout.varsAtWaypoint(derivatives.col(i).data(), i_w) = layout.varsAtWaypoint(x0, i_w) * powers[i] * scale;
+            }
+        }
+    }
+
+    /** Return the specified derivative degree of the data from the last time that you called
+     * `generate`. See LagrangeDerivatives::get. */
+    template<Index degree>
+    Scalar *get() {
+
+        static_assert(degree >= 1, "The derivative degree must be a positive number.");
+        static_assert(degree <= max_derivatives,
+                      "The derivative degree must be less than or equal to number specified in the RuntimeLagrangeDerivatives template.");
+        return derivatives.col(degree - 1).data();
+    }
+};
+
+#endif /* RUNTIME_LAGRANGE_DERIVATIVES_HEADER */
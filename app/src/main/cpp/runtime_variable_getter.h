@@ -0,0 +1,217 @@
+#ifndef RUNTIME_VARIABLE_GETTER_HEADER
+#define RUNTIME_VARIABLE_GETTER_HEADER
+
+/* iostream is just imported to get the endl operator. */
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "Eigen/Dense"
+
+using std::endl;
+
+/**
+ * This class provides the accessors of the VariableGetter when the number of waypoints and
+ * the number of collocation points of each waypoint are only known at runtime.
+ * Each waypoint i_w may have its own number of collocation points n_c(i_w), and the variables
+ * sit in memory like this (in column-major format):
+ *
+ *            waypoint 1                    waypoint n_w
+ *    [ x[0], ..., x[n_c(0)-1] ], ..., [ x[0], ..., x[n_c(n_w-1)-1] ]
+ *    [ u[0], ..., u[n_c(0)-1] ], ..., [ u[0], ..., u[n_c(n_w-1)-1] ]
+ *
+ * followed by the vector of times for each waypoint, [ t_1,... t_{n_w} ].
+ *
+ * When every waypoint has the same number of collocation points,
+ * this is exactly the layout of the VariableGetter.
+ *
+ * @tparam n_x: The size of the state
+ * @tparam n_u: The size of the control input
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+class RuntimeVariableGetter {
+private:
+
+    static std::vector<Index> offsetsOf(const std::vector<Index> &node_counts) {
+        std::vector<Index> offsets(node_counts.size() + 1, 0);
+        for (Index i_w = 0; i_w < node_counts.size(); ++i_w)
+            offsets[i_w + 1] = offsets[i_w] + (n_x + n_u) * node_counts[i_w];
+        return offsets;
+    }
+
+public:
+
+    using Vars = Eigen::Matrix<Scalar, n_x + n_u, Eigen::Dynamic>;
+    using Times = Eigen::Matrix<Scalar, 1, Eigen::Dynamic>;
+
+    /** The number of collocation points of each waypoint */
+    const std::vector<Index> node_counts;
+
+    /** The offset of the variables of each waypoint. The last entry is the offset of the times. */
+    const std::vector<Index> offsets;
+
+    /** The number of waypoints */
+    const Index n_w;
+
+    /** The total number of collocation points, summed over the waypoints */
+    const Index n_nodes;
+
+    /** The total number of variables */
+    const Index n_vars;
+
+    /** Create a getter where waypoint i_w has node_counts[i_w] collocation points */
+    RuntimeVariableGetter(const std::vector<Index> &node_counts)
+            : node_counts(node_counts),
+              offsets(offsetsOf(node_counts)),
+              n_w(node_counts.size()),
+              n_nodes(offsets.back() / (n_x + n_u)),
+              n_vars(offsets.back() + node_counts.size()) {
+    }
+
+    /** Create a getter where each of the n_w waypoints has n_c collocation points */
+    RuntimeVariableGetter(Index n_c, Index n_w)
+            : RuntimeVariableGetter(std::vector<Index>(n_w, n_c)) {
+    }
+
+    /** The number of collocation points of waypoint i_w */
+    Index n_c(Index i_w) const {
+        return node_counts[i_w];
+    }
+
+    /** Set all of the variables to zero */
+    void setZero(Scalar *raw_ptr) const {
+        Eigen::Map<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>(raw_ptr, n_vars).setZero();
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ x[0,i], ..., x[n_c(i)-1,i]]
+     * [ u[0,i], ..., u[n_c(i)-1,i]]
+     *
+     * that is, a matrix of shape (n_x + n_u) x n_c(i_w),
+     * holding all of the states and controls at waypoint i_w.
+     */
+    Eigen::Map<const Vars> varsAtWaypoint(const Scalar *raw_ptr, Index i_w) const {
+        return Eigen::Map<const Vars>(raw_ptr + offsets[i_w], n_x + n_u, node_counts[i_w]);
+    }
+
+    Eigen::Map<Vars> varsAtWaypoint(Scalar *raw_ptr, Index i_w) const {
+        return Eigen::Map<Vars>(raw_ptr + offsets[i_w], n_x + n_u, node_counts[i_w]);
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ x[0,i], ..., x[n_c(i)-1,i]]
+     *
+     * that is, a matrix of shape n_x x n_c(i_w),
+     * holding all of the states at waypoint i_w.
+     */
+    auto statesAtWaypoint(const Scalar *raw_ptr, Index i_w) const
+    -> decltype(varsAtWaypoint(raw_ptr, i_w).template topRows<n_x>()) {
+        return varsAtWaypoint(raw_ptr, i_w).template topRows<n_x>();
+    }
+
+    auto statesAtWaypoint(Scalar *raw_ptr, Index i_w) const
+    -> decltype(varsAtWaypoint(raw_ptr, i_w).template topRows<n_x>()) {
+        return varsAtWaypoint(raw_ptr, i_w).template topRows<n_x>();
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ u[0,i], ..., u[n_c(i)-1,i]]
+     *
+     * that is, a matrix of shape n_u x n_c(i_w),
+     * holding all of the controls at waypoint i_w.
+     */
+    auto controlsAtWaypoint(const Scalar *raw_ptr, Index i_w) const
+    -> decltype(varsAtWaypoint(raw_ptr, i_w).template bottomRows<n_u>()) {
+        return varsAtWaypoint(raw_ptr, i_w).template bottomRows<n_u>();
+    }
+
+    auto controlsAtWaypoint(Scalar *raw_ptr, Index i_w) const
+    -> decltype(varsAtWaypoint(raw_ptr, i_w).template bottomRows<n_u>()) {
+        return varsAtWaypoint(raw_ptr, i_w).template bottomRows<n_u>();
+    }
+
+    /** Return a reference to
+     *
+     * x[i,j]
+     *
+     * that is, a matrix of shape n_x x 1,
+     * holding the state at collocation point i_c and waypoint i_w.
+     */
+    auto state(const Scalar *raw_ptr, Index i_c, Index i_w) const
+    -> decltype(statesAtWaypoint(raw_ptr, i_w).col(i_c)) {
+        return statesAtWaypoint(raw_ptr, i_w).col(i_c);
+    }
+
+    auto state(Scalar *raw_ptr, Index i_c, Index i_w) const
+    -> decltype(statesAtWaypoint(raw_ptr, i_w).col(i_c)) {
+        return statesAtWaypoint(raw_ptr, i_w).col(i_c);
+    }
+
+    /** Return a reference to
+     *
+     * u[i,j]
+     *
+     * that is, a matrix of shape n_u x 1,
+     * holding all of the controls at collocation point i_c and waypoint i_w.
+     */
+    auto control(const Scalar *raw_ptr, Index i_c, Index i_w) const
+    -> decltype(controlsAtWaypoint(raw_ptr, i_w).col(i_c)) {
+        return controlsAtWaypoint(raw_ptr, i_w).col(i_c);
+    }
+
+    auto control(Scalar *raw_ptr, Index i_c, Index i_w) const
+    -> decltype(controlsAtWaypoint(raw_ptr, i_w).col(i_c)) {
+        return controlsAtWaypoint(raw_ptr, i_w).col(i_c);
+    }
+
+    /** Return a reference to the submatrix
+     *
+     * [ t[0], ..., t[n_w-1]]
+     *
+     * that is, a matrix of shape 1 x n_w,
+     * holding all of the times.
+     */
+    Eigen::Map<const Times> times(const Scalar *raw_ptr) const {
+        return Eigen::Map<const Times>(raw_ptr + offsets.back(), 1, n_w);
+    }
+
+    Eigen::Map<Times> times(Scalar *raw_ptr) const {
+        return Eigen::Map<Times>(raw_ptr + offsets.back(), 1, n_w);
+    }
+
+    /** Return a nice formatted string of all of the variables */
+    std::string asString(const Scalar *raw_vars) const {
+        std::stringstream out;
+
+        /* First, write the times to the string  */
+        out << endl;
+        out << endl;
+        out << "Times: " << times(raw_vars) << endl;
+
+        out << "----------------------------" << endl;
+        out << endl;
+        out << "Controls: " << endl;
+        out << endl;
+        for (Index i_w = 0; i_w < n_w; ++i_w) {
+            out << "Waypoint " << i_w << endl;
+            out << controlsAtWaypoint(raw_vars, i_w) << endl;
+        }
+        out << endl;
+        out << "----------------------------" << endl;
+
+        out << endl;
+        out << "States: " << endl;
+        out << endl;
+        for (Index i_w = 0; i_w < n_w; ++i_w) {
+            out << "Waypoint " << i_w << endl;
+            out << statesAtWaypoint(raw_vars, i_w) << endl;
+        }
+        out << endl;
+        out << "----------------------------" << endl;
+        return out.str();
+    }
+};
+
+#endif /* RUNTIME_VARIABLE_GETTER_HEADER */
@@ -1,6 +1,7 @@
 #ifndef SMOOTH_CONTROL_CONSTRAINTS_HEADER
 #define SMOOTH_CONTROL_CONSTRAINTS_HEADER
 
+#include "derivative_demand.h"
 #include "variable_getter.h"
 #include "Eigen/Dense"
 #include "equality_constraint.h"
@@ -19,20 +20,24 @@
  *
  * This gives us n_u * (n_w-1) constraints.
  */
-template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
 struct SmoothControlConstraints
         : EqualityConstraint<
                 SmoothControlConstraints<
-                        Scalar, Index, n_x, n_u, n_c, n_w>, Scalar, Index, n_u * (n_w - 1)> {
+                        Scalar, Index, n_x, n_u, n_c, n_w, Getter>, Scalar, Index, n_u * (n_w - 1)> {
 
 private:
 
-    using Get = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    /* The derivatives are always stored waypoint by waypoint, regardless of the layout of x */
+    using DGet = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
     using Map = Eigen::Map<Eigen::Matrix<Scalar, n_u, n_w - 1 >>;
 
 public:
 
     static const Index derivatives = 1;
+    static const unsigned derivative_rows = ControlRows;
+    static const unsigned derivative_columns = BoundaryColumns;
 
     /** Evaluate the constraint at x and store the values in g.
      * Then return a pointer to g + n_constraints. */
@@ -41,8 +46,8 @@ public:
 
         /* Get all of the control derivatives at the first and last collocation points */
         const Scalar *dx = lagrange_derivatives.template get<1>();
-        auto c_0 = Get::controlsAtCollocationPoint(dx, 0);
-        auto c_end = Get::controlsAtCollocationPoint(dx, n_c - 1);
+        auto c_0 = DGet::controlsAtCollocationPoint(dx, 0);
+        auto c_end = DGet::controlsAtCollocationPoint(dx, n_c - 1);
 
         /* We are going to compute c_0 (of waypoint i) - c_end (of waypoint i-1)
          * This will be a matrix of size n_u x (n_w-1) */
@@ -50,6 +55,24 @@ public:
         G = c_0.template rightCols<n_w - 1>() - c_end.template leftCols<n_w - 1>();
         return g + this->n_constraints;
     }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return i_w == 0 ? 0 : n_u * (i_w - 1);
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Waypoint i_w > 0 compares its first control derivative with the last one of waypoint i_w-1,
+     * and waypoint 0 has no rows. Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        if (i_w == 0)
+            return g;
+        const Scalar *dx = lagrange_derivatives.template get<1>();
+        Eigen::Map<Eigen::Matrix<Scalar, n_u, 1>> G(g);
+        G = DGet::controlsAtWaypoint(dx, i_w).col(0) - DGet::controlsAtWaypoint(dx, i_w - 1).col(n_c - 1);
+        return g + n_u;
+    }
 };
 
 #endif /* SMOOTH_CONTROL_CONSTRAINTS_HEADER */
\ No newline at end of file
@@ -0,0 +1,519 @@
+#ifndef SOLUTION_LIBRARY_HEADER
+#define SOLUTION_LIBRARY_HEADER
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Eigen/Dense"
+#include "trajectory_solver.h"
+
+/**
+ * A k-d tree over points of the specified dimension, which returns the value stored with the nearest point.
+ * The tree is kept balanced by rebuilding it after each insertion, since insertions are rare (one per solve)
+ * and queries are frequent. Many points can be appended first and then built once, which is O(n log n).
+ */
+template<typename Scalar, typename Index>
+class KdTree {
+private:
+
+    const Index dimension;
+
+    /** The coordinates of the points, one point after the other */
+    std::vector<Scalar> points;
+
+    std::vector<Index> values;
+
+    /** The indices of the points, arranged so that the middle of each range is the node that splits it */
+    std::vector<Index> order;
+
+    const Scalar *point(Index i) const {
+        return points.data() + dimension * i;
+    }
+
+    void build(Index begin, Index end, Index depth) {
+        if (end - begin <= 1)
+            return;
+        const Index axis = depth % dimension;
+        const Index middle = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                         [this, axis](Index a, Index b) { return point(a)[axis] < point(b)[axis]; });
+        build(begin, middle, depth + 1);
+        build(middle + 1, end, depth + 1);
+    }
+
+    void search(const Scalar *query, Index begin, Index end, Index depth, Index &best, Scalar &best_distance) const {
+        if (begin >= end)
+            return;
+        const Index middle = begin + (end - begin) / 2;
+        const Index node = order[middle];
+
+        Scalar distance = 0;
+        for (Index i = 0; i < dimension; ++i)
+            distance += (query[i] - point(node)[i]) * (query[i] - point(node)[i]);
+        if (distance < best_distance) {
+            best = node;
+            best_distance = distance;
+        }
+
+        /* Search the side of the query first, and the other side only if the splitting plane is closer
+         * than the best point so far */
+        const Index axis = depth % dimension;
+        const Scalar difference = query[axis] - point(node)[axis];
+        if (difference < 0) {
+            search(query, begin, middle, depth + 1, best, best_distance);
+            if (difference * difference < best_distance)
+                search(query, middle + 1, end, depth + 1, best, best_distance);
+        } else {
+            search(query, middle + 1, end, depth + 1, best, best_distance);
+            if (difference * difference < best_distance)
+                search(query, begin, middle, depth + 1, best, best_distance);
+        }
+    }
+
+public:
+
+    explicit KdTree(Index dimension)
+        : dimension(dimension) {
+    }
+
+    Index size() const {
+        return values.size();
+    }
+
+    /** Add a point without rebalancing the tree. Call build before the next query. */
+    void append(const Scalar *coordinates, Index value) {
+        points.insert(points.end(), coordinates, coordinates + dimension);
+        values.push_back(value);
+        order.push_back(order.size());
+    }
+
+    /** Rebalance the tree over all of its points */
+    void build() {
+        build(0, order.size(), 0);
+    }
+
+    /** Add a point and rebalance the tree */
+    void insert(const Scalar *coordinates, Index value) {
+        append(coordinates, value);
+        build();
+    }
+
+    /** Find the nearest point to the query, and return its value and squared distance.
+     * Return false if the tree is empty. */
+    bool nearest(const Scalar *query, Index &value, Scalar &squared_distance) const {
+        if (values.empty())
+            return false;
+        Index best = 0;
+        squared_distance = std::numeric_limits<Scalar>::infinity();
+        search(query, 0, order.size(), 0, best, squared_distance);
+        value = values[best];
+        return true;
+    }
+};
+
+/**
+ * A persistent store of solved trajectories, used to warm start new missions. Each record holds the
+ * mission (the initial state and the waypoints), the node counts, the solution x, and the time that the solve took.
+ * The multipliers are not stored, since the solvers only warm start the variables.
+ *
+ * The records are appended to a memory-mapped file, so the library survives restarts. When the library is
+ * opened, the records are indexed by the geometry of their missions:
+ *
+ * - An exact repeat of a stored mission returns its solution as is.
+ * - Otherwise, the missions are compared with a descriptor that is invariant to translation and scale.
+ *   The positions relative to the start are divided by the path length L, and the velocities by sqrt(L).
+ *   A k-d tree (one per number of waypoints) finds the nearest stored mission.
+ *
+ * The nearest solution is then mapped onto the new mission. Scaling the positions around the start by
+ * r = L_new / L_old and the times by sqrt(r) keeps the accelerations, so the thrust and attitude stay
+ * dynamically consistent. The velocities scale by sqrt(r).
+ *
+ * The file is only written through this class, and it is not safe to open it from several processes at once.
+ * The record is written before the header counts it, so a crash while inserting loses at most that record.
+ * Opening checks every record that the header counts, and refuses a file with a damaged one.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+class SolutionLibrary {
+public:
+
+    static constexpr uint32_t version = 2;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t scalar_size;
+        uint64_t state_size;
+        uint64_t control_size;
+        /** The number of bytes in use, including this header */
+        uint64_t used;
+        uint64_t count;
+    };
+
+    /** Each record is this header, followed by the initial state (n_x), the waypoints (n_x * n_w),
+     * the node counts (n_w, as uint64_t) and x (n_vars) */
+    struct RecordHeader {
+        uint64_t size;
+        uint64_t n_w;
+        uint64_t n_vars;
+        int64_t status;
+        double cost;
+        double solve_seconds;
+    };
+
+private:
+
+    static_assert(n_x == 6, "The descriptor is only valid for states of size 6");
+
+    using Problem = TrajectoryProblem<Scalar, Index, n_x, n_u>;
+    using Solution = TrajectorySolution<Scalar, Index, n_x, n_u>;
+    using State = Eigen::Matrix<Scalar, n_x, 1>;
+    using Vector3 = Eigen::Matrix<Scalar, 3, 1>;
+
+    /** A record, as pointers into the mapped file. These are invalidated when the file grows. */
+    struct Record {
+        const RecordHeader *header;
+        const Scalar *initial_state;
+        const Scalar *waypoints;
+        const uint64_t *node_counts;
+        const Scalar *x;
+    };
+
+    int file = -1;
+    char *memory = nullptr;
+    size_t capacity = 0;
+
+    /** The offsets of the records, by the bytes of their missions */
+    std::unordered_map<std::string, uint64_t> exact;
+
+    /** The offsets of the records, by their descriptors, for each number of waypoints */
+    std::map<Index, KdTree<Scalar, uint64_t>> trees;
+
+    FileHeader &header() const {
+        return *reinterpret_cast<FileHeader *>(memory);
+    }
+
+    static uint64_t recordSize(uint64_t n_w, uint64_t n_vars) {
+        return sizeof(RecordHeader) + sizeof(Scalar) * (n_x + n_x * n_w + n_vars) + sizeof(uint64_t) * n_w;
+    }
+
+    /**
+     * Check that the record at offset is one that insert could have written: it fits in the used bytes,
+     * its size matches its sizes, and x has the size of the layout of its node counts.
+     */
+    bool isValidRecord(uint64_t offset) const {
+        if (offset > header().used || header().used - offset < sizeof(RecordHeader))
+            return false;
+        const uint64_t available = header().used - offset;
+        const RecordHeader &h = *reinterpret_cast<const RecordHeader *>(memory + offset);
+
+        /* Each of the sizes takes at least 8 bytes, which also keeps the size below from overflowing */
+        if (h.size > available || h.n_w == 0 || h.n_w > available || h.n_vars > available
+            || h.size != recordSize(h.n_w, h.n_vars))
+            return false;
+
+        const Record r = record(offset);
+        uint64_t n_nodes = 0;
+        for (uint64_t i_w = 0; i_w < h.n_w; ++i_w) {
+            if (r.node_counts[i_w] < 2 || r.node_counts[i_w] > h.n_vars)
+                return false;
+            n_nodes += r.node_counts[i_w];
+        }
+        return n_nodes <= h.n_vars && h.n_vars == (n_x + n_u) * n_nodes + h.n_w;
+    }
+
+    Record record(uint64_t offset) const {
+        Record r;
+        r.header = reinterpret_cast<const RecordHeader *>(memory + offset);
+        r.initial_state = reinterpret_cast<const Scalar *>(r.header + 1);
+        r.waypoints = r.initial_state + n_x;
+        r.node_counts = reinterpret_cast<const uint64_t *>(r.waypoints + n_x * r.header->n_w);
+        r.x = reinterpret_cast<const Scalar *>(r.node_counts + r.header->n_w);
+        return r;
+    }
+
+    /** Map the file with at least the specified capacity */
+    bool reserve(size_t bytes) {
+        if (bytes <= capacity)
+            return true;
+        size_t new_capacity = std::max<size_t>(capacity, 1 << 16);
+        while (new_capacity < bytes)
+            new_capacity *= 2;
+        if (ftruncate(file, new_capacity) != 0)
+            return false;
+        if (memory)
+            munmap(memory, capacity);
+        void *mapped = mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (mapped == MAP_FAILED) {
+            memory = nullptr;
+            capacity = 0;
+            return false;
+        }
+        memory = static_cast<char *>(mapped);
+        capacity = new_capacity;
+        return true;
+    }
+
+    static std::string missionKey(const Scalar *initial_state, const Scalar *waypoints, Index n_w) {
+        std::string key(reinterpret_cast<const char *>(initial_state), sizeof(Scalar) * n_x);
+        key.append(reinterpret_cast<const char *>(waypoints), sizeof(Scalar) * n_x * n_w);
+        return key;
+    }
+
+    /** The length of the path from the initial state through the waypoints, or 1 if it is zero */
+    static Scalar pathLength(const Scalar *initial_state, const Scalar *waypoints, Index n_w) {
+        Scalar length = 0;
+        Vector3 previous = Eigen::Map<const Vector3>(initial_state);
+        for (Index i_w = 0; i_w < n_w; ++i_w) {
+            const Vector3 position = Eigen::Map<const Vector3>(waypoints + n_x * i_w);
+            length += (position - previous).norm();
+            previous = position;
+        }
+        return length > 0 ? length : Scalar(1);
+    }
+
+    /** The descriptor of a mission: the initial velocity, and the positions and velocities of the waypoints,
+     * normalized as described above. Its size is 3 + n_x * n_w. */
+    static std::vector<Scalar> descriptor(const Scalar *initial_state, const Scalar *waypoints, Index n_w) {
+        const Scalar length = pathLength(initial_state, waypoints, n_w);
+        const Scalar speed = std::sqrt(length);
+        const Vector3 start = Eigen::Map<const Vector3>(initial_state);
+        std::vector<Scalar> result(3 + n_x * n_w);
+        Eigen::Map<Vector3>(result.data()) = Eigen::Map<const Vector3>(initial_state + 3) / speed;
+        for (Index i_w = 0; i_w < n_w; ++i_w) {
+            Eigen::Map<Vector3> position(result.data() + 3 + n_x * i_w);
+            Eigen::Map<Vector3> velocity(result.data() + 6 + n_x * i_w);
+            position = (Eigen::Map<const Vector3>(waypoints + n_x * i_w) - start) / length;
+            velocity = Eigen::Map<const Vector3>(waypoints + n_x * i_w + 3) / speed;
+        }
+        return result;
+    }
+
+    /** Add the record at offset to the indices, and return the k-d tree that it went into,
+     * which must be built before the next lookup */
+    KdTree<Scalar, uint64_t> &index(uint64_t offset) {
+        const Record r = record(offset);
+        const Index n_w = r.header->n_w;
+        exact[missionKey(r.initial_state, r.waypoints, n_w)] = offset;
+        auto tree = trees.find(n_w);
+        if (tree == trees.end())
+            tree = trees.emplace(n_w, KdTree<Scalar, uint64_t>(3 + n_x * n_w)).first;
+        tree->second.append(descriptor(r.initial_state, r.waypoints, n_w).data(), offset);
+        return tree->second;
+    }
+
+public:
+
+    /** The result of a lookup */
+    struct Match {
+        bool found = false;
+        /** True if the stored mission is the same as the new one, so the solution was not changed */
+        bool exact = false;
+        /** The distance between the descriptors of the missions */
+        Scalar distance = 0;
+        /** The time that the stored solve took */
+        double solve_seconds = 0;
+    };
+
+    SolutionLibrary() = default;
+
+    SolutionLibrary(const SolutionLibrary &) = delete;
+
+    SolutionLibrary &operator=(const SolutionLibrary &) = delete;
+
+    ~SolutionLibrary() {
+        close();
+    }
+
+    /** Open the library at path, creating it if it does not exist, and index its records.
+     * Return false if the file cannot be mapped, was written with other sizes, or holds a damaged record. */
+    bool open(const std::string &path) {
+        close();
+        file = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (file < 0)
+            return false;
+
+        struct stat status;
+        if (fstat(file, &status) != 0 || !reserve(std::max<size_t>(status.st_size, sizeof(FileHeader)))) {
+            close();
+            return false;
+        }
+
+        static const char magic[8] = {'T', 'R', 'A', 'J', 'L', 'I', 'B', '\0'};
+        if (status.st_size == 0) {
+            FileHeader &h = header();
+            std::memcpy(h.magic, magic, sizeof(magic));
+            h.version = version;
+            h.scalar_size = sizeof(Scalar);
+            h.state_size = n_x;
+            h.control_size = n_u;
+            h.used = sizeof(FileHeader);
+            h.count = 0;
+        }
+
+        const FileHeader &h = header();
+        if (std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.version != version
+            || h.scalar_size != sizeof(Scalar) || h.state_size != n_x || h.control_size != n_u
+            || h.used < sizeof(FileHeader) || h.used > capacity) {
+            close();
+            return false;
+        }
+
+        /* Load all of the records before building each tree once */
+        uint64_t offset = sizeof(FileHeader);
+        for (uint64_t i = 0; i < h.count; ++i) {
+            if (!isValidRecord(offset)) {
+                close();
+                return false;
+            }
+            index(offset);
+            offset += record(offset).header->size;
+        }
+        for (auto &tree : trees)
+            tree.second.build();
+        return true;
+    }
+
+    void close() {
+        if (memory)
+            munmap(memory, capacity);
+        if (file >= 0)
+            ::close(file);
+        memory = nullptr;
+        capacity = 0;
+        file = -1;
+        exact.clear();
+        trees.clear();
+    }
+
+    bool isOpen() const {
+        return memory != nullptr;
+    }
+
+    /** The number of stored solutions */
+    Index size() const {
+        return isOpen() ? Index(header().count) : 0;
+    }
+
+    /** Store the solution of the problem, and the time that the solve took. Return false on failure. */
+    bool insert(const Problem &problem, const Solution &solution, double solve_seconds) {
+        if (!isOpen())
+            return false;
+
+        const uint64_t n_w = problem.n_w();
+        const uint64_t n_vars = solution.x.size();
+        if (n_w == 0 || solution.node_counts.size() != n_w || Index(n_vars) != solution.layout().n_vars)
+            return false;
+        const uint64_t size = recordSize(n_w, n_vars);
+        const uint64_t offset = header().used;
+        if (!reserve(offset + size))
+            return false;
+
+        RecordHeader *h = reinterpret_cast<RecordHeader *>(memory + offset);
+        h->size = size;
+        h->n_w = n_w;
+        h->n_vars = n_vars;
+        h->status = solution.status;
+        h->cost = solution.cost;
+        h->solve_seconds = solve_seconds;
+
+        Scalar *initial_state = reinterpret_cast<Scalar *>(h + 1);
+        Scalar *waypoints = initial_state + n_x;
+        uint64_t *node_counts = reinterpret_cast<uint64_t *>(waypoints + n_x * n_w);
+        Scalar *x = reinterpret_cast<Scalar *>(node_counts + n_w);
+        std::copy(problem.initial_state.data(), problem.initial_state.data() + n_x, initial_state);
+        std::copy(problem.waypoints.data(), problem.waypoints.data() + n_x * n_w, waypoints);
+        std::copy(solution.node_counts.begin(), solution.node_counts.end(), node_counts);
+        std::copy(solution.x.data(), solution.x.data() + n_vars, x);
+
+        /* Only count the record once it is complete */
+        header().used = offset + size;
+        header().count += 1;
+        index(offset).build();
+        return true;
+    }
+
+    /**
+     * Find the stored mission that is nearest to the problem, with the same number of waypoints, and map
+     * its solution onto the problem as described above. The multipliers of warm_start are left empty.
+     */
+    Match lookup(const Problem &problem, Solution &warm_start) const {
+        Match match;
+        if (!isOpen())
+            return match;
+
+        const Index n_w = problem.n_w();
+        const State initial_state = problem.initial_state;
+        const Eigen::Matrix<Scalar, n_x, Eigen::Dynamic> waypoints = problem.waypoints;
+
+        uint64_t offset = 0;
+        auto repeat = exact.find(missionKey(initial_state.data(), waypoints.data(), n_w));
+        if (repeat != exact.end()) {
+            offset = repeat->second;
+            match.exact = true;
+        } else {
+            auto tree = trees.find(n_w);
+            Scalar squared_distance = 0;
+            if (tree == trees.end()
+                || !tree->second.nearest(descriptor(initial_state.data(), waypoints.data(), n_w).data(),
+                                         offset, squared_distance))
+                return match;
+            match.distance = std::sqrt(squared_distance);
+        }
+
+        const Record r = record(offset);
+        match.found = true;
+        match.solve_seconds = r.header->solve_seconds;
+
+        const Index n_vars = r.header->n_vars;
+        warm_start.status = static_cast<typename Solution::Result::status_type>(r.header->status);
+        warm_start.cost = r.header->cost;
+        warm_start.node_counts.assign(r.node_counts, r.node_counts + n_w);
+        warm_start.x = Eigen::Map<const TrajectoryVector<Scalar>>(r.x, n_vars);
+        warm_start.z_lower.resize(0);
+        warm_start.z_upper.resize(0);
+        warm_start.lambda.resize(0);
+        if (match.exact)
+            return match;
+
+        const Scalar ratio = pathLength(initial_state.data(), waypoints.data(), n_w)
+                             / pathLength(r.initial_state, r.waypoints, n_w);
+        const Scalar time_ratio = std::sqrt(ratio);
+        const Vector3 old_start = Eigen::Map<const Vector3>(r.initial_state);
+        const Vector3 new_start = initial_state.template head<3>();
+
+        const auto get = warm_start.layout();
+        for (Index i_w = 0; i_w < n_w; ++i_w) {
+            auto states = get.statesAtWaypoint(warm_start.x.data(), i_w);
+            states.template topRows<3>() =
+                ((states.template topRows<3>().colwise() - old_start) * ratio).colwise() + new_start;
+            states.template bottomRows<3>() *= time_ratio;
+        }
+        get.times(warm_start.x.data()) *= time_ratio;
+        warm_start.cost *= time_ratio;
+        return match;
+    }
+
+    /** Look up the problem, and if a stored solution was found, make it the WarmStart guess of the problem */
+    Match warmStart(Problem &problem) const {
+        Solution warm_start;
+        const Match match = lookup(problem, warm_start);
+        if (match.found) {
+            problem.guess = InitialGuess::WarmStart;
+            problem.warm_start = warm_start.x;
+            problem.warm_start_node_counts = warm_start.node_counts;
+        }
+        return match;
+    }
+};
+
+#endif /* SOLUTION_LIBRARY_HEADER */
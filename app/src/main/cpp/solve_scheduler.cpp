@@ -0,0 +1,115 @@
+#include "solve_scheduler.h"
+
+#include <chrono>
+#include <utility>
+
+SolveScheduler::SolveScheduler(WorkStealingPool &pool, TrajectorySolver solver)
+        : pool(pool),
+          solver(std::move(solver)) {
+}
+
+SolveScheduler::~SolveScheduler() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (auto &entry : jobs)
+        stop(*entry.second, JobState::Cancelled);
+    changed.wait(lock, [this] { return in_pool == 0; });
+}
+
+void SolveScheduler::stop(Job &job, JobState state) {
+    job.control.cancel();
+    if (job.state == JobState::Queued) {
+        job.state = state;
+        job.returned = true;
+    } else if (job.state == JobState::Running && state == JobState::Superseded)
+        job.state = state;
+}
+
+SolveScheduler::Handle SolveScheduler::submit(size_t vehicle,
+                                              const QuadrotorProblem &problem,
+                                              size_t n_c,
+                                              const std::string &options,
+                                              SolveControl::Progress progress) {
+    auto job = std::make_shared<Job>();
+    job->vehicle = vehicle;
+    job->control.setProgress(std::move(progress));
+
+    Handle handle;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        handle = next_handle++;
+
+        auto previous = latest.find(vehicle);
+        if (previous != latest.end()) {
+            auto previous_job = jobs.find(previous->second);
+            if (previous_job != jobs.end())
+                stop(*previous_job->second, JobState::Superseded);
+        }
+        latest[vehicle] = handle;
+        jobs[handle] = job;
+        ++in_pool;
+    }
+    changed.notify_all();
+
+    pool.submit([this, job, problem, n_c, options] { run(job, problem, n_c, options); });
+    return handle;
+}
+
+void SolveScheduler::run(const std::shared_ptr<Job> &job,
+                         const QuadrotorProblem &problem,
+                         size_t n_c,
+                         const std::string &options) {
+    bool skip;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        skip = job->state != JobState::Queued;
+        if (!skip)
+            job->state = JobState::Running;
+    }
+    changed.notify_all();
+
+    /* The solution is only written here, and only read once the state says that the job is done */
+    if (!skip)
+        job->solution = solver(problem, n_c, options, &job->control);
+
+    /* Notify before unlocking, since the destructor may return and destroy changed as soon as in_pool is zero */
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!skip && job->state == JobState::Running)
+        job->state = job->control.isCancelled() ? JobState::Cancelled : JobState::Finished;
+    job->returned = true;
+    --in_pool;
+    changed.notify_all();
+}
+
+bool SolveScheduler::cancel(Handle handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto job = jobs.find(handle);
+    if (job == jobs.end() || job->second->returned)
+        return false;
+    stop(*job->second, JobState::Cancelled);
+    return true;
+}
+
+JobState SolveScheduler::waitFor(Handle handle, double seconds, QuadrotorSolution *solution) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto found = jobs.find(handle);
+    if (found == jobs.end())
+        return JobState::Unknown;
+    const std::shared_ptr<Job> job = found->second;
+
+    changed.wait_for(lock, std::chrono::duration<double>(seconds), [&job] { return job->returned; });
+    if (solution && job->returned)
+        *solution = job->solution;
+    return job->state;
+}
+
+void SolveScheduler::release(Handle handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto job = jobs.find(handle);
+    if (job == jobs.end())
+        return;
+    stop(*job->second, JobState::Cancelled);
+    auto vehicle = latest.find(job->second->vehicle);
+    if (vehicle != latest.end() && vehicle->second == handle)
+        latest.erase(vehicle);
+    jobs.erase(job);
+}
@@ -0,0 +1,110 @@
+#ifndef SOLVE_SCHEDULER_HEADER
+#define SOLVE_SCHEDULER_HEADER
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "trajectory_solver.h"
+#include "work_stealing_pool.h"
+
+/** Where a job of the SolveScheduler is */
+enum class JobState {
+    /** Waiting for a worker */
+    Queued,
+    Running,
+    /** The solve returned on its own, whatever its status */
+    Finished,
+    /** Stopped or skipped by cancel */
+    Cancelled,
+    /** Stopped or skipped because a newer job was submitted for the same vehicle */
+    Superseded,
+    /** The handle was never returned by submit, or it was released */
+    Unknown
+};
+
+/**
+ * Runs solves on the workers of a pool without blocking the callers. Each job belongs to a vehicle, and a new
+ * job for a vehicle supersedes the job before it: if that one has not started it is skipped, and otherwise it
+ * is stopped at its next Ipopt iteration, so stale solves do not hold on to a worker.
+ *
+ * Jobs and their solutions are kept until they are released. All of the methods may be called from any
+ * thread except the workers of the pool. See solveBatch for the requirements on the pool.
+ */
+class SolveScheduler {
+public:
+
+    using Handle = size_t;
+
+private:
+
+    struct Job {
+        size_t vehicle;
+        JobState state = JobState::Queued;
+        /** True once the worker will not touch the job again, so its solution can be read */
+        bool returned = false;
+        SolveControl control;
+        QuadrotorSolution solution;
+    };
+
+    WorkStealingPool &pool;
+
+    const TrajectorySolver solver;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    std::map<Handle, std::shared_ptr<Job>> jobs;
+
+    /** The latest job of each vehicle */
+    std::map<size_t, Handle> latest;
+
+    Handle next_handle = 1;
+
+    /** The jobs that were submitted to the pool and have not returned from it */
+    size_t in_pool = 0;
+
+    void run(const std::shared_ptr<Job> &job, const QuadrotorProblem &problem, size_t n_c, const std::string &options);
+
+    /** Stop the job, and mark it with state unless it is already done. The mutex must be held. */
+    static void stop(Job &job, JobState state);
+
+public:
+
+    /** Run the jobs on the pool, each of them with solver */
+    explicit SolveScheduler(WorkStealingPool &pool, TrajectorySolver solver = solveTrajectory);
+
+    SolveScheduler(const SolveScheduler &) = delete;
+
+    SolveScheduler &operator=(const SolveScheduler &) = delete;
+
+    /** Cancel every job, and wait until the workers have let go of them */
+    ~SolveScheduler();
+
+    /**
+     * Queue a solve of the problem for the vehicle, and supersede the previous job of that vehicle.
+     * If given, progress is called on the worker after every Ipopt iteration, so it should be quick.
+     */
+    Handle submit(size_t vehicle,
+                  const QuadrotorProblem &problem,
+                  size_t n_c,
+                  const std::string &options,
+                  SolveControl::Progress progress = SolveControl::Progress());
+
+    /** Skip the job, or stop it at its next iteration. Return false if it had already returned. */
+    bool cancel(Handle handle);
+
+    /**
+     * Wait up to the given number of seconds for the job to return from its worker, and return its state.
+     * A superseded or cancelled job reports that state at once, but a running one returns at its next iteration.
+     * If the job has returned and solution is given, copy the solution there (a stopped solve keeps
+     * its last iterate, and a skipped one has status not_defined).
+     */
+    JobState waitFor(Handle handle, double seconds, QuadrotorSolution *solution = nullptr);
+
+    /** Forget the job, cancelling it if it is still queued or running */
+    void release(Handle handle);
+};
+
+#endif /* SOLVE_SCHEDULER_HEADER */
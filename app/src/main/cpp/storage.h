@@ -0,0 +1,48 @@
+#ifndef STORAGE_HEADER
+#define STORAGE_HEADER
+
+#include <cstddef>
+#include <type_traits>
+#include "Eigen/Dense"
+
+/*
+ * These policies decide where the large buffers of the FusedConstraint and the LagrangeDerivatives live.
+ * Each one defines a template alias
+ *
+ * Storage::Matrix<Scalar, rows, cols>
+ *
+ * that is either a fixed-size Eigen matrix, stored inline, or a dynamic Eigen matrix, stored in an aligned
+ * heap allocation. Both have the same accessors, so the classes using them do not care which one they get.
+ * Always create these matrices with their sizes, for example Matrix::Zero(rows, cols), since a dynamic
+ * matrix does not know its size otherwise.
+ */
+
+/** Store the matrix inline. This is the fastest option for small problems, but the object becomes as
+ * large as the matrix, which is copied by value and may overflow the stack for long missions. */
+struct InlineStorage {
+
+    template<typename Scalar, int rows, int cols>
+    using Matrix = Eigen::Matrix<Scalar, rows, cols>;
+};
+
+/** Store the matrix on the heap, using Eigen's aligned allocator. Vectors stay vectors. */
+struct HeapStorage {
+
+    template<typename Scalar, int rows, int cols>
+    using Matrix = Eigen::Matrix<Scalar, rows == 1 ? 1 : Eigen::Dynamic, cols == 1 ? 1 : Eigen::Dynamic>;
+};
+
+/** Store the matrix inline if it takes at most max_inline_bytes, and on the heap otherwise.
+ * The default keeps well below Eigen's static allocation limit (EIGEN_STACK_ALLOCATION_LIMIT),
+ * even with a few of these matrices on the stack at once. */
+template<std::size_t max_inline_bytes = 16384>
+struct AutoStorage {
+
+    template<typename Scalar, int rows, int cols>
+    using Matrix = typename std::conditional<
+        static_cast<std::size_t>(rows) * static_cast<std::size_t>(cols) * sizeof(Scalar) <= max_inline_bytes,
+        InlineStorage::Matrix<Scalar, rows, cols>,
+        HeapStorage::Matrix<Scalar, rows, cols>>::type;
+};
+
+#endif /* STORAGE_HEADER */
@@ -10,22 +10,48 @@ using std::endl;
 #include <vector>
 #include <tuple>
 #include <array>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <atomic>
+#include <functional>
+#include <set>
+#include <stdexcept>
+#include <thread>
 
 /* Our classes */
 #include "equality_constraint.h"
 #include "inequality_constraint.h"
 #include "fused_contraint.h"
 #include "variable_getter.h"
+#include "reduced_control_variable_getter.h"
 #include "fg_eval.h"
 
 #include "collocation_constraints.h"
+#include "control_derivative_constraints.h"
 #include "control_rate_constraints.h"
 #include "dynamics_constraints.h"
 #include "initial_state_constraints.h"
+#include "local_control_rate_constraints.h"
+#include "local_dynamics_constraints.h"
+#include "multiple_shooting.h"
 #include "smooth_control_constraints.h"
 #include "waypoint_constraint.h"
 #include "waypoint_constraints.h"
 
+#include "async_log.h"
+#include "batch_solver.h"
+#include "mesh_refinement.h"
+#include "portfolio_solver.h"
+#include "presolve.h"
+#include "solution_library.h"
+#include "trajectory_solver.h"
+#include "trajectory_file.h"
+#include "trajectory_sampler.h"
+#include "solve_scheduler.h"
+
 /* Eigen */
 #include "Eigen/Dense"
 
@@ -40,6 +66,1704 @@ using Array = Eigen::Matrix<Scalar, size, 1>;
 template<typename T>
 using Vector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
 
+/* The number of checks that failed */
+int failures = 0;
+
+/** Print whether the condition holds, and count it if it does not */
+void check(bool condition, const std::string &name) {
+    cout << (condition ? "PASS: " : "FAIL: ") << name << endl;
+    if (!condition)
+        ++failures;
+}
+
+/** Return true if the two vectors agree to within tolerance */
+template<typename A, typename B>
+bool near(const A &a, const B &b, Scalar tolerance = 1e-9) {
+    return a.size() == b.size() && (a - b).template lpNorm<Eigen::Infinity>() <= tolerance;
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Presolve
+ *
+ * ----------------------------------------------
+ */
+
+/**
+ * A small problem that exercises each rule of the Presolve:
+ *
+ * min  (x3 - 1)^2 + x4^2 + x2 x3 + x1^2 + x0 x2 + x1 x4
+ * s.t. x1 - 2 x0 = 0       determines x1, once x0 is fixed by its bounds
+ *      x1 + x2 = 5         determines x2, but only after x1 was eliminated
+ *      x3 + x4 = 1         has two free variables, so it is kept
+ *      x0 = 1              by its bounds
+ *
+ * The solution is x = (1, 2, 3, 0.75, 0.25) with lambda = (-2.5, -1.75, -2.5),
+ * and the lower bound of x0 has the multiplier 8.
+ */
+struct PresolveTestFG {
+
+    using ADvector = Vector<ADScalar>;
+
+    void operator()(ADvector &fg, const ADvector &x) {
+        fg[0] = (x[3] - 1) * (x[3] - 1) + x[4] * x[4] + x[2] * x[3] + x[1] * x[1] + x[0] * x[2] + x[1] * x[4];
+        fg[1] = x[1] - 2 * x[0];
+        fg[2] = x[1] + x[2];
+        fg[3] = x[3] + x[4];
+    }
+};
+
+/**
+ * Solve a problem with a quadratic objective and linear equality constraints, starting from x,
+ * by a single Newton step on its KKT conditions.
+ */
+template<typename FG>
+void solveEqualityQP(FG &fg_eval, const Vector<Scalar> &x, const Vector<Scalar> &g_bound,
+                     CppAD::ipopt::solve_result<Vector<Scalar>> &solution) {
+    const Index n = x.size();
+    const Index m = g_bound.size();
+
+    Vector<ADScalar> ax = x.cast<ADScalar>();
+    CppAD::Independent(ax);
+    Vector<ADScalar> afg(1 + m);
+    fg_eval(afg, ax);
+    CppAD::ADFun<Scalar> fun(ax, afg);
+
+    Vector<Scalar> fg = fun.Forward(0, x);
+    Vector<Scalar> weights = Vector<Scalar>::Zero(1 + m);
+    weights[0] = 1;
+    const Vector<Scalar> hessian = fun.Hessian(x, weights);
+    const Vector<Scalar> jacobian = fun.Jacobian(x);
+
+    /* [ H  J^T ] [ dx     ]   [ -grad f ]
+     * [ J   0  ] [ lambda ] = [ b - g   ] */
+    Eigen::MatrixXd kkt = Eigen::MatrixXd::Zero(n + m, n + m);
+    Vector<Scalar> rhs(n + m);
+    for (Index j = 0; j < n; ++j) {
+        for (Index k = 0; k < n; ++k)
+            kkt(j, k) = hessian[j * n + k];
+        rhs[j] = -jacobian[j];
+    }
+    for (Index i = 0; i < m; ++i) {
+        for (Index j = 0; j < n; ++j)
+            kkt(n + i, j) = kkt(j, n + i) = jacobian[(1 + i) * n + j];
+        rhs[n + i] = g_bound[i] - fg[1 + i];
+    }
+    const Vector<Scalar> step = kkt.fullPivLu().solve(rhs);
+
+    solution.status = CppAD::ipopt::solve_result<Vector<Scalar>>::success;
+    solution.x = x + step.head(n);
+    solution.lambda = step.tail(m);
+    solution.zl = Vector<Scalar>::Zero(n);
+    solution.zu = Vector<Scalar>::Zero(n);
+    solution.g = fun.Forward(0, solution.x).tail(m);
+    solution.obj_value = fun.Forward(0, solution.x)[0];
+}
+
+/**
+ * Solve the reduced problem of the Presolve, expand its solution, and compare it with the solution
+ * of the full problem, including the multipliers that expand recovers for the removed rows and bounds.
+ */
+void testPresolve() {
+    using Dvector = Vector<Scalar>;
+
+    const Scalar inf = std::numeric_limits<Scalar>::infinity();
+    Dvector xi = Dvector::Zero(5);
+    Dvector xl = Dvector::Constant(5, -inf);
+    Dvector xu = Dvector::Constant(5, inf);
+    xi[0] = xl[0] = xu[0] = 1;
+    Dvector gl(3);
+    gl << 0, 5, 1;
+    const Dvector gu = gl;
+
+    PresolveTestFG fg_eval;
+    Presolve<Dvector, PresolveTestFG> presolve(fg_eval, xi, xl, xu, gl, gu);
+    check(presolve.removedVariables() == 3, "presolve removes x0, x1 and x2");
+    check(presolve.removedConstraints() == 2, "presolve removes the two rows that determined them");
+    check(presolve.xi.size() == 2 && presolve.gl.size() == 1, "presolve leaves two variables and one row");
+
+    CppAD::ipopt::solve_result<Dvector> reduced;
+    solveEqualityQP(presolve.reduced_fg, presolve.xi, presolve.gl, reduced);
+    CppAD::ipopt::solve_result<Dvector> full;
+    presolve.expand(reduced, full);
+
+    Dvector x(5);
+    x << 1, 2, 3, 0.75, 0.25;
+    Dvector lambda(3);
+    lambda << -2.5, -1.75, -2.5;
+    Dvector zl = Dvector::Zero(5);
+    zl[0] = 8;
+    check(near(full.x, x), "presolve recovers the eliminated variables");
+    check(near(full.g, gl), "presolve solution is feasible in the full problem");
+    check(near(full.lambda, lambda), "presolve recovers the multipliers of the eliminated rows");
+    check(near(full.zl, zl) && near(full.zu, Dvector::Zero(5)), "presolve recovers the multiplier of the fixed bound");
+
+    /* The same solution as the unreduced problem, with the bound of x0 as an equality row */
+    struct Unreduced {
+        using ADvector = Vector<ADScalar>;
+        PresolveTestFG fg_eval;
+        void operator()(ADvector &fg, const ADvector &x) {
+            ADvector head(4);
+            fg_eval(head, x);
+            fg.head(4) = head;
+            fg[4] = x[0];
+        }
+    } unreduced;
+    Dvector bound(4);
+    bound << gl, 1;
+    CppAD::ipopt::solve_result<Dvector> direct;
+    solveEqualityQP(unreduced, xi, bound, direct);
+    check(near(full.x, direct.x), "presolved solve matches the unreduced solve");
+    check(near(full.lambda, direct.lambda.head(3)), "presolved multipliers match the unreduced solve");
+    check(std::abs(full.zl[0] - full.zu[0] + direct.lambda[3]) <= 1e-9,
+          "presolved bound multiplier matches the unreduced solve");
+    check(std::abs(full.obj_value - direct.obj_value) <= 1e-9, "presolved objective matches the unreduced solve");
+
+    /* A solve that stopped before producing a solution leaves the initial guess and no multipliers */
+    CppAD::ipopt::solve_result<Dvector> unsolved;
+    unsolved.status = CppAD::ipopt::solve_result<Dvector>::unknown;
+    CppAD::ipopt::solve_result<Dvector> guess;
+    presolve.expand(unsolved, guess);
+    Dvector x_guess(5);
+    x_guess << 1, 2, 3, 0, 0;
+    check(guess.status == unsolved.status && near(guess.x, x_guess),
+          "presolve expands an empty solution to the initial guess");
+    check(guess.g.size() == 3 && near(guess.lambda, Dvector::Zero(3)) && near(guess.zl, Dvector::Zero(5))
+          && near(guess.zu, Dvector::Zero(5)), "presolve gives an empty solution zero multipliers");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Fixed-size kernels
+ *
+ * ----------------------------------------------
+ */
+
+/** A mission for the quadrotor with the waypoints of this tester */
+QuadrotorProblem testProblem(Index n_w) {
+    const Scalar degrees = M_PI / 180;
+    QuadrotorProblem problem;
+    problem.initial_state << 0.1, -0.2, 0.3, 0.5, -0.5, 0.25;
+    problem.waypoints.resize(QuadrotorProblem::State::RowsAtCompileTime, n_w);
+    for (Index i_w = 0; i_w < n_w; ++i_w)
+        problem.waypoints.col(i_w) << 2.0 * (i_w + 1), i_w % 2 ? -2.0 : 2.0, -1.0, 0.0, 0.0, 0.0;
+    problem.control_rate_upper << 20, 30 * degrees, 30 * degrees, 30 * degrees;
+    problem.control_rate_lower = -problem.control_rate_upper;
+    problem.state_lower.setConstant(-10);
+    problem.state_upper.setConstant(10);
+    problem.control_lower.setConstant(-5);
+    problem.control_upper.setConstant(5);
+    problem.time_lower = 0.1;
+    problem.time_upper = 10;
+    return problem;
+}
+
+/** Evaluate fg_eval at x, without recording */
+template<typename FG>
+Vector<Scalar> evaluateFG(FG &fg_eval, const Vector<Scalar> &x, Index n_constraints) {
+    Vector<ADScalar> fg(1 + n_constraints);
+    fg_eval(fg, Vector<ADScalar>(x.cast<ADScalar>()));
+    Vector<Scalar> values(fg.size());
+    for (Index i = 0; i < Index(fg.size()); ++i)
+        values[i] = CppAD::Value(fg[i]);
+    return values;
+}
+
+/* The kernel that testFixedKernel compares with the runtime path must be one that solveTrajectory dispatches to */
+#define TEST_KERNEL_MATCHES(n_c, n_w) || (n_c == 7 && n_w == 3)
+static_assert(false TRAJECTORY_KERNELS(TEST_KERNEL_MATCHES), "7 x 3 is no longer a fixed-size kernel");
+#undef TEST_KERNEL_MATCHES
+
+/**
+ * Evaluate a fixed-size kernel, with its shared nodes and waypoint-major order, and the runtime transcription
+ * of the same mission at the same point, and compare the cost and every row after mapping them to the
+ * runtime layout. The collocation rows of the runtime path must vanish, since both copies of each shared
+ * node hold the same values.
+ */
+void testFixedKernel() {
+    const Index n_c = 7;
+    const Index n_w = 3;
+    using Fixed = FixedTranscription<Scalar, Index, QuadrotorDynamics<Scalar>::n_x, QuadrotorDynamics<Scalar>::n_u, n_c, n_w>;
+    using Runtime = RuntimeTranscription<Scalar, Index, QuadrotorDynamics<Scalar>::n_x, QuadrotorDynamics<Scalar>::n_u>;
+
+    const QuadrotorProblem problem = testProblem(n_w);
+    const typename Fixed::RuntimeGet get(n_c, n_w);
+    Fixed fixed(problem);
+    Runtime runtime(problem, get);
+
+    Vector<Scalar> x = Vector<Scalar>::Random(+Fixed::Get::n_vars);
+    Fixed::Get::times(x.data()) = Fixed::Get::times(x.data()).cwiseAbs().array() + 0.5;
+    Vector<Scalar> runtime_x(get.n_vars);
+    Fixed::toRuntimeLayout(get, x.data(), runtime_x.data());
+
+    Vector<Scalar> round_trip(+Fixed::Get::n_vars);
+    Fixed::fromRuntimeLayout(get, runtime_x.data(), round_trip.data());
+    check(round_trip == x, "fixed kernel layout maps to the runtime layout and back");
+
+    const Index n_fixed = Fixed::Fused::n_constraints;
+    const Index n_collocation = runtime.n_collocation_rows;
+    const Index n_runtime = runtime.fused_constraints.n_constraints;
+    check(n_runtime == n_fixed + n_collocation, "fixed kernel has the runtime rows without the collocation rows");
+    if (n_runtime != n_fixed + n_collocation)
+        return;
+
+    const Vector<Scalar> fixed_fg = evaluateFG(fixed.fg_eval, x, n_fixed);
+    const Vector<Scalar> runtime_fg = evaluateFG(runtime.fg_eval, runtime_x, n_runtime);
+    check(std::abs(fixed_fg[0] - runtime_fg[0]) <= 1e-12, "fixed kernel has the cost of the runtime path");
+    check(near(runtime_fg.segment(1, n_collocation), Vector<Scalar>::Zero(n_collocation), 0),
+          "runtime collocation rows vanish at a fixed kernel point");
+    check(near(fixed_fg.tail(n_fixed), runtime_fg.tail(n_fixed), 1e-10), "fixed kernel rows match the runtime rows");
+    check(near(fixed.fused_constraints.lower_bound, runtime.fused_constraints.lower_bound.tail(n_fixed), 0)
+          && near(fixed.fused_constraints.upper_bound, runtime.fused_constraints.upper_bound.tail(n_fixed), 0),
+          "fixed kernel row bounds match the runtime row bounds");
+}
+
+/** The gradient of the Lagrangian f + lambda^T g of fg_eval at x */
+template<typename FG>
+Vector<Scalar> lagrangianGradient(FG &fg_eval, const Vector<Scalar> &x, const Vector<Scalar> &lambda) {
+    Vector<ADScalar> ax = x.cast<ADScalar>();
+    CppAD::Independent(ax);
+    Vector<ADScalar> fg(1 + lambda.size());
+    fg_eval(fg, ax);
+    CppAD::ADFun<Scalar> fun(ax, fg);
+    Vector<Scalar> weights(1 + lambda.size());
+    weights << 1, lambda;
+    return fun.Reverse(1, weights);
+}
+
+/**
+ * Map the multipliers of a fixed-size kernel to the runtime rows, and check that this gives a stationary point
+ * of the runtime Lagrangian whenever the fixed one is: the gradient at the first copy of each shared node
+ * vanishes, and adding up both copies gives the gradient of the fixed Lagrangian.
+ */
+void testFixedMultipliers() {
+    const Index n_c = 7;
+    const Index n_w = 3;
+    using Fixed = FixedTranscription<Scalar, Index, QuadrotorDynamics<Scalar>::n_x, QuadrotorDynamics<Scalar>::n_u, n_c, n_w>;
+    using Runtime = RuntimeTranscription<Scalar, Index, QuadrotorDynamics<Scalar>::n_x, QuadrotorDynamics<Scalar>::n_u>;
+    using Get = typename Fixed::Get;
+
+    const QuadrotorProblem problem = testProblem(n_w);
+    const typename Fixed::RuntimeGet get(n_c, n_w);
+    Fixed fixed(problem);
+    Runtime runtime(problem, get);
+
+    Vector<Scalar> x = Vector<Scalar>::Random(+Get::n_vars);
+    Get::times(x.data()) = Get::times(x.data()).cwiseAbs().array() + 0.5;
+    Vector<Scalar> runtime_x(get.n_vars);
+    Fixed::toRuntimeLayout(get, x.data(), runtime_x.data());
+
+    const Vector<Scalar> lambda = Vector<Scalar>::Random(+Fixed::Fused::n_constraints);
+    const Vector<Scalar> runtime_lambda = Fixed::runtimeMultipliers(problem, get, runtime_x, lambda);
+    check(Index(runtime_lambda.size()) == runtime.fused_constraints.n_constraints
+          && runtime_lambda.tail(lambda.size()) == lambda, "fixed multipliers keep their rows in the runtime order");
+
+    const Vector<Scalar> fixed_gradient = lagrangianGradient(fixed.fg_eval, x, lambda);
+    const Vector<Scalar> runtime_gradient = lagrangianGradient(runtime.fg_eval, runtime_x, runtime_lambda);
+
+    Scalar first_copies = 0;
+    Vector<Scalar> folded = Vector<Scalar>::Zero(+Get::n_vars);
+    for (Index i_w = 0; i_w < n_w; ++i_w) {
+        Get::varsAtWaypoint(folded.data(), i_w) += get.varsAtWaypoint(runtime_gradient.data(), i_w);
+        if (i_w > 0)
+            first_copies = std::max(first_copies, get.varsAtWaypoint(runtime_gradient.data(), i_w).col(0).cwiseAbs().maxCoeff());
+    }
+    Get::times(folded.data()) = get.times(runtime_gradient.data());
+    check(first_copies <= 1e-10, "collocation multipliers make the runtime Lagrangian stationary at the first copies");
+    check(near(folded, fixed_gradient, 1e-10), "runtime Lagrangian gradient adds up to the fixed one");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Trajectory files
+ *
+ * ----------------------------------------------
+ */
+
+using QuadrotorFileWriter = TrajectoryFileWriter<Scalar, Index, QuadrotorDynamics<Scalar>::n_x, QuadrotorDynamics<Scalar>::n_u>;
+using QuadrotorFileReader = TrajectoryFileReader<Scalar, Index, QuadrotorDynamics<Scalar>::n_x, QuadrotorDynamics<Scalar>::n_u>;
+
+/** Write bytes to path, and return whether a reader accepts the file */
+bool readerAccepts(const std::string &path, const std::string &bytes) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+    QuadrotorFileReader reader;
+    return reader.open(path);
+}
+
+/**
+ * Append a replan with multipliers, read it back, and check that it comes back unchanged.
+ * Then damage its record header, and check that the reader refuses every damaged file.
+ */
+void testTrajectoryFile() {
+    const std::string path = "tester_trajectories.bin";
+    std::remove(path.c_str());
+
+    QuadrotorSolution solution;
+    solution.status = QuadrotorSolution::Result::success;
+    solution.cost = 3.5;
+    solution.node_counts = {4, 6, 5};
+    const auto get = solution.layout();
+    solution.x = Vector<Scalar>::Random(get.n_vars);
+    solution.z_lower = Vector<Scalar>::Random(get.n_vars);
+    solution.z_upper = Vector<Scalar>::Random(get.n_vars);
+    solution.lambda = Vector<Scalar>::Random(17);
+
+    TrajectoryFile::SolveStats stats;
+    stats.stamp = 12.25;
+    stats.iterations = 42;
+    {
+        QuadrotorFileWriter writer;
+        check(writer.open(path) && writer.append(solution, CollocationScheme::Uniform, stats, true),
+              "trajectory file appends a replan");
+    }
+
+    QuadrotorFileReader reader;
+    check(reader.open(path) && reader.size() == 1, "trajectory file reads back its replan");
+    if (!reader.isOpen() || reader.size() != 1)
+        return;
+    const QuadrotorSolution read = reader[0].solution();
+    check(read.status == solution.status && read.cost == solution.cost && read.node_counts == solution.node_counts
+          && reader[0].header().stamp == stats.stamp && reader[0].header().iterations == stats.iterations,
+          "trajectory file keeps the status, cost, node counts and stats");
+    check(read.x == solution.x && read.z_lower == solution.z_lower && read.z_upper == solution.z_upper
+          && read.lambda == solution.lambda, "trajectory file keeps the solution and its multipliers");
+    reader.close();
+
+    std::ifstream in(path, std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const size_t record = sizeof(TrajectoryFile::FileHeader);
+    using RecordHeader = TrajectoryFile::RecordHeader;
+    auto damaged = [&](size_t field, uint64_t value) {
+        std::string copy = bytes;
+        std::memcpy(&copy[record + field], &value, sizeof(value));
+        return copy;
+    };
+    const RecordHeader &h = *reinterpret_cast<const RecordHeader *>(&bytes[record]);
+
+    check(readerAccepts(path, bytes), "trajectory file reader accepts an undamaged copy");
+    check(!readerAccepts(path, bytes.substr(0, bytes.size() - 8)), "trajectory file reader refuses a truncated record");
+    check(!readerAccepts(path, damaged(offsetof(RecordHeader, size), 0)),
+          "trajectory file reader refuses a record of size zero");
+    check(!readerAccepts(path, damaged(offsetof(RecordHeader, size), sizeof(RecordHeader) - 8)),
+          "trajectory file reader refuses a record smaller than its header");
+    check(!readerAccepts(path, damaged(offsetof(RecordHeader, n_constraints), h.n_constraints - 1)),
+          "trajectory file reader refuses a record whose size does not match its sizes");
+    check(!readerAccepts(path, damaged(offsetof(RecordHeader, n_nodes), uint64_t(-1))),
+          "trajectory file reader refuses a record with an impossible node count");
+    check(!readerAccepts(path, damaged(sizeof(RecordHeader), 5)),
+          "trajectory file reader refuses node counts that do not add up");
+    std::remove(path.c_str());
+}
+
+using QuadrotorLibrary = SolutionLibrary<Scalar, Index, QuadrotorDynamics<Scalar>::n_x, QuadrotorDynamics<Scalar>::n_u>;
+
+/** Write the bytes to path, and return whether the library opens them */
+bool libraryAccepts(const std::string &path, const std::string &bytes) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+    QuadrotorLibrary library;
+    return library.open(path);
+}
+
+/**
+ * Insert a solution, reopen the library, and look up the same mission, a scaled copy of it, and a mission
+ * with another number of waypoints. The scaled copy must come back retimed, with the same accelerations.
+ * Then damage the record, and check that the library refuses to open every damaged file.
+ */
+void testSolutionLibrary() {
+    const std::string path = "tester_library.bin";
+    std::remove(path.c_str());
+
+    const QuadrotorProblem problem = testProblem(2);
+    QuadrotorSolution solution;
+    solution.status = QuadrotorSolution::Result::success;
+    solution.node_counts = {4, 5};
+    const auto get = solution.layout();
+    solution.x = Vector<Scalar>::Random(get.n_vars);
+    get.times(solution.x.data()) << 1.5, 2.5;
+    solution.cost = 4;
+    {
+        QuadrotorLibrary library;
+        QuadrotorSolution wrong_size = solution;
+        wrong_size.x.conservativeResize(get.n_vars - 1);
+        check(library.open(path) && library.size() == 0 && library.insert(problem, solution, 0.25)
+              && !library.insert(problem, wrong_size, 0.25) && library.size() == 1,
+              "solution library inserts a solution in the layout of its node counts");
+    }
+
+    QuadrotorLibrary library;
+    check(library.open(path) && library.size() == 1, "solution library reopens its records");
+
+    QuadrotorSolution found;
+    auto match = library.lookup(problem, found);
+    check(match.found && match.exact && match.solve_seconds == 0.25 && found.status == solution.status
+          && found.cost == solution.cost && found.node_counts == solution.node_counts && found.x == solution.x
+          && found.z_lower.size() == 0 && found.lambda.size() == 0, "solution library returns an exact repeat as is");
+
+    /* Four times the path, with twice the velocities, has the same descriptor and takes twice the time */
+    QuadrotorProblem scaled = problem;
+    const Eigen::Matrix<Scalar, 3, 1> start = problem.initial_state.head<3>();
+    scaled.initial_state.tail<3>() *= 2;
+    for (Index i_w = 0; i_w < problem.n_w(); ++i_w) {
+        scaled.waypoints.col(i_w).head<3>() = (problem.waypoints.col(i_w).head<3>() - start) * 4 + start;
+        scaled.waypoints.col(i_w).tail<3>() *= 2;
+    }
+    match = library.lookup(scaled, found);
+    Vector<Scalar> retimed = solution.x;
+    for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+        auto states = get.statesAtWaypoint(retimed.data(), i_w);
+        states.topRows<3>() = ((states.topRows<3>().colwise() - start) * 4).colwise() + start;
+        states.bottomRows<3>() *= 2;
+    }
+    get.times(retimed.data()) *= 2;
+    check(match.found && !match.exact && match.distance <= 1e-12 && near(found.x, retimed, 1e-12)
+          && std::abs(found.cost - 2 * solution.cost) <= 1e-12, "solution library retimes the nearest mission");
+
+    QuadrotorProblem warm = scaled;
+    check(library.warmStart(warm).found && warm.guess == InitialGuess::WarmStart && warm.warm_start == found.x
+          && warm.warm_start_node_counts == solution.node_counts, "solution library warm starts the problem");
+    check(!library.lookup(testProblem(3), found).found, "solution library only matches the same number of waypoints");
+    library.close();
+
+    std::ifstream in(path, std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    const size_t record = sizeof(QuadrotorLibrary::FileHeader);
+    using RecordHeader = QuadrotorLibrary::RecordHeader;
+    auto damaged = [&](size_t position, uint64_t value) {
+        std::string copy = bytes;
+        std::memcpy(&copy[position], &value, sizeof(value));
+        return copy;
+    };
+    const Index node_counts = record + sizeof(RecordHeader) + sizeof(Scalar) * 6 * (problem.n_w() + 1);
+
+    check(libraryAccepts(path, bytes), "solution library accepts an undamaged copy");
+    check(!libraryAccepts(path, damaged(offsetof(QuadrotorLibrary::FileHeader, count), 2)),
+          "solution library refuses a header that counts more records than it holds");
+    check(!libraryAccepts(path, damaged(record + offsetof(RecordHeader, size), 0)),
+          "solution library refuses a record of size zero");
+    check(!libraryAccepts(path, damaged(record + offsetof(RecordHeader, n_w), uint64_t(-1))),
+          "solution library refuses a record with an impossible number of waypoints");
+    check(!libraryAccepts(path, damaged(record + offsetof(RecordHeader, n_vars), get.n_vars - 1)),
+          "solution library refuses a record whose size does not match its sizes");
+    check(!libraryAccepts(path, damaged(node_counts, 5)),
+          "solution library refuses node counts that do not match x");
+    std::remove(path.c_str());
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Trajectory sampler
+ *
+ * ----------------------------------------------
+ */
+
+using QuadrotorSampler = TrajectorySampler<Scalar, Index, QuadrotorDynamics<Scalar>::n_x, QuadrotorDynamics<Scalar>::n_u>;
+
+/** A polynomial of degree 5 in t for each variable, and its derivatives */
+struct QuinticPolynomials {
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 6> coefficients;
+
+    explicit QuinticPolynomials(Index n_vars) : coefficients(Eigen::Matrix<Scalar, Eigen::Dynamic, 6>::Random(n_vars, 6)) {
+    }
+
+    Vector<Scalar> operator()(Scalar t) const {
+        Vector<Scalar> value = coefficients.col(5);
+        for (Index k = 5; k-- > 0;)
+            value = value * t + coefficients.col(k);
+        return value;
+    }
+
+    Vector<Scalar> derivative(Scalar t, Index order = 1) const {
+        Vector<Scalar> value = Vector<Scalar>::Zero(coefficients.rows());
+        for (Index k = 6; k-- > order;) {
+            Scalar factor = 1;
+            for (Index m = 0; m < order; ++m)
+                factor *= Scalar(k - m);
+            value = value * t + factor * coefficients.col(k);
+        }
+        return value;
+    }
+};
+
+/**
+ * Sample a trajectory whose nodes lie on polynomials of degree 5, with six points per waypoint so that the
+ * interpolant is exact, and a waypoint in the middle and one at the end that take no time. Every sample, including
+ * the times before and after the trajectory and the ends of the empty waypoints, must match the polynomials.
+ */
+void testTrajectorySampler() {
+    const Index n_x = QuadrotorDynamics<Scalar>::n_x;
+    const Index n_u = QuadrotorDynamics<Scalar>::n_u;
+    const CollocationScheme scheme = CollocationScheme::LegendreGaussLobatto;
+
+    QuadrotorSolution solution;
+    solution.node_counts = {6, 6, 7, 6};
+    const auto get = solution.layout();
+    solution.x.resize(get.n_vars);
+    const std::vector<Scalar> durations = {1.5, 0, 2, 0};
+    const QuinticPolynomials polynomials(n_x + n_u);
+
+    Scalar start = 0;
+    for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+        get.times(solution.x.data())(i_w) = durations[i_w];
+        const TrajectoryVector<Scalar> points = generateCollocationPoints<Scalar>(get.n_c(i_w), scheme);
+        for (Index j = 0; j < get.n_c(i_w); ++j)
+            get.varsAtWaypoint(solution.x.data(), i_w).col(j) = polynomials(start + points(j) * durations[i_w]);
+        start += durations[i_w];
+    }
+
+    const QuadrotorSampler sampler(solution, scheme);
+    check(sampler.duration() == start, "sampler duration is the sum of the waypoint times");
+
+    const Index n_times = 41;
+    Vector<Scalar> times = Vector<Scalar>::LinSpaced(n_times, -0.5, start + 0.5);
+    times(1) = durations[0];
+    Eigen::Matrix<Scalar, n_x, Eigen::Dynamic> states(+n_x, n_times), state_rates(+n_x, n_times);
+    Eigen::Matrix<Scalar, n_u, Eigen::Dynamic> controls(+n_u, n_times), control_rates(+n_u, n_times);
+    sampler.sample(times, states, controls, state_rates, control_rates);
+
+    bool values_match = true;
+    bool rates_match = true;
+    for (Index i = 0; i < n_times; ++i) {
+        const Scalar t = std::min(std::max(times(i), Scalar(0)), start);
+        Vector<Scalar> vars(n_x + n_u), rates(n_x + n_u);
+        vars << states.col(i), controls.col(i);
+        rates << state_rates.col(i), control_rates.col(i);
+        values_match = values_match && near(vars, polynomials(t), 1e-10);
+        rates_match = rates_match && near(rates, polynomials.derivative(t), 1e-9);
+    }
+    check(values_match, "sampler reproduces polynomials of degree 5");
+    check(rates_match, "sampler reproduces the derivatives of polynomials of degree 5");
+
+    /* The batches evaluate runs of times per waypoint, which must agree with sampling one time at a time,
+     * whether the times are sorted or not, and with or without the rates */
+    Eigen::Matrix<Scalar, n_x, Eigen::Dynamic> batch_states(+n_x, n_times);
+    Eigen::Matrix<Scalar, n_u, Eigen::Dynamic> batch_controls(+n_u, n_times);
+    sampler.sample(times, batch_states, batch_controls);
+    bool batches_match = batch_states == states && batch_controls == controls;
+    for (Index i = 0; i < n_times; ++i) {
+        QuadrotorSampler::State state, state_rate;
+        QuadrotorSampler::Control control, control_rate;
+        sampler.sample(times(i), state, control, state_rate, control_rate);
+        batches_match = batches_match && near(state, states.col(i), 1e-12) && near(control, controls.col(i), 1e-12)
+                        && near(state_rate, state_rates.col(i), 1e-12)
+                        && near(control_rate, control_rates.col(i), 1e-12);
+    }
+    check(batches_match, "sampler batches agree with single samples");
+
+    QuadrotorSolution instant;
+    instant.node_counts = {6};
+    instant.x = Vector<Scalar>::Random(instant.layout().n_vars);
+    instant.layout().times(instant.x.data())(0) = 0;
+    QuadrotorSampler::State state, state_rate;
+    QuadrotorSampler::Control control, control_rate;
+    QuadrotorSampler(instant, scheme).sample(1, state, control, state_rate, control_rate);
+    check(state.allFinite() && control.allFinite() && state_rate.isZero() && control_rate.isZero(),
+          "sampler of a trajectory that takes no time has finite values and zero rates");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Collocation points
+ *
+ * ----------------------------------------------
+ */
+
+/**
+ * The points of every scheme must be sorted, start at 0, end at 1 and be symmetric about 1/2. The Gauss-Lobatto
+ * points must match their closed forms for a few small n_c, and the differentiation matrix of every scheme must
+ * differentiate the monomials of degree up to n_c-1 exactly, which is what the DynamicsConstraints rely on.
+ */
+void testCollocationPoints() {
+    const CollocationScheme schemes[] = {CollocationScheme::Uniform, CollocationScheme::LegendreGaussLobatto,
+                                         CollocationScheme::ChebyshevGaussLobatto};
+    bool ordered = true;
+    bool symmetric = true;
+    bool differentiates = true;
+    for (CollocationScheme scheme : schemes) {
+        for (Index n_c = 2; n_c <= 12; ++n_c) {
+            const Vector<Scalar> points = generateCollocationPoints<Scalar>(n_c, scheme);
+            ordered = ordered && points(0) == 0 && points(n_c - 1) == 1;
+            for (Index i = 0; i + 1 < n_c; ++i)
+                ordered = ordered && points(i) < points(i + 1);
+            symmetric = symmetric && near(points + points.reverse(), Vector<Scalar>::Ones(n_c), 1e-14);
+
+            /* The uniform points are ill-conditioned, so they only need to be exact for few points */
+            if (scheme == CollocationScheme::Uniform && n_c > 8)
+                continue;
+            const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> D = lagrangeDerivativeCoefficients(points);
+            for (Index k = 0; k < n_c; ++k) {
+                const Vector<Scalar> f = points.array().pow(Scalar(k));
+                const Vector<Scalar> df = k == 0 ? Vector<Scalar>::Zero(n_c)
+                                                 : Vector<Scalar>(k * points.array().pow(Scalar(k - 1)));
+                differentiates = differentiates && near(Vector<Scalar>(f.transpose() * D), df, 1e-9);
+            }
+        }
+    }
+    check(ordered, "collocation points are sorted from 0 to 1");
+    check(symmetric, "collocation points are symmetric about the middle");
+    check(differentiates, "differentiation matrices are exact for polynomials of degree n_c-1");
+
+    /* The interior LGL points are the roots of P'_{n_c-1}, which are +-1/sqrt(5) for n_c = 4,
+     * and 0 and +-sqrt(3/7) for n_c = 5, on [-1, 1] */
+    Vector<Scalar> lgl_4(4), lgl_5(5);
+    lgl_4 << -1, -1 / std::sqrt(5.0), 1 / std::sqrt(5.0), 1;
+    lgl_5 << -1, -std::sqrt(3.0 / 7), 0, std::sqrt(3.0 / 7), 1;
+    check(near(generateCollocationPoints<Scalar>(4, CollocationScheme::LegendreGaussLobatto),
+               Vector<Scalar>((lgl_4.array() + 1) / 2), 1e-15)
+          && near(generateCollocationPoints<Scalar>(5, CollocationScheme::LegendreGaussLobatto),
+                  Vector<Scalar>((lgl_5.array() + 1) / 2), 1e-15),
+          "Legendre-Gauss-Lobatto points are the roots of the derivative of the Legendre polynomial");
+    Vector<Scalar> cgl_5(5);
+    cgl_5 << 0, (2 - std::sqrt(2.0)) / 4, 0.5, (2 + std::sqrt(2.0)) / 4, 1;
+    check(near(generateCollocationPoints<Scalar>(5, CollocationScheme::ChebyshevGaussLobatto), cgl_5, 1e-15),
+          "Chebyshev-Gauss-Lobatto points are the extrema of the Chebyshev polynomial");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Ranged bounds
+ *
+ * ----------------------------------------------
+ */
+
+/**
+ * Fuse two instances of the ControlRateConstraints with different bounds, and the LocalControlRateConstraints,
+ * between equality constraints. Each ranged row must take its bounds from its own instance, repeating them for
+ * every node, the equality rows must be bounded by zero, and the FusedConstraint must concatenate the rows in
+ * the order of the tuple.
+ */
+void testRangedBounds() {
+    const Index n_x = 6;
+    const Index n_u = 4;
+    const Index n_c = 4;
+    const Index n_w = 2;
+    using Rates = ControlRateConstraints<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using LocalRates = LocalControlRateConstraints<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Dynamics = DynamicsConstraints<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Collocation = CollocationConstraints<Scalar, Index, n_x, n_u, n_c, n_w>;
+
+    Array<n_u> first_upper, second_upper, local_upper;
+    first_upper << 1, 2, 3, 4;
+    second_upper << 5, 6, 7, 8;
+    local_upper << 9, 10, 11, 12;
+    const Array<n_u> first_lower = -first_upper;
+    const Array<n_u> second_lower = -2 * second_upper;
+    const Array<n_u> local_lower = -3 * local_upper;
+    const Array<n_c> points = generateCollocationPoints<Scalar, Index, n_c>();
+    auto constraints = std::make_tuple(
+            Rates(first_lower, first_upper),
+            Dynamics(),
+            LocalRates(points, local_lower, local_upper),
+            Collocation(),
+            Rates(second_lower, second_upper)
+    );
+    FusedConstraint<decltype(constraints), Scalar, Index, n_x, n_u, n_c, n_w, Array> fused_constraints(constraints, points);
+
+    /* Each ranged block repeats the bounds of its instance, and the equality blocks are zero */
+    Vector<Scalar> lower = Vector<Scalar>::Zero(fused_constraints.n_constraints);
+    Vector<Scalar> upper = Vector<Scalar>::Zero(fused_constraints.n_constraints);
+    auto repeat = [&lower, &upper](Index row, Index n_rows, const Array<n_u> &block_lower, const Array<n_u> &block_upper) {
+        for (Index i = 0; i < n_rows; i += n_u) {
+            lower.segment(row + i, n_u) = block_lower;
+            upper.segment(row + i, n_u) = block_upper;
+        }
+        return row + n_rows;
+    };
+    Index row = repeat(0, Rates::n_constraints, first_lower, first_upper);
+    row += Dynamics::n_constraints;
+    row = repeat(row, LocalRates::n_constraints, local_lower, local_upper);
+    row += Collocation::n_constraints;
+    row = repeat(row, Rates::n_constraints, second_lower, second_upper);
+
+    check(row == fused_constraints.n_constraints, "fused constraint has the rows of every class");
+    check(near(Vector<Scalar>(fused_constraints.lower_bound), lower, 0)
+          && near(Vector<Scalar>(fused_constraints.upper_bound), upper, 0),
+          "fused bounds concatenate the bounds of each instance in order");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Derivative demands
+ *
+ * ----------------------------------------------
+ */
+
+/** Only the first derivatives of the controls at the ends of each waypoint, as the SmoothControlConstraints read */
+struct BoundaryControlDemand {
+    static constexpr unsigned columns(std::size_t degree, unsigned rows) {
+        return degree == 1 && rows == ControlRows ? BoundaryColumns : NoColumns;
+    }
+};
+
+/** The second derivatives of the states inside each waypoint, and of the controls at the start of each waypoint */
+struct MixedDemand {
+    static constexpr unsigned columns(std::size_t degree, unsigned rows) {
+        return degree != 2 ? NoColumns : rows == StateRows ? InteriorColumns : FirstColumn;
+    }
+};
+
+/**
+ * Generate the Lagrange derivatives with narrow demands. The entries that were demanded must match those of
+ * the full demand, and the others must keep their initial zeros, so they were never computed. Then fuse the
+ * SmoothControlConstraints with classes that read no derivatives, which narrows the demand of the
+ * FusedConstraint, and with classes that read every derivative. The rows must be the same.
+ */
+void testDerivativeDemand() {
+    const Index n_x = 6;
+    const Index n_u = 4;
+    const Index n_c = 5;
+    const Index n_w = 3;
+    using Get = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Full = LagrangeDerivatives<Scalar, Index, n_x, n_u, n_c, n_w, 2>;
+    using Boundary = LagrangeDerivatives<Scalar, Index, n_x, n_u, n_c, n_w, 2, VariableGetter, AutoStorage<>,
+                                         BoundaryControlDemand>;
+    using Mixed = LagrangeDerivatives<Scalar, Index, n_x, n_u, n_c, n_w, 2, VariableGetter, AutoStorage<>,
+                                      MixedDemand>;
+
+    const Array<n_c> points = generateCollocationPoints<Scalar, Index, n_c, CollocationScheme::LegendreGaussLobatto>();
+    Vector<Scalar> x = Vector<Scalar>::Random(Get::n_vars);
+    Get::times(x.data()) << 1.5, 0.5, 2;
+
+    Full full(points);
+    Boundary boundary(points);
+    Mixed mixed(points);
+    full.generate<2>(x.data());
+    boundary.generate<2>(x.data());
+    mixed.generate<2>(x.data());
+
+    bool demanded_match = true;
+    bool others_untouched = true;
+    for (Index i_w = 0; i_w < n_w; ++i_w) {
+        const auto full_controls = Get::controlsAtWaypoint(full.get<1>(), i_w);
+        const auto boundary_controls = Get::controlsAtWaypoint(boundary.get<1>(), i_w);
+        demanded_match = demanded_match && near(boundary_controls.col(0), full_controls.col(0), 1e-12)
+                         && near(boundary_controls.col(n_c - 1), full_controls.col(n_c - 1), 1e-12);
+        others_untouched = others_untouched && boundary_controls.middleCols(1, n_c - 2).isZero(0)
+                           && Get::statesAtWaypoint(boundary.get<1>(), i_w).isZero(0)
+                           && Get::varsAtWaypoint(boundary.get<2>(), i_w).isZero(0);
+
+        const auto full_states = Get::statesAtWaypoint(full.get<2>(), i_w);
+        const auto mixed_states = Get::statesAtWaypoint(mixed.get<2>(), i_w);
+        const auto mixed_controls = Get::controlsAtWaypoint(mixed.get<2>(), i_w);
+        demanded_match = demanded_match && near(mixed_states.middleCols(1, n_c - 2), full_states.middleCols(1, n_c - 2), 1e-12)
+                         && near(mixed_controls.col(0), Get::controlsAtWaypoint(full.get<2>(), i_w).col(0), 1e-12);
+        others_untouched = others_untouched && mixed_states.col(0).isZero(0) && mixed_states.col(n_c - 1).isZero(0)
+                           && mixed_controls.rightCols(n_c - 1).isZero(0)
+                           && Get::varsAtWaypoint(mixed.get<1>(), i_w).isZero(0);
+    }
+    check(demanded_match, "narrow derivative demands compute the same entries as the full demand");
+    check(others_untouched, "narrow derivative demands leave the other entries alone");
+
+    Array<n_x> initial_state = Array<n_x>::Random();
+    Array<n_u> rate_upper = Array<n_u>::Ones();
+    auto narrow_constraints = std::make_tuple(
+            InitialStateConstraints<Scalar, Index, n_x, n_u, n_c, n_w>(initial_state),
+            SmoothControlConstraints<Scalar, Index, n_x, n_u, n_c, n_w>()
+    );
+    auto wide_constraints = std::make_tuple(
+            ControlRateConstraints<Scalar, Index, n_x, n_u, n_c, n_w>(Array<n_u>(-rate_upper), rate_upper),
+            DynamicsConstraints<Scalar, Index, n_x, n_u, n_c, n_w>(),
+            InitialStateConstraints<Scalar, Index, n_x, n_u, n_c, n_w>(initial_state),
+            SmoothControlConstraints<Scalar, Index, n_x, n_u, n_c, n_w>()
+    );
+    FusedConstraint<decltype(narrow_constraints), Scalar, Index, n_x, n_u, n_c, n_w, Array>
+            narrow(narrow_constraints, points);
+    FusedConstraint<decltype(wide_constraints), Scalar, Index, n_x, n_u, n_c, n_w, Array>
+            wide(wide_constraints, points);
+    Vector<Scalar> narrow_g(+narrow.n_constraints);
+    Vector<Scalar> wide_g(+wide.n_constraints);
+    narrow(narrow_g, x);
+    wide(wide_g, x);
+    check(near(narrow_g, Vector<Scalar>(wide_g.tail(narrow_g.size())), 1e-12),
+          "a fused constraint with a narrower demand gives the same rows");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Control derivatives
+ *
+ * ----------------------------------------------
+ */
+
+/**
+ * Evaluate the ControlDerivativeConstraints of degree 2 and 3 on controls that follow polynomials of degree 5,
+ * with six points per waypoint and waypoints of different durations, so that the rows must hold the analytic
+ * second and third derivatives at every node. The bounds of each control must repeat at every node.
+ */
+void testControlDerivatives() {
+    const Index n_x = 6;
+    const Index n_u = 4;
+    const Index n_c = 6;
+    const Index n_w = 2;
+    using Get = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+
+    Array<n_u> snap_upper, crackle_upper;
+    snap_upper << 1, 2, 3, 4;
+    crackle_upper << 5, 6, 7, 8;
+    auto constraints = std::make_tuple(
+            ControlDerivativeConstraints<Scalar, Index, n_x, n_u, n_c, n_w, 2>(Array<n_u>(-snap_upper), snap_upper),
+            ControlDerivativeConstraints<Scalar, Index, n_x, n_u, n_c, n_w, 3>(Array<n_u>(-crackle_upper), crackle_upper)
+    );
+    const Array<n_c> points = generateCollocationPoints<Scalar, Index, n_c>();
+    FusedConstraint<decltype(constraints), Scalar, Index, n_x, n_u, n_c, n_w, Array> fused_constraints(constraints, points);
+    const Index n_rows = n_u * n_c * n_w;
+    check(fused_constraints.n_constraints == 2 * n_rows, "control derivative constraints have a row per control and node");
+
+    const QuinticPolynomials polynomials(n_u);
+    const Scalar durations[n_w] = {1.5, 0.75};
+    Vector<Scalar> x = Vector<Scalar>::Random(Get::n_vars);
+    Vector<Scalar> expected(2 * n_rows);
+    Vector<Scalar> lower(2 * n_rows);
+    Vector<Scalar> upper(2 * n_rows);
+    Scalar start = 0;
+    for (Index i_w = 0; i_w < n_w; ++i_w) {
+        Get::times(x.data())(i_w) = durations[i_w];
+        for (Index i_c = 0; i_c < n_c; ++i_c) {
+            const Scalar t = start + points(i_c) * durations[i_w];
+            const Index row = n_u * (n_c * i_w + i_c);
+            Get::controlsAtWaypoint(x.data(), i_w).col(i_c) = polynomials(t);
+            expected.segment(row, n_u) = polynomials.derivative(t, 2);
+            expected.segment(n_rows + row, n_u) = polynomials.derivative(t, 3);
+            lower.segment(row, n_u) = -snap_upper;
+            upper.segment(row, n_u) = snap_upper;
+            lower.segment(n_rows + row, n_u) = -crackle_upper;
+            upper.segment(n_rows + row, n_u) = crackle_upper;
+        }
+        start += durations[i_w];
+    }
+
+    Vector<Scalar> g(2 * n_rows);
+    fused_constraints(g, x);
+    check(near(g.head(n_rows), expected.head(n_rows), 1e-8), "control derivative rows of degree 2 match the polynomials");
+    check(near(g.tail(n_rows), expected.tail(n_rows), 1e-7), "control derivative rows of degree 3 match the polynomials");
+    check(near(Vector<Scalar>(fused_constraints.lower_bound), lower, 0)
+          && near(Vector<Scalar>(fused_constraints.upper_bound), upper, 0),
+          "control derivative bounds repeat at every node");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Local transcriptions
+ *
+ * ----------------------------------------------
+ */
+
+/**
+ * An exact solution of the QuadrotorDynamics, starting at rest at the origin, with a constant thrust and the
+ * pitch theta = theta_0 + rate * t, which is linear in time, so that the middle controls of the Hermite-Simpson
+ * rule are exact too. A pitch rate of zero makes the states polynomials of degree two.
+ */
+struct PitchingQuadrotor {
+    Scalar thrust;
+    Scalar theta_0;
+    Scalar rate;
+
+    Array<6> states(Scalar t) const {
+        const Scalar g = QuadrotorDynamics<Scalar>().gravity;
+        const Scalar theta = theta_0 + rate * t;
+        Array<6> x;
+        x(1) = x(4) = 0;
+        if (rate == 0) {
+            x(3) = -thrust * std::sin(theta_0) * t;
+            x(5) = (g - thrust * std::cos(theta_0)) * t;
+            x(0) = x(3) * t / 2;
+            x(2) = x(5) * t / 2;
+        } else {
+            const Scalar k = thrust / rate;
+            x(3) = k * (std::cos(theta) - std::cos(theta_0));
+            x(5) = g * t - k * (std::sin(theta) - std::sin(theta_0));
+            x(0) = k * ((std::sin(theta) - std::sin(theta_0)) / rate - std::cos(theta_0) * t);
+            x(2) = g * t * t / 2 + k * ((std::cos(theta) - std::cos(theta_0)) / rate + std::sin(theta_0) * t);
+        }
+        return x;
+    }
+
+    Array<4> controls(Scalar t) const {
+        Array<4> u;
+        u << thrust, 0, theta_0 + rate * t, 0;
+        return u;
+    }
+};
+
+/** Write the states and controls of the trajectory at the points of a single waypoint of the given duration */
+template<Index n_c>
+Vector<Scalar> sampleWaypoint(const PitchingQuadrotor &trajectory, const Array<n_c> &points, Scalar duration) {
+    using Get = VariableGetter<Scalar, Index, 6, 4, n_c, 1>;
+    Vector<Scalar> x(+Get::n_vars);
+    Get::times(x.data())(0) = duration;
+    for (Index i_c = 0; i_c < n_c; ++i_c) {
+        Get::statesAtWaypoint(x.data(), 0).col(i_c) = trajectory.states(points(i_c) * duration);
+        Get::controlsAtWaypoint(x.data(), 0).col(i_c) = trajectory.controls(points(i_c) * duration);
+    }
+    return x;
+}
+
+/** The largest defect of the Dynamics constraints on a single waypoint of the given duration */
+template<template<typename, typename I, I, I, I, I, template<typename, typename J, J, J, J, J> class> class Dynamics>
+Scalar largestDefect(const PitchingQuadrotor &trajectory, Scalar duration) {
+    const Index n_c = 5;
+    const Array<n_c> points = generateCollocationPoints<Scalar, Index, n_c>();
+    const Dynamics<Scalar, Index, 6, 4, n_c, 1, VariableGetter> dynamics(points);
+    const Vector<Scalar> x = sampleWaypoint<n_c>(trajectory, points, duration);
+    Vector<Scalar> g(+dynamics.n_constraints);
+    int no_derivatives = 0;
+    dynamics(g.data(), x.data(), no_derivatives);
+    return g.lpNorm<Eigen::Infinity>();
+}
+
+/**
+ * Sample exact solutions of the dynamics at the collocation points. On a trajectory whose states are quadratic,
+ * both local rules integrate exactly, so the defects must vanish. On one that pitches, halving the duration of
+ * the waypoint halves every interval h, so the defects must shrink by h^3 for the trapezoidal rule and by h^5 for
+ * the Hermite-Simpson rule. The LocalSmoothControlConstraints must vanish on controls that are linear in time,
+ * and give the jump of the slope where they are not.
+ */
+void testLocalTranscriptions() {
+    const PitchingQuadrotor constant_pitch = {12, 0.3, 0};
+    check(largestDefect<TrapezoidalDynamicsConstraints>(constant_pitch, 2) < 1e-12,
+          "trapezoidal defects vanish on quadratic states");
+    check(largestDefect<HermiteSimpsonDynamicsConstraints>(constant_pitch, 2) < 1e-12,
+          "Hermite-Simpson defects vanish on quadratic states");
+
+    const PitchingQuadrotor pitching = {12, 0.3, 0.8};
+    const Scalar trapezoidal = largestDefect<TrapezoidalDynamicsConstraints>(pitching, 1);
+    const Scalar trapezoidal_half = largestDefect<TrapezoidalDynamicsConstraints>(pitching, 0.5);
+    const Scalar hermite_simpson = largestDefect<HermiteSimpsonDynamicsConstraints>(pitching, 1);
+    const Scalar hermite_simpson_half = largestDefect<HermiteSimpsonDynamicsConstraints>(pitching, 0.5);
+    check(trapezoidal > 1e-6 && std::abs(trapezoidal / trapezoidal_half - 8) < 1,
+          "trapezoidal defects converge at third order in h");
+    check(hermite_simpson > 1e-10 && std::abs(hermite_simpson / hermite_simpson_half - 32) < 4,
+          "Hermite-Simpson defects converge at fifth order in h");
+    check(hermite_simpson < trapezoidal / 100, "Hermite-Simpson defects are much smaller than the trapezoidal ones");
+
+    const Index n_x = 6;
+    const Index n_u = 4;
+    const Index n_c = 4;
+    const Index n_w = 3;
+    using Get = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    const Array<n_c> points = generateCollocationPoints<Scalar, Index, n_c>();
+    const LocalSmoothControlConstraints<Scalar, Index, n_x, n_u, n_c, n_w> smooth(points);
+    const Scalar durations[n_w] = {1.5, 0.5, 2};
+    Array<n_u> slope;
+    slope << 2, -1, 0.5, 3;
+    Vector<Scalar> x = Vector<Scalar>::Random(Get::n_vars);
+    Scalar start = 0;
+    for (Index i_w = 0; i_w < n_w; ++i_w) {
+        Get::times(x.data())(i_w) = durations[i_w];
+        for (Index i_c = 0; i_c < n_c; ++i_c)
+            Get::controlsAtWaypoint(x.data(), i_w).col(i_c) = slope * (start + points(i_c) * durations[i_w]);
+        start += durations[i_w];
+    }
+    Vector<Scalar> g(+smooth.n_constraints);
+    int no_derivatives = 0;
+    smooth(g.data(), x.data(), no_derivatives);
+    check(smooth.n_constraints == n_u * (n_w - 1) && near(g, Vector<Scalar>::Zero(g.size()), 1e-12),
+          "local smooth control rows vanish on linear controls");
+
+    /* Bend the controls of the last waypoint around its first point, which changes their slope by one */
+    for (Index i_c = 1; i_c < n_c; ++i_c)
+        Get::controlsAtWaypoint(x.data(), n_w - 1).col(i_c).array() += points(i_c) * durations[n_w - 1];
+    smooth(g.data(), x.data(), no_derivatives);
+    check(near(g.head(n_u), Vector<Scalar>::Zero(n_u), 1e-12) && near(g.tail(n_u), Vector<Scalar>::Ones(n_u), 1e-12),
+          "local smooth control rows give the jump of the control rate");
+}
+
+/**
+ * Store the PitchingQuadrotor in the multiple shooting layout, with the exact states at the shooting nodes and
+ * the exact controls at the collocation points. Since the pitch is linear in time, the interpolated controls are
+ * exact, so integrating each waypoint from its node must reproduce the next node, and the defects must vanish,
+ * up to the error of Runge45.
+ */
+void testMultipleShooting() {
+    const Index n_x = 6;
+    const Index n_u = 4;
+    const Index n_c = 4;
+    const Index n_w = 2;
+    using Get = ShootingVariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    const Array<n_c> points = generateCollocationPoints<Scalar, Index, n_c>();
+    const ShootingDynamicsConstraints<Scalar, Index, n_x, n_u, n_c, n_w, 4> dynamics(points);
+
+    const PitchingQuadrotor pitching = {12, 0.3, 0.8};
+    const Scalar durations[n_w] = {1.5, 0.75};
+    Vector<Scalar> x = Vector<Scalar>::Random(Get::n_vars);
+    Scalar start = 0;
+    Get::node(x.data(), 0) = pitching.states(0);
+    for (Index i_w = 0; i_w < n_w; ++i_w) {
+        Get::times(x.data())(i_w) = durations[i_w];
+        for (Index i_c = 0; i_c < n_c; ++i_c)
+            Get::controlsAtWaypoint(x.data(), i_w).col(i_c) = pitching.controls(start + points(i_c) * durations[i_w]);
+        start += durations[i_w];
+        Get::node(x.data(), i_w + 1) = pitching.states(start);
+    }
+
+    bool integrates = true;
+    for (Index i_w = 0; i_w < n_w; ++i_w)
+        integrates = integrates && near(dynamics.integrate(x.data(), i_w), Get::node(x.data(), i_w + 1), 1e-7);
+    check(integrates, "shooting integration reproduces the quadrotor dynamics");
+
+    Vector<Scalar> g(+dynamics.n_constraints);
+    int no_derivatives = 0;
+    dynamics(g.data(), x.data(), no_derivatives);
+    check(near(g, Vector<Scalar>::Zero(g.size()), 1e-7), "shooting defects vanish on an exact trajectory");
+
+    /* The defects must see a change of the controls between the nodes */
+    Get::controlsAtWaypoint(x.data(), 1)(0, 1) += 1;
+    dynamics(g.data(), x.data(), no_derivatives);
+    check(near(g.head(n_x), Vector<Scalar>::Zero(n_x), 1e-7) && g.tail(n_x).lpNorm<Eigen::Infinity>() > 1e-3,
+          "shooting defects depend on the controls of their waypoint");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Reduced controls
+ *
+ * ----------------------------------------------
+ */
+
+/** Evaluate the constraints of the tester's mission with the layout of Getter at x */
+template<template<typename, typename I, I, I, I, I> class Getter, Index n_c, Index n_w>
+Vector<Scalar> evaluateLayout(const QuadrotorProblem &problem, const Vector<Scalar> &x) {
+    const Index n_x = QuadrotorDynamics<Scalar>::n_x;
+    const Index n_u = QuadrotorDynamics<Scalar>::n_u;
+    const Eigen::Matrix<Scalar, n_x, n_w> waypoints = problem.waypoints;
+    auto constraints = std::make_tuple(
+            CollocationConstraints<Scalar, Index, n_x, n_u, n_c, n_w, Getter>(),
+            ControlRateConstraints<Scalar, Index, n_x, n_u, n_c, n_w, Getter>(problem.control_rate_lower,
+                                                                             problem.control_rate_upper),
+            DynamicsConstraints<Scalar, Index, n_x, n_u, n_c, n_w, Getter>(),
+            InitialStateConstraints<Scalar, Index, n_x, n_u, n_c, n_w, Getter>(problem.initial_state),
+            SmoothControlConstraints<Scalar, Index, n_x, n_u, n_c, n_w, Getter>(),
+            WaypointConstraints<Scalar, Index, n_x, n_u, n_c, n_w, Getter>(waypoints)
+    );
+    const Array<n_c> points = generateCollocationPoints<Scalar, Index, n_c>();
+    FusedConstraint<decltype(constraints), Scalar, Index, n_x, n_u, n_c, n_w, Array, Getter>
+            fused_constraints(constraints, points);
+    Vector<Scalar> g(+fused_constraints.n_constraints);
+    fused_constraints(g, x);
+    return g;
+}
+
+/**
+ * Give the same mission controls that are cubic in time, so that four control nodes per waypoint hold them
+ * exactly, and evaluate it with a control at every collocation point and with the control nodes. Every row
+ * must agree, both for the fixed-size ReducedControlVariableGetter against the VariableGetter, and for the
+ * RuntimeControlReduction against the RuntimeTranscription, which also has a waypoint with fewer points than nodes.
+ */
+void testReducedControls() {
+    const Index n_x = QuadrotorDynamics<Scalar>::n_x;
+    const Index n_u = QuadrotorDynamics<Scalar>::n_u;
+    const Index n_c = 7;
+    const Index n_w = 2;
+    const Index n_k = 4;
+    using Full = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    /* The scheme of the control nodes must be that of the collocation points of evaluateLayout */
+    using Nodes = ReducedControls<n_k, CollocationScheme::Uniform>;
+    using Reduced = Nodes::Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
+
+    QuinticPolynomials cubics(n_u);
+    cubics.coefficients.rightCols<2>().setZero();
+    const QuadrotorProblem problem = testProblem(n_w);
+    const Array<n_c> points = generateCollocationPoints<Scalar, Index, n_c>();
+
+    Vector<Scalar> x = Vector<Scalar>::Random(Full::n_vars);
+    Full::times(x.data()) << 1.5, 0.75;
+    Scalar start = 0;
+    for (Index i_w = 0; i_w < n_w; ++i_w) {
+        for (Index i_c = 0; i_c < n_c; ++i_c)
+            Full::controlsAtWaypoint(x.data(), i_w).col(i_c) = cubics(start + points(i_c) * Full::times(x.data())(i_w));
+        start += Full::times(x.data())(i_w);
+    }
+    Vector<Scalar> z = Vector<Scalar>::Zero(Reduced::n_vars);
+    for (Index i_w = 0; i_w < n_w; ++i_w) {
+        Reduced::statesAtWaypoint(z.data(), i_w) = Full::statesAtWaypoint(x.data(), i_w);
+        Reduced::setControlsAtWaypoint(z.data(), i_w, Full::controlsAtWaypoint(x.data(), i_w));
+    }
+    Reduced::times(z.data()) = Full::times(x.data());
+
+    bool same_controls = true;
+    for (Index i_w = 0; i_w < n_w; ++i_w)
+        same_controls = same_controls && near(Reduced::controlsAtWaypoint(z.data(), i_w),
+                                              Full::controlsAtWaypoint(x.data(), i_w), 1e-13);
+    check(same_controls, "reduced controls interpolate cubic controls exactly");
+    const Vector<Scalar> g = evaluateLayout<VariableGetter, n_c, n_w>(problem, x);
+    const Vector<Scalar> reduced_g = evaluateLayout<Nodes::Getter, n_c, n_w>(problem, z);
+    check(near(reduced_g, g, 1e-12 * g.lpNorm<Eigen::Infinity>()), "reduced control rows match the VariableGetter rows");
+
+    /* The runtime path, where the first waypoint has fewer collocation points than control nodes */
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Reduction = RuntimeControlReduction<Scalar, Index, n_x, n_u>;
+    using Runtime = RuntimeTranscription<Scalar, Index, n_x, n_u>;
+    const QuadrotorProblem runtime_problem = testProblem(3);
+    const Get get(std::vector<Index>{3, 7, 6});
+    const Reduction reduction(get, n_k, runtime_problem.scheme);
+    check(reduction.control_node_counts == std::vector<Index>({3, 4, 4})
+          && reduction.n_vars == get.n_vars - n_u * (3 + 2), "runtime reduction keeps n_k control nodes per waypoint");
+
+    Vector<Scalar> runtime_x = Vector<Scalar>::Random(get.n_vars);
+    get.times(runtime_x.data()) << 0.5, 1.5, 0.75;
+    start = 0;
+    for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+        const Vector<Scalar> nodes = generateCollocationPoints<Scalar>(get.n_c(i_w), runtime_problem.scheme);
+        for (Index i_c = 0; i_c < get.n_c(i_w); ++i_c)
+            get.controlsAtWaypoint(runtime_x.data(), i_w).col(i_c) = cubics(start + nodes(i_c) * get.times(runtime_x.data())(i_w));
+        start += get.times(runtime_x.data())(i_w);
+    }
+    Vector<Scalar> runtime_z(reduction.n_vars);
+    reduction.reduce(runtime_x.data(), runtime_z.data());
+    Vector<Scalar> expanded(get.n_vars);
+    reduction.expand(runtime_z.data(), expanded.data());
+    check(near(expanded, runtime_x, 1e-13), "runtime reduction reproduces cubic controls");
+
+    Runtime transcription(runtime_problem, get);
+    Reduction::FG<Runtime::FG> reduced_fg(reduction, transcription.fg_eval);
+    const Index n_rows = transcription.fused_constraints.n_constraints;
+    const Vector<Scalar> fg = evaluateFG(transcription.fg_eval, runtime_x, n_rows);
+    const Vector<Scalar> reduced_fg_values = evaluateFG(reduced_fg, runtime_z, n_rows);
+    check(near(reduced_fg_values, fg, 1e-12 * fg.lpNorm<Eigen::Infinity>()),
+          "runtime reduction rows match the runtime transcription rows");
+
+    Vector<Scalar> lower(get.n_vars), upper(get.n_vars), z_lower(reduction.n_vars), z_upper(reduction.n_vars);
+    runtime_problem.variableBounds(get, lower.data(), upper.data());
+    reduction.reduceBounds(lower.data(), upper.data(), z_lower.data(), z_upper.data());
+    Vector<Scalar> expanded_lower(get.n_vars), expanded_upper(get.n_vars);
+    reduction.expand(z_lower.data(), expanded_lower.data());
+    reduction.expand(z_upper.data(), expanded_upper.data());
+    check(near(expanded_lower, lower, 1e-13) && near(expanded_upper, upper, 1e-13),
+          "runtime reduction puts the control bounds on the control nodes");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Time variables
+ *
+ * ----------------------------------------------
+ */
+
+/**
+ * Transcribe the same mission in durations and in reciprocal times, and evaluate both at corresponding points.
+ * The cost, every row and every row bound must agree, the gradients of the Lagrangians must agree after the
+ * chain rule dL/dt = -s^2 dL/ds, and the multipliers of the bounds on s must map to ones that keep the
+ * Lagrangian in durations stationary.
+ */
+void testTimeVariables() {
+    const Index n_w = 3;
+    using Runtime = RuntimeTranscription<Scalar, Index, QuadrotorDynamics<Scalar>::n_x, QuadrotorDynamics<Scalar>::n_u>;
+
+    QuadrotorProblem problem = testProblem(n_w);
+    const RuntimeVariableGetter<Scalar, Index, QuadrotorDynamics<Scalar>::n_x, QuadrotorDynamics<Scalar>::n_u>
+            get(std::vector<Index>{5, 6, 7});
+    Runtime durations(problem, get);
+    problem.time_variable = TimeVariable::Reciprocal;
+    Runtime reciprocals(problem, get);
+    const Index n_rows = durations.fused_constraints.n_constraints;
+
+    Vector<Scalar> x = Vector<Scalar>::Random(get.n_vars);
+    get.times(x.data()) = get.times(x.data()).cwiseAbs().array() + 0.5;
+    Vector<Scalar> s = x;
+    toTimeVariables(TimeVariable::Reciprocal, get, s.data());
+    Vector<Scalar> round_trip = s;
+    toDurations(TimeVariable::Reciprocal, get, round_trip.data());
+    check(near(round_trip, x, 1e-15), "reciprocal times map back to the durations");
+
+    const Vector<Scalar> fg = evaluateFG(durations.fg_eval, x, n_rows);
+    const Vector<Scalar> reciprocal_fg = evaluateFG(reciprocals.fg_eval, s, n_rows);
+    check(std::abs(fg[0] - reciprocal_fg[0]) <= 1e-12, "reciprocal times have the cost of the durations");
+    check(near(fg.tail(n_rows), reciprocal_fg.tail(n_rows), 1e-10), "reciprocal time rows match the duration rows");
+    check(near(durations.fused_constraints.lower_bound, reciprocals.fused_constraints.lower_bound, 0)
+          && near(durations.fused_constraints.upper_bound, reciprocals.fused_constraints.upper_bound, 0),
+          "reciprocal time row bounds match the duration row bounds");
+
+    const Vector<Scalar> lambda = Vector<Scalar>::Random(n_rows);
+    const Vector<Scalar> gradient = lagrangianGradient(durations.fg_eval, x, lambda);
+    const Vector<Scalar> reciprocal_gradient = lagrangianGradient(reciprocals.fg_eval, s, lambda);
+    Vector<Scalar> chain_rule = reciprocal_gradient;
+    get.times(chain_rule.data()) = -get.times(reciprocal_gradient.data()).cwiseProduct(
+            get.times(s.data()).cwiseProduct(get.times(s.data())));
+    check(near(chain_rule, gradient, 1e-9), "reciprocal time Lagrangian gradient follows the chain rule");
+
+    /* Bound multipliers that make the time entries stationary in s */
+    Vector<Scalar> z_lower = Vector<Scalar>::Zero(get.n_vars);
+    Vector<Scalar> z_upper = Vector<Scalar>::Zero(get.n_vars);
+    get.times(z_lower.data()) = get.times(reciprocal_gradient.data()).cwiseMax(0);
+    get.times(z_upper.data()) = (-get.times(reciprocal_gradient.data())).cwiseMax(0);
+    toDurationMultipliers(TimeVariable::Reciprocal, get, s.data(), z_lower.data(), z_upper.data());
+    const Vector<Scalar> residual = get.times(gradient.data()) - get.times(z_lower.data()) + get.times(z_upper.data());
+    check(near(residual, Vector<Scalar>::Zero(n_w), 1e-9) && get.times(z_lower.data()).minCoeff() >= 0
+          && get.times(z_upper.data()).minCoeff() >= 0,
+          "reciprocal time bound multipliers map to stationary duration multipliers");
+
+    Vector<Scalar> lower(get.n_vars), upper(get.n_vars);
+    problem.variableBounds(get, lower.data(), upper.data());
+    toTimeVariableBounds(TimeVariable::Reciprocal, get, lower.data(), upper.data());
+    check(get.times(lower.data()).isConstant(1 / problem.time_upper)
+          && get.times(upper.data()).isConstant(1 / problem.time_lower), "reciprocal time bounds swap the duration bounds");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Mesh refinement
+ *
+ * ----------------------------------------------
+ */
+
+/**
+ * Refine the mesh with a solve that ignores the guess and returns a trajectory in the layout of each mesh:
+ * a hover for the first waypoint and a free fall for the third, which meet the dynamics everywhere,
+ * and for the second, a position that moves while the velocity stays zero, which never does.
+ * Only the second waypoint may gain collocation points, and every solve must start from a guess in its layout.
+ */
+void testMeshRefinement() {
+    const Index n_x = QuadrotorDynamics<Scalar>::n_x;
+    const Index n_u = QuadrotorDynamics<Scalar>::n_u;
+    using Get = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Solution = CppAD::ipopt::solve_result<TrajectoryVector<Scalar>>;
+    const QuadrotorDynamics<Scalar> model;
+
+    const QuadrotorProblem problem = testProblem(3);
+    MeshRefinementOptions options;
+    options.initial_nodes = 5;
+    options.max_nodes = 12;
+    options.max_solves = 10;
+
+    std::vector<std::vector<Index>> meshes;
+    bool guesses_fit = true;
+    const auto solve = [&](const Get &get, const TrajectoryVector<Scalar> &x) {
+        meshes.push_back(get.node_counts);
+        guesses_fit = guesses_fit && Index(x.size()) == get.n_vars;
+
+        Solution solution;
+        solution.status = Solution::success;
+        solution.x = TrajectoryVector<Scalar>::Zero(get.n_vars);
+        const Scalar duration = 2;
+        get.times(solution.x.data()).setConstant(duration);
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            const TrajectoryVector<Scalar> tau = generateCollocationPoints<Scalar>(get.n_c(i_w), problem.scheme);
+            auto states = get.statesAtWaypoint(solution.x.data(), i_w);
+            auto controls = get.controlsAtWaypoint(solution.x.data(), i_w);
+            for (Index i_c = 0; i_c < get.n_c(i_w); ++i_c) {
+                if (i_w == 0) {
+                    controls(0, i_c) = model.mass_gravity;
+                } else if (i_w == 1) {
+                    states(0, i_c) = std::sin(3 * tau(i_c));
+                    controls(0, i_c) = model.mass_gravity;
+                } else {
+                    states(2, i_c) = model.gravity * duration * duration * tau(i_c) * tau(i_c) / 2;
+                    states(5, i_c) = model.gravity * duration * tau(i_c);
+                }
+            }
+        }
+        return solution;
+    };
+
+    const MeshRefinementResult<Scalar, Index> result = refineMeshWith(problem, options, solve);
+    check(result.defects[0] <= 1e-9 && result.defects[2] <= 1e-9 && result.defects[1] > options.tolerance,
+          "mesh refinement measures the dynamics defect of each waypoint");
+
+    bool only_defective = true;
+    for (const std::vector<Index> &mesh : meshes)
+        only_defective = only_defective && mesh[0] == options.initial_nodes && mesh[2] == options.initial_nodes;
+    check(only_defective && result.node_counts[0] == options.initial_nodes
+          && result.node_counts[2] == options.initial_nodes, "mesh refinement leaves the accurate waypoints alone");
+    check(result.node_counts[1] == options.max_nodes && meshes.back()[1] == options.max_nodes
+          && result.solves == meshes.size() && result.solves > 2 && result.solves < options.max_solves,
+          "mesh refinement adds nodes to the defective waypoint until it reaches the limit");
+    check(guesses_fit, "mesh refinement warm starts each solve in the layout of its mesh");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Async log
+ *
+ * ----------------------------------------------
+ */
+
+/**
+ * Keeps the lines in a vector that outlives the logger. If gate is given, the first write waits until it opens,
+ * which stalls the thread of the logger so that the ring fills up.
+ */
+class TestSink : public LogSink {
+private:
+
+    std::vector<std::string> &lines;
+    std::atomic<bool> *gate;
+    std::atomic<bool> *entered;
+
+public:
+
+    TestSink(std::vector<std::string> &lines, std::atomic<bool> *gate = nullptr, std::atomic<bool> *entered = nullptr)
+            : lines(lines), gate(gate), entered(entered) {
+    }
+
+    void write(const char *line, size_t size) override {
+        if (gate && lines.empty()) {
+            *entered = true;
+            while (!*gate)
+                std::this_thread::yield();
+        }
+        lines.emplace_back(line, size);
+    }
+};
+
+/**
+ * The stream interface must end lines at endl and at newlines, and split lines that are too long.
+ * A full ring must drop lines and report how many, and a thread that switches loggers must hand its unfinished
+ * line to the previous logger while it lives, and drop it once it was destroyed.
+ */
+void testAsyncLog() {
+    const size_t capacity = AsyncLogger::line_capacity;
+
+    std::vector<std::string> lines;
+    {
+        AsyncLogger logger;
+        logger.addSink(std::unique_ptr<LogSink>(new TestSink(lines)));
+        Log log(logger);
+        log << "x = " << 3 << ", y = " << 2.5 << ' ' << true << std::endl << std::endl;
+        log << "one\ntwo\n" << std::string(2 * capacity + 10, 'z') << std::endl << "unfinished";
+        logger.flush();
+    }
+    check(lines.size() == 8 && lines[0] == "x = 3, y = 2.5 1" && lines[1].empty(), "log ends a line at endl");
+    check(lines.size() == 8 && lines[2] == "one" && lines[3] == "two", "log ends a line at a newline");
+    check(lines.size() == 8 && lines[4] == std::string(capacity, 'z') && lines[5] == std::string(capacity, 'z')
+          && lines[6] == std::string(10, 'z'), "log splits a line that is too long");
+    check(lines.size() == 8 && lines[7] == "unfinished", "log flushes the unfinished line of the calling thread");
+
+    std::vector<std::string> stalled;
+    std::atomic<bool> gate{false};
+    std::atomic<bool> entered{false};
+    {
+        AsyncLogger logger(2);
+        logger.addSink(std::unique_ptr<LogSink>(new TestSink(stalled, &gate, &entered)));
+        logger.append("first\n");
+        while (!entered)
+            std::this_thread::yield();
+        for (int i = 0; i < 10; ++i)
+            logger.append("line\n");
+        gate = true;
+    }
+    check(stalled.size() == 4 && stalled[0] == "first" && stalled[1] == "line" && stalled[2] == "line"
+          && stalled[3] == "[8 log lines dropped]", "log drops lines when the ring is full and counts them");
+
+    std::vector<std::string> previous_lines;
+    std::vector<std::string> next_lines;
+    std::unique_ptr<AsyncLogger> previous(new AsyncLogger());
+    previous->addSink(std::unique_ptr<LogSink>(new TestSink(previous_lines)));
+    AsyncLogger next;
+    next.addSink(std::unique_ptr<LogSink>(new TestSink(next_lines)));
+    std::thread([&] {
+        previous->append("handed over");
+        next.append("next\n");
+        previous->append("dropped");
+        std::thread([&] { previous.reset(); }).join();
+        next.append("after\n");
+        next.flush();
+    }).join();
+    check(previous_lines.size() == 1 && previous_lines[0] == "handed over",
+          "log hands the unfinished line to the previous logger");
+    check(next_lines.size() == 2 && next_lines[0] == "next" && next_lines[1] == "after",
+          "log drops the unfinished line of a destroyed logger");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Work-stealing pool
+ *
+ * ----------------------------------------------
+ */
+
+/** Record y = k * sum(x^2) on the calling thread, and return whether its Jacobian is 2 k x */
+bool tapeAndDifferentiate(Scalar k) {
+    Vector<ADScalar> x(8);
+    for (Index i = 0; i < 8; ++i)
+        x[i] = Scalar(i) + k;
+    CppAD::Independent(x);
+    Vector<ADScalar> y(1);
+    y[0] = k * x.squaredNorm();
+    CppAD::ADFun<Scalar> f(x, y);
+
+    Vector<Scalar> at(8);
+    for (Index i = 0; i < 8; ++i)
+        at[i] = k - Scalar(i);
+    const Vector<Scalar> jacobian = f.Jacobian(at);
+    return near(jacobian, (2 * k * at).eval(), 1e-12);
+}
+
+/**
+ * Run many tasks on a pool with several workers, some of them submitted from the workers themselves.
+ * Each worker must have a CppAD thread number of its own, which it gives back when the pool is destroyed,
+ * and the workers must be able to record and differentiate tapes at the same time.
+ */
+void testWorkStealingPool() {
+    const size_t n_tasks = 200;
+    std::mutex mutex;
+    std::vector<std::pair<size_t, size_t>> numbers;
+    std::atomic<int> ran{0};
+    std::atomic<int> taped{0};
+    std::set<size_t> reserved;
+    {
+        /* Without NDEBUG, CppAD wants the first recording to be sequential */
+        WorkStealingPool pool(4, [] { tapeAndDifferentiate(1); });
+        check(pool.size() == 4 && pool.workerIndex() == pool.size() && CppADThreads::current() == 0,
+              "pool starts its workers, and the calling thread is not one of them");
+
+        for (size_t i = 0; i < n_tasks; ++i) {
+            pool.submit([&, i] {
+                if (i % 10 == 0)
+                    pool.submit([&] { ++ran; });
+                if (tapeAndDifferentiate(Scalar(i % 7) + 1))
+                    ++taped;
+                std::lock_guard<std::mutex> lock(mutex);
+                numbers.emplace_back(pool.workerIndex(), CppADThreads::current());
+                ++ran;
+            });
+        }
+        pool.wait();
+
+        check(ran == n_tasks + n_tasks / 10, "pool runs every task, including those submitted from workers");
+        check(taped == n_tasks, "pool workers record and differentiate tapes at the same time");
+
+        std::map<size_t, size_t> number_of_worker;
+        bool consistent = true;
+        for (const std::pair<size_t, size_t> &entry : numbers) {
+            consistent = consistent && entry.first < pool.size() && entry.second != 0;
+            auto known = number_of_worker.emplace(entry.first, entry.second);
+            consistent = consistent && known.first->second == entry.second;
+            reserved.insert(entry.second);
+        }
+        check(consistent && reserved.size() == number_of_worker.size(),
+              "each pool worker has a CppAD thread number of its own");
+    }
+
+    /* The numbers are free again, so a new pool gets workers, and they can take the same numbers */
+    std::set<size_t> again;
+    {
+        WorkStealingPool pool(4);
+        for (size_t i = 0; i < 40; ++i) {
+            pool.submit([&] {
+                std::lock_guard<std::mutex> lock(mutex);
+                again.insert(CppADThreads::current());
+            });
+        }
+        pool.wait();
+        check(pool.size() == 4 && again.count(0) == 0 && *again.rbegin() <= 4,
+              "pool gives its CppAD thread numbers back when it is destroyed");
+    }
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Batch solver
+ *
+ * ----------------------------------------------
+ */
+
+/**
+ * Solve a batch on a single worker, so that the problems run one after the other. They must run earliest
+ * deadline first, come back in the order of the batch, and a solve that throws must be recorded in its result
+ * without stopping the batch.
+ */
+void testSolveBatch() {
+    WorkStealingPool pool(1);
+    std::vector<size_t> solved;
+    auto solver = [&solved](const QuadrotorProblem &, size_t n_c, const std::string &, SolveControl *control) {
+        solved.push_back(n_c);
+        if (n_c == 7)
+            throw std::runtime_error("solver failed");
+        control->iterate(0, 0);
+        QuadrotorSolution solution;
+        solution.status = QuadrotorSolution::Result::success;
+        solution.cost = n_c;
+        return solution;
+    };
+
+    /* The problem with n_c = 2 has no limit, and the others run in the order of their limits */
+    std::vector<BatchProblem> problems(5);
+    const double limits[] = {0, 30, 10, 20, 25};
+    for (size_t i = 0; i < problems.size(); ++i) {
+        problems[i].problem = testProblem(1);
+        problems[i].n_c = i + 2;
+        problems[i].time_limit = limits[i];
+    }
+    problems[4].n_c = 7;
+
+    const std::vector<BatchResult> results = solveBatch(problems, pool, solver);
+    check(solved == std::vector<size_t>({4, 5, 7, 3, 2}), "batch solves the earliest deadline first");
+
+    bool in_order = results.size() == problems.size();
+    for (size_t i = 0; in_order && i < 4; ++i)
+        in_order = results[i].started && results[i].error.empty() && results[i].solution.cost == problems[i].n_c
+                   && results[i].iterations == 1 && results[i].worker == 0;
+    check(in_order, "batch returns the results in the order of the problems");
+    check(results.size() == problems.size() && results[4].started && results[4].error == "solver failed"
+          && results[4].solution.status == QuadrotorSolution::Result::not_defined,
+          "batch records a solve that throws, and finishes the others");
+}
+
+/**
+ * Race a variant that converges against one that is slow to stop after it was cancelled. solvePortfolio must
+ * return with the converged variant while the other one is still stopping, and that one must see the cancel.
+ * When nothing converges, it must wait for both and pick the smaller violation, and a variant that throws
+ * must count as one that did not converge.
+ */
+void testSolvePortfolio() {
+    WorkStealingPool pool(2);
+    std::atomic<bool> slow_started{false};
+    std::atomic<bool> release{false};
+    std::atomic<bool> slow_returned{false};
+    std::atomic<bool> slow_cancelled{false};
+    auto solver = [&](const QuadrotorProblem &, size_t, const std::string &options, SolveControl *control) {
+        QuadrotorSolution solution;
+        if (options.find("slow") != std::string::npos) {
+            slow_started = true;
+            control->iterate(0, 1);
+            for (int i = 0; i < 5000 && !release; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            slow_cancelled = !control->iterate(0, 1);
+            solution.status = QuadrotorSolution::Result::user_requested_stop;
+            slow_returned = true;
+        } else {
+            for (int i = 0; i < 5000 && !slow_started; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            control->iterate(0, 0);
+            solution.status = QuadrotorSolution::Result::success;
+        }
+        return solution;
+    };
+
+    std::vector<PortfolioVariant> variants(2);
+    variants[0].options = "slow";
+    variants[1].options = "fast";
+    const PortfolioResult result = solvePortfolio(testProblem(1), 3, "", variants, 0, pool, solver);
+    const bool returned_early = !slow_returned;
+    release = true;
+    pool.wait();
+    check(result.converged && result.winner == 1 && result.solution.status == QuadrotorSolution::Result::success,
+          "portfolio picks the variant that converged");
+    check(returned_early, "portfolio returns before the losers have stopped");
+    check(slow_cancelled && slow_returned, "portfolio cancels the losers, which drain on the pool");
+
+    auto stalls = [](const QuadrotorProblem &, size_t, const std::string &options, SolveControl *control) {
+        if (options.find("throw") != std::string::npos)
+            throw std::runtime_error("solver failed");
+        control->iterate(0, options.find("close") != std::string::npos ? 0.1 : 1);
+        QuadrotorSolution solution;
+        solution.status = QuadrotorSolution::Result::maxiter_exceeded;
+        return solution;
+    };
+    variants.resize(3);
+    variants[0].options = "far";
+    variants[1].options = "close";
+    variants[2].options = "throw";
+    const PortfolioResult stalled = solvePortfolio(testProblem(1), 3, "", variants, 0, pool, stalls);
+    check(!stalled.converged && stalled.winner == 1 && stalled.iterations == std::vector<int>({1, 1, 0}),
+          "portfolio waits for every variant when none converged, and a throwing variant loses");
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Solve scheduler
+ *
+ * ----------------------------------------------
+ */
+
+/**
+ * Stands in for solveTrajectory, so that the solvers which run many solves can be tested without Ipopt.
+ * A solve takes n_c iterations of a millisecond each, reports them to the SolveControl like Ipopt does,
+ * and stops when the control says so. The cost is the number of iterations.
+ */
+struct FakeSolver {
+    std::atomic<int> started{0};
+    std::atomic<int> returned{0};
+
+    QuadrotorSolution operator()(const QuadrotorProblem &, size_t n_c, const std::string &, SolveControl *control) {
+        ++started;
+        QuadrotorSolution solution;
+        solution.status = QuadrotorSolution::Result::success;
+        for (size_t i = 0; i < n_c; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (control && !control->iterate(0, 0)) {
+                solution.status = QuadrotorSolution::Result::user_requested_stop;
+                break;
+            }
+            solution.cost += 1;
+        }
+        ++returned;
+        return solution;
+    }
+};
+
+/** Wait up to five seconds for the job to start running */
+bool waitUntilRunning(SolveScheduler &scheduler, SolveScheduler::Handle handle) {
+    for (int i = 0; i < 5000; ++i) {
+        if (scheduler.waitFor(handle, 0) == JobState::Running)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+/**
+ * Run jobs on a single worker, so that the later ones queue. A newer job for a vehicle must skip the queued
+ * job before it and stop the running one, cancel must stop a running job, and the destructor must stop
+ * the job that is still running and wait for it.
+ */
+void testSolveScheduler() {
+    using Result = QuadrotorSolution::Result;
+    const size_t forever = 1000000;
+    const QuadrotorProblem problem = testProblem(2);
+    WorkStealingPool pool(1);
+    FakeSolver fake;
+    std::atomic<int> progress{0};
+    {
+        SolveScheduler scheduler(pool, std::ref(fake));
+
+        const auto running = scheduler.submit(0, problem, forever, "", [&](const SolveProgress &) { ++progress; });
+        check(waitUntilRunning(scheduler, running), "scheduler starts a job");
+        const auto queued = scheduler.submit(1, problem, 5, "");
+        const auto queued_newer = scheduler.submit(1, problem, 5, "");
+        const auto running_newer = scheduler.submit(0, problem, 7, "");
+
+        QuadrotorSolution solution;
+        check(scheduler.waitFor(queued, 0, &solution) == JobState::Superseded
+              && solution.status == Result::not_defined, "scheduler skips a queued job that was superseded");
+        check(scheduler.waitFor(running, 5, &solution) == JobState::Superseded
+              && solution.status == Result::user_requested_stop && progress > 0,
+              "scheduler stops a running job that was superseded");
+        check(scheduler.waitFor(queued_newer, 5, &solution) == JobState::Finished && solution.cost == 5
+              && scheduler.waitFor(running_newer, 5, &solution) == JobState::Finished && solution.cost == 7,
+              "scheduler finishes the newest job of each vehicle");
+        check(fake.started == 3, "scheduler never starts a skipped job");
+
+        const auto cancelled = scheduler.submit(2, problem, forever, "");
+        check(waitUntilRunning(scheduler, cancelled) && scheduler.cancel(cancelled)
+              && scheduler.waitFor(cancelled, 5, &solution) == JobState::Cancelled
+              && solution.status == Result::user_requested_stop, "scheduler cancels a running job");
+        check(!scheduler.cancel(cancelled) && !scheduler.cancel(queued_newer),
+              "scheduler does not cancel a job that has returned");
+        scheduler.release(queued_newer);
+        check(scheduler.waitFor(queued_newer, 0) == JobState::Unknown, "scheduler forgets a released job");
+
+        const auto destroyed = scheduler.submit(3, problem, forever, "");
+        check(waitUntilRunning(scheduler, destroyed), "scheduler starts a job before it is destroyed");
+    }
+    check(fake.started == 5 && fake.returned == 5, "scheduler destructor stops the running job and waits for it");
+}
+
 int main() {
 
     /* Sizes */
@@ -157,5 +1881,27 @@ int main() {
         cout << g[i] << ", ";
     cout << endl;
 
-    return 0;
+    testPresolve();
+    testFixedKernel();
+    testFixedMultipliers();
+    testTrajectoryFile();
+    testSolutionLibrary();
+    testTrajectorySampler();
+    testCollocationPoints();
+    testRangedBounds();
+    testDerivativeDemand();
+    testControlDerivatives();
+    testLocalTranscriptions();
+    testMultipleShooting();
+    testReducedControls();
+    testTimeVariables();
+    testMeshRefinement();
+    testAsyncLog();
+    testWorkStealingPool();
+    testSolveBatch();
+    testSolvePortfolio();
+    testSolveScheduler();
+
+    cout << (failures == 0 ? "All checks passed" : "Some checks failed") << endl;
+    return failures == 0 ? 0 : 1;
 }
\ No newline at end of file
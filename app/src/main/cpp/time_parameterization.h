@@ -0,0 +1,151 @@
+#ifndef TIME_PARAMETERIZATION_HEADER
+#define TIME_PARAMETERIZATION_HEADER
+
+#include <limits>
+#include "Eigen/Dense"
+
+/*
+ * These policies decide what the time variable of each waypoint (Getter::times) means.
+ * Each one converts between the variable and the duration t of the waypoint:
+ *
+ * Time::inverseDuration(variable) = 1 / t, which scales the first derivative (see RuntimeLagrangeDerivatives)
+ * Time::duration(variable) = t, which is summed up by the cost function (see RuntimeFG_eval)
+ * Time::variable(t) = variable, for the initial guess
+ * Time::bounds(t_lower, t_upper, lower, upper), for the variable bounds
+ * Time::boundMultipliers(variable, z_lower, z_upper), which turns the multipliers of the variable bounds
+ * into those of the duration bounds
+ */
+
+/** The variable is the duration t of the waypoint. The derivatives divide by it. */
+struct DurationTime {
+
+    template<typename Scalar>
+    static Scalar inverseDuration(const Scalar &variable) {
+        return Scalar(1) / variable;
+    }
+
+    template<typename Scalar>
+    static Scalar duration(const Scalar &variable) {
+        return variable;
+    }
+
+    static double variable(double duration) {
+        return duration;
+    }
+
+    static void bounds(double duration_lower, double duration_upper, double &lower, double &upper) {
+        lower = duration_lower;
+        upper = duration_upper;
+    }
+
+    static void boundMultipliers(double variable, double &z_lower, double &z_upper) {
+    }
+};
+
+/**
+ * The variable is the reciprocal s = 1/t of the duration of the waypoint. The derivatives x * D^k * s^k
+ * become polynomial in s, so the dynamics and control rate rows are bilinear in s and the states or
+ * controls rather than rational. The tape has no divisions and the Lagrangian Hessian loses its
+ * time-time entries from the constraints. Only the cost function, sum(1/s), is rational, and it is separable.
+ *
+ * The lower bound on t becomes the upper bound on s. A non-positive lower bound on t leaves s unbounded above.
+ * Since dL/ds = -dL/dt / s^2, the multiplier of the lower bound on s, scaled by s^2, is that of the upper bound
+ * on t, and the other way around.
+ */
+struct ReciprocalTime {
+
+    template<typename Scalar>
+    static Scalar inverseDuration(const Scalar &variable) {
+        return variable;
+    }
+
+    template<typename Scalar>
+    static Scalar duration(const Scalar &variable) {
+        return Scalar(1) / variable;
+    }
+
+    static double variable(double duration) {
+        return 1 / duration;
+    }
+
+    static void bounds(double duration_lower, double duration_upper, double &lower, double &upper) {
+        lower = 1 / duration_upper;
+        upper = duration_lower > 0 ? 1 / duration_lower : std::numeric_limits<double>::infinity();
+    }
+
+    static void boundMultipliers(double variable, double &z_lower, double &z_upper) {
+        const double z_variable_lower = z_lower;
+        z_lower = z_upper * variable * variable;
+        z_upper = z_variable_lower * variable * variable;
+    }
+};
+
+/** Selects one of the policies above at runtime, for example in a TrajectoryProblem */
+enum class TimeVariable {
+    /** DurationTime */
+    Duration,
+    /** ReciprocalTime */
+    Reciprocal
+};
+
+/*
+ * The policies, selected at runtime. The tapes of the runtime transcription are recorded once per solve,
+ * so this does not cost anything when Ipopt evaluates them.
+ */
+template<typename Scalar>
+Scalar inverseDuration(TimeVariable time, const Scalar &variable) {
+    return time == TimeVariable::Reciprocal ? ReciprocalTime::inverseDuration(variable)
+                                            : DurationTime::inverseDuration(variable);
+}
+
+template<typename Scalar>
+Scalar duration(TimeVariable time, const Scalar &variable) {
+    return time == TimeVariable::Reciprocal ? ReciprocalTime::duration(variable) : DurationTime::duration(variable);
+}
+
+/** Replace the durations in the times of x, in the layout of get, with the time variables */
+template<typename Get>
+void toTimeVariables(TimeVariable time, const Get &get, double *x) {
+    auto times = get.times(x);
+    for (Eigen::Index i_w = 0; i_w < times.size(); ++i_w)
+        times(i_w) = time == TimeVariable::Reciprocal ? ReciprocalTime::variable(times(i_w))
+                                                      : DurationTime::variable(times(i_w));
+}
+
+/** Replace the time variables in the times of x, in the layout of get, with the durations */
+template<typename Get>
+void toDurations(TimeVariable time, const Get &get, double *x) {
+    auto times = get.times(x);
+    for (Eigen::Index i_w = 0; i_w < times.size(); ++i_w)
+        times(i_w) = duration(time, times(i_w));
+}
+
+/** Replace the duration bounds in the times of lower and upper, in the layout of get, with the variable bounds */
+template<typename Get>
+void toTimeVariableBounds(TimeVariable time, const Get &get, double *lower, double *upper) {
+    auto lower_times = get.times(lower);
+    auto upper_times = get.times(upper);
+    for (Eigen::Index i_w = 0; i_w < lower_times.size(); ++i_w) {
+        if (time == TimeVariable::Reciprocal)
+            ReciprocalTime::bounds(lower_times(i_w), upper_times(i_w), lower_times(i_w), upper_times(i_w));
+        else
+            DurationTime::bounds(lower_times(i_w), upper_times(i_w), lower_times(i_w), upper_times(i_w));
+    }
+}
+
+/** Replace the multipliers of the bounds of the time variables of x, in the layout of get,
+ * with those of the duration bounds. x still holds the time variables. */
+template<typename Get>
+void toDurationMultipliers(TimeVariable time, const Get &get, const double *x, double *z_lower, double *z_upper) {
+    auto times = get.times(x);
+    auto lower_times = get.times(z_lower);
+    auto upper_times = get.times(z_upper);
+    for (Eigen::Index i_w = 0; i_w < times.size(); ++i_w) {
+        if (time == TimeVariable::Reciprocal)
+            ReciprocalTime::boundMultipliers(times(i_w), lower_times(i_w), upper_times(i_w));
+        else
+            DurationTime::boundMultipliers(times(i_w), lower_times(i_w), upper_times(i_w));
+    }
+}
+
+#endif /* TIME_PARAMETERIZATION_HEADER */
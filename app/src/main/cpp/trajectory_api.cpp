@@ -0,0 +1,211 @@
+#include "trajectory_api.h"
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include "trajectory_solver.h"
+#include "work_stealing_pool.h"
+
+namespace {
+
+const size_t n_x = QuadrotorDynamics<double>::n_x;
+const size_t n_u = QuadrotorDynamics<double>::n_u;
+
+using State = QuadrotorProblem::State;
+using Control = QuadrotorProblem::Control;
+
+}
+
+struct trajectory_problem {
+    QuadrotorProblem problem;
+    size_t n_c;
+    /* The Ipopt options, one per line, as they are passed to the solver. The first line sets the sparsity. */
+    std::string options = "Sparse  true  reverse\n";
+    QuadrotorSolution solution;
+    bool solved = false;
+
+    /* The problem holds fixed-size Eigen vectors, which need aligned storage on the heap */
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+size_t trajectory_state_size(void) {
+    return n_x;
+}
+
+size_t trajectory_control_size(void) {
+    return n_u;
+}
+
+trajectory_problem *trajectory_create_problem(size_t n_c) {
+    if (n_c < 2)
+        return nullptr;
+
+    trajectory_problem *handle = new trajectory_problem();
+    handle->n_c = n_c;
+
+    QuadrotorProblem &problem = handle->problem;
+    problem.initial_state.setZero();
+    problem.waypoints.resize(n_x, 0);
+
+    const double degrees = M_PI / 180;
+    const double max_angular_rate = 30 * degrees;
+    problem.control_rate_upper << 20, max_angular_rate, max_angular_rate, max_angular_rate;
+    problem.control_rate_lower = -problem.control_rate_upper;
+
+    problem.state_lower.fill(-2e19);
+    problem.state_upper.fill(2e19);
+    problem.control_lower << 0, -30 * degrees, -30 * degrees, -2 * 360 * degrees;
+    problem.control_upper << 2 * 9.91, 30 * degrees, 30 * degrees, 2 * 360 * degrees;
+
+    problem.time_lower = 0;
+    problem.time_upper = 10;
+    problem.guess = InitialGuess::MinimumSnap;
+    return handle;
+}
+
+void trajectory_destroy_problem(trajectory_problem *problem) {
+    delete problem;
+}
+
+int trajectory_set_initial_state(trajectory_problem *problem, const double *state) {
+    if (!problem || !state)
+        return TRAJECTORY_INVALID_ARGUMENT;
+    problem->problem.initial_state = Eigen::Map<const State>(state);
+    return TRAJECTORY_OK;
+}
+
+int trajectory_set_waypoints(trajectory_problem *problem, const double *waypoints, size_t n_w) {
+    if (!problem || !waypoints || n_w == 0)
+        return TRAJECTORY_INVALID_ARGUMENT;
+    problem->problem.waypoints = Eigen::Map<const Eigen::Matrix<double, n_x, Eigen::Dynamic>>(waypoints, n_x, n_w);
+    return TRAJECTORY_OK;
+}
+
+int trajectory_set_state_bounds(trajectory_problem *problem, const double *lower, const double *upper) {
+    if (!problem || !lower || !upper)
+        return TRAJECTORY_INVALID_ARGUMENT;
+    problem->problem.state_lower = Eigen::Map<const State>(lower);
+    problem->problem.state_upper = Eigen::Map<const State>(upper);
+    return TRAJECTORY_OK;
+}
+
+int trajectory_set_control_bounds(trajectory_problem *problem, const double *lower, const double *upper) {
+    if (!problem || !lower || !upper)
+        return TRAJECTORY_INVALID_ARGUMENT;
+    problem->problem.control_lower = Eigen::Map<const Control>(lower);
+    problem->problem.control_upper = Eigen::Map<const Control>(upper);
+    return TRAJECTORY_OK;
+}
+
+int trajectory_set_control_rate_bounds(trajectory_problem *problem, const double *lower, const double *upper) {
+    if (!problem || !lower || !upper)
+        return TRAJECTORY_INVALID_ARGUMENT;
+    problem->problem.control_rate_lower = Eigen::Map<const Control>(lower);
+    problem->problem.control_rate_upper = Eigen::Map<const Control>(upper);
+    return TRAJECTORY_OK;
+}
+
+int trajectory_set_time_bounds(trajectory_problem *problem, double lower, double upper) {
+    if (!problem || !(lower <= upper))
+        return TRAJECTORY_INVALID_ARGUMENT;
+    problem->problem.time_lower = lower;
+    problem->problem.time_upper = upper;
+    return TRAJECTORY_OK;
+}
+
+int trajectory_set_sparsity(trajectory_problem *problem, int sparsity) {
+    if (!problem)
+        return TRAJECTORY_INVALID_ARGUMENT;
+    const char *line;
+    switch (sparsity) {
+        case TRAJECTORY_DENSE:
+            line = "Sparse  false  reverse\n";
+            break;
+        case TRAJECTORY_SPARSE_FORWARD:
+            line = "Sparse  true  forward\n";
+            break;
+        case TRAJECTORY_SPARSE_REVERSE:
+            line = "Sparse  true  reverse\n";
+            break;
+        default:
+            return TRAJECTORY_INVALID_ARGUMENT;
+    }
+    problem->options.replace(0, problem->options.find('\n') + 1, line);
+    return TRAJECTORY_OK;
+}
+
+int trajectory_set_integer_option(trajectory_problem *problem, const char *name, int value) {
+    if (!problem || !name)
+        return TRAJECTORY_INVALID_ARGUMENT;
+    std::ostringstream line;
+    line << "Integer " << name << " " << value << "\n";
+    problem->options += line.str();
+    return TRAJECTORY_OK;
+}
+
+int trajectory_set_numeric_option(trajectory_problem *problem, const char *name, double value) {
+    if (!problem || !name)
+        return TRAJECTORY_INVALID_ARGUMENT;
+    std::ostringstream line;
+    line.precision(17);
+    line << "Numeric " << name << " " << value << "\n";
+    problem->options += line.str();
+    return TRAJECTORY_OK;
+}
+
+int trajectory_set_string_option(trajectory_problem *problem, const char *name, const char *value) {
+    if (!problem || !name || !value)
+        return TRAJECTORY_INVALID_ARGUMENT;
+    problem->options += std::string("String ") + name + " " + value + "\n";
+    return TRAJECTORY_OK;
+}
+
+int trajectory_solve(trajectory_problem *problem, int *status, double *cost) {
+    if (!problem || problem->problem.n_w() == 0)
+        return TRAJECTORY_INVALID_ARGUMENT;
+
+    /* Handles may be solved from several threads at once, and next to the workers of a pool,
+     * so the calling thread needs a CppAD thread number of its own unless it already has one */
+    CppADThreads::setup();
+    const size_t thread_number = CppADThreads::current() == 0 ? CppADThreads::reserve() : 0;
+    if (CppADThreads::current() == 0 && thread_number == 0) {
+        problem->solved = false;
+        return TRAJECTORY_SOLVE_FAILED;
+    }
+    if (thread_number != 0)
+        CppADThreads::enter(thread_number);
+
+    /* Nothing may unwind through the C callers */
+    try {
+        problem->solution = solveTrajectory(problem->problem, problem->n_c, problem->options);
+        problem->solved = true;
+    } catch (...) {
+        problem->solved = false;
+    }
+    if (thread_number != 0)
+        CppADThreads::leave();
+    if (!problem->solved)
+        return TRAJECTORY_SOLVE_FAILED;
+
+    if (status)
+        *status = static_cast<int>(problem->solution.status);
+    if (cost)
+        *cost = problem->solution.cost;
+    return TRAJECTORY_OK;
+}
+
+size_t trajectory_solution_size(const trajectory_problem *problem) {
+    return problem && problem->solved ? problem->solution.x.size() : 0;
+}
+
+int trajectory_get_solution(const trajectory_problem *problem, double *x, size_t size) {
+    if (!problem || !x)
+        return TRAJECTORY_INVALID_ARGUMENT;
+    if (!problem->solved)
+        return TRAJECTORY_NOT_SOLVED;
+    if (size < static_cast<size_t>(problem->solution.x.size()))
+        return TRAJECTORY_BUFFER_TOO_SMALL;
+    Eigen::Map<TrajectoryVector<double>> buffer(x, problem->solution.x.size());
+    buffer = problem->solution.x;
+    return TRAJECTORY_OK;
+}
@@ -0,0 +1,96 @@
+#ifndef TRAJECTORY_API_HEADER
+#define TRAJECTORY_API_HEADER
+
+#include <stddef.h>
+
+/**
+ * A plain C interface to the quadrotor trajectory solver, for JNI, Python ctypes or the flight stack.
+ * A problem is an opaque handle that owns the mission, the Ipopt options and the latest solution.
+ * Every array is owned by the caller. Matrices are column-major, and solutions are copied in the layout
+ * of the VariableGetter (see variable_getter.h): the states and controls of each collocation point,
+ * waypoint by waypoint, followed by the time of each waypoint.
+ *
+ * The functions that can fail return TRAJECTORY_OK or one of the negative error codes.
+ * A handle may be used from one thread at a time, and different handles from different threads.
+ * Each solve takes a CppAD thread number for the calling thread (see CppADThreads in work_stealing_pool.h),
+ * so at most CPPAD_MAX_NUM_THREADS - 1 solves and pool workers can run at once.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct trajectory_problem trajectory_problem;
+
+enum {
+    TRAJECTORY_OK = 0,
+    TRAJECTORY_INVALID_ARGUMENT = -1,
+    TRAJECTORY_BUFFER_TOO_SMALL = -2,
+    TRAJECTORY_NOT_SOLVED = -3,
+    TRAJECTORY_SOLVE_FAILED = -4
+};
+
+/** How the solver takes the derivatives of the constraints and the Lagrangian */
+enum {
+    TRAJECTORY_DENSE = 0,
+    TRAJECTORY_SPARSE_FORWARD = 1,
+    TRAJECTORY_SPARSE_REVERSE = 2
+};
+
+/** The sizes of one state and one control */
+size_t trajectory_state_size(void);
+size_t trajectory_control_size(void);
+
+/**
+ * Create a problem with n_c collocation points per waypoint, the origin as the initial state and no waypoints.
+ * The states are unbounded, the controls and their rates have the bounds of the demo in main.cpp,
+ * and each waypoint takes between 0 and 10 seconds. The derivatives are sparse, in reverse mode
+ * (see trajectory_set_sparsity). Return NULL if n_c is less than 2.
+ */
+trajectory_problem *trajectory_create_problem(size_t n_c);
+
+void trajectory_destroy_problem(trajectory_problem *problem);
+
+/** state holds trajectory_state_size() values */
+int trajectory_set_initial_state(trajectory_problem *problem, const double *state);
+
+/** waypoints holds n_w states, one after the other */
+int trajectory_set_waypoints(trajectory_problem *problem, const double *waypoints, size_t n_w);
+
+/** The bounds of every state, control and control rate, each holding one state or control */
+int trajectory_set_state_bounds(trajectory_problem *problem, const double *lower, const double *upper);
+int trajectory_set_control_bounds(trajectory_problem *problem, const double *lower, const double *upper);
+int trajectory_set_control_rate_bounds(trajectory_problem *problem, const double *lower, const double *upper);
+
+/** The bounds of the time of each waypoint */
+int trajectory_set_time_bounds(trajectory_problem *problem, double lower, double upper);
+
+/**
+ * Choose TRAJECTORY_DENSE, TRAJECTORY_SPARSE_FORWARD or TRAJECTORY_SPARSE_REVERSE, as the Sparse option
+ * of CppAD::ipopt::solve. Dense derivatives are only worth it for a few waypoints.
+ */
+int trajectory_set_sparsity(trajectory_problem *problem, int sparsity);
+
+/** Set an Ipopt option. The options are formatted once here, not on every solve. */
+int trajectory_set_integer_option(trajectory_problem *problem, const char *name, int value);
+int trajectory_set_numeric_option(trajectory_problem *problem, const char *name, double value);
+int trajectory_set_string_option(trajectory_problem *problem, const char *name, const char *value);
+
+/**
+ * Solve the problem, and keep the solution in the handle. If status is given, it receives the
+ * CppAD::ipopt::solve_result status, and if cost is given, it receives the total time.
+ * Return TRAJECTORY_SOLVE_FAILED if the solver threw, or if every CppAD thread number is taken.
+ */
+int trajectory_solve(trajectory_problem *problem, int *status, double *cost);
+
+/** The number of doubles of the solution, or 0 before the first solve */
+size_t trajectory_solution_size(const trajectory_problem *problem);
+
+/** Copy the solution into x, which holds size doubles, at least trajectory_solution_size() */
+int trajectory_get_solution(const trajectory_problem *problem, double *x, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRAJECTORY_API_HEADER */
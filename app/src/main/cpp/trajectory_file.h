@@ -0,0 +1,470 @@
+#ifndef TRAJECTORY_FILE_HEADER
+#define TRAJECTORY_FILE_HEADER
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Eigen/Dense"
+#include "trajectory_solver.h"
+#include "utils.h"
+
+/**
+ * A binary file of trajectories, one record per replan, for logging every replan in flight and replaying
+ * them offline. The file starts with a header that holds the sizes it was written with, followed by the records:
+ *
+ *     RecordHeader
+ *     node_counts      n_w             uint64_t
+ *     points           n_nodes         the collocation point of each node, in [0, 1] of its waypoint
+ *     times            n_w             the duration of each waypoint
+ *     states           n_x * n_nodes   column-major, one node after the other in time order
+ *     controls         n_u * n_nodes   column-major, one node after the other in time order
+ *     z_lower, z_upper n_vars each     only if the record has multipliers, in the layout of the solution
+ *     lambda           n_constraints
+ *
+ * Every field is a multiple of 8 bytes, so the arrays of a mapped file can be used in place.
+ */
+namespace TrajectoryFile {
+
+static constexpr char magic[8] = {'T', 'R', 'A', 'J', 'B', 'I', 'N', '\0'};
+static constexpr uint32_t version = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t scalar_size;
+    uint64_t state_size;
+    uint64_t control_size;
+    /** The number of complete records */
+    uint64_t count;
+};
+
+struct RecordHeader {
+    /** The size of the record in bytes, including this header */
+    uint64_t size;
+    uint64_t n_w;
+    uint64_t n_nodes;
+    /** Zero if the record has no multipliers */
+    uint64_t n_vars;
+    uint64_t n_constraints;
+    int64_t status;
+    int64_t scheme;
+    int64_t iterations;
+    double cost;
+    /** When the replan was made, in the clock of the writer */
+    double stamp;
+    double solve_seconds;
+};
+
+/** What a replan knows about its solve, besides the solution */
+struct SolveStats {
+    double stamp = 0;
+    double solve_seconds = 0;
+    int64_t iterations = 0;
+};
+
+/** The size in bytes of a record with these sizes, including its header */
+template<typename Scalar>
+inline uint64_t recordSize(uint64_t n_x, uint64_t n_u,
+                           uint64_t n_w, uint64_t n_nodes, uint64_t n_vars, uint64_t n_constraints) {
+    return sizeof(RecordHeader) + sizeof(uint64_t) * n_w
+           + sizeof(Scalar) * (n_nodes + n_w + (n_x + n_u) * n_nodes + 2 * n_vars + n_constraints);
+}
+
+}
+
+/**
+ * Appends replans to a trajectory file. Each record is assembled in a buffer that is reused, and written
+ * with a single call, and the count in the header is only updated once the record is complete, so a crash
+ * while appending loses at most that record.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+class TrajectoryFileWriter {
+private:
+
+    using Solution = TrajectorySolution<Scalar, Index, n_x, n_u>;
+    using FileHeader = TrajectoryFile::FileHeader;
+    using RecordHeader = TrajectoryFile::RecordHeader;
+
+    int file = -1;
+    FileHeader header;
+    std::vector<char> buffer;
+
+    bool writeHeader() {
+        return pwrite(file, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+    }
+
+public:
+
+    TrajectoryFileWriter() = default;
+
+    TrajectoryFileWriter(const TrajectoryFileWriter &) = delete;
+
+    TrajectoryFileWriter &operator=(const TrajectoryFileWriter &) = delete;
+
+    ~TrajectoryFileWriter() {
+        close();
+    }
+
+    /** Open the file at path for appending, creating it if it does not exist.
+     * Return false if it cannot be opened or was written with other sizes. */
+    bool open(const std::string &path) {
+        close();
+        file = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (file < 0)
+            return false;
+
+        struct stat status;
+        if (fstat(file, &status) != 0) {
+            close();
+            return false;
+        }
+        if (status.st_size == 0) {
+            std::memcpy(header.magic, TrajectoryFile::magic, sizeof(header.magic));
+            header.version = TrajectoryFile::version;
+            header.scalar_size = sizeof(Scalar);
+            header.state_size = n_x;
+            header.control_size = n_u;
+            header.count = 0;
+            if (!writeHeader()) {
+                close();
+                return false;
+            }
+        } else if (pread(file, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+                   || std::memcmp(header.magic, TrajectoryFile::magic, sizeof(header.magic)) != 0
+                   || header.version != TrajectoryFile::version || header.scalar_size != sizeof(Scalar)
+                   || header.state_size != n_x || header.control_size != n_u) {
+            close();
+            return false;
+        }
+
+        /* Skip past the complete records, and drop whatever a crash left after them */
+        off_t end = sizeof(FileHeader);
+        for (uint64_t i = 0; i < header.count; ++i) {
+            uint64_t size;
+            if (pread(file, &size, sizeof(size), end) != static_cast<ssize_t>(sizeof(size))
+                || size < sizeof(RecordHeader)) {
+                close();
+                return false;
+            }
+            end += size;
+        }
+        if (ftruncate(file, end) != 0 || lseek(file, end, SEEK_SET) != end) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (file >= 0)
+            ::close(file);
+        file = -1;
+    }
+
+    bool isOpen() const {
+        return file >= 0;
+    }
+
+    /** The number of records in the file */
+    Index size() const {
+        return isOpen() ? Index(header.count) : 0;
+    }
+
+    /**
+     * Append the solution, which was solved with the collocation points of scheme, and the stats of its solve.
+     * The multipliers are only stored if with_multipliers is set and the solution has them.
+     * Return false on failure.
+     */
+    bool append(const Solution &solution,
+                CollocationScheme scheme,
+                const TrajectoryFile::SolveStats &stats = TrajectoryFile::SolveStats(),
+                bool with_multipliers = false) {
+        if (!isOpen())
+            return false;
+
+        const auto get = solution.layout();
+        const uint64_t n_w = get.n_w;
+        const uint64_t n_nodes = get.n_nodes;
+        const bool multipliers = with_multipliers && solution.z_lower.size() == solution.x.size()
+                                 && solution.z_upper.size() == solution.x.size();
+        const uint64_t n_vars = multipliers ? get.n_vars : 0;
+        const uint64_t n_constraints = multipliers ? solution.lambda.size() : 0;
+        const uint64_t size = TrajectoryFile::recordSize<Scalar>(n_x, n_u, n_w, n_nodes, n_vars, n_constraints);
+        buffer.resize(size);
+
+        RecordHeader *h = reinterpret_cast<RecordHeader *>(buffer.data());
+        h->size = size;
+        h->n_w = n_w;
+        h->n_nodes = n_nodes;
+        h->n_vars = n_vars;
+        h->n_constraints = n_constraints;
+        h->status = solution.status;
+        h->scheme = static_cast<int64_t>(scheme);
+        h->iterations = stats.iterations;
+        h->cost = solution.cost;
+        h->stamp = stats.stamp;
+        h->solve_seconds = stats.solve_seconds;
+
+        uint64_t *node_counts = reinterpret_cast<uint64_t *>(h + 1);
+        std::copy(get.node_counts.begin(), get.node_counts.end(), node_counts);
+        Scalar *points = reinterpret_cast<Scalar *>(node_counts + n_w);
+        Scalar *times = points + n_nodes;
+        Eigen::Map<Eigen::Matrix<Scalar, n_x, Eigen::Dynamic>> states(times + n_w, n_x, n_nodes);
+        Eigen::Map<Eigen::Matrix<Scalar, n_u, Eigen::Dynamic>> controls(times + n_w + n_x * n_nodes, n_u, n_nodes);
+
+        Index node = 0;
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            const TrajectoryVector<Scalar> waypoint_points = generateCollocationPoints<Scalar>(get.n_c(i_w), scheme);
+            std::copy(waypoint_points.data(), waypoint_points.data() + get.n_c(i_w), points + node);
+            states.middleCols(node, get.n_c(i_w)) = get.statesAtWaypoint(solution.x.data(), i_w);
+            controls.middleCols(node, get.n_c(i_w)) = get.controlsAtWaypoint(solution.x.data(), i_w);
+            node += get.n_c(i_w);
+        }
+        Eigen::Map<Eigen::Matrix<Scalar, 1, Eigen::Dynamic>> time_map(times, n_w);
+        time_map = get.times(solution.x.data());
+
+        if (multipliers) {
+            Scalar *z_lower = times + n_w + (n_x + n_u) * n_nodes;
+            std::copy(solution.z_lower.data(), solution.z_lower.data() + n_vars, z_lower);
+            std::copy(solution.z_upper.data(), solution.z_upper.data() + n_vars, z_lower + n_vars);
+            std::copy(solution.lambda.data(), solution.lambda.data() + n_constraints, z_lower + 2 * n_vars);
+        }
+
+        const off_t end = lseek(file, 0, SEEK_END);
+        if (end < 0 || write(file, buffer.data(), size) != static_cast<ssize_t>(size)) {
+            if (end >= 0 && ftruncate(file, end) == 0)
+                lseek(file, end, SEEK_SET);
+            return false;
+        }
+        header.count += 1;
+        return writeHeader();
+    }
+};
+
+/**
+ * Maps a trajectory file read-only, and gives access to its replans in place, without copying.
+ * The replans see the records that were complete when the file was opened.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+class TrajectoryFileReader {
+private:
+
+    using FileHeader = TrajectoryFile::FileHeader;
+    using RecordHeader = TrajectoryFile::RecordHeader;
+
+    int file = -1;
+    const char *memory = nullptr;
+    size_t length = 0;
+    std::vector<uint64_t> offsets;
+
+    /**
+     * Check that the record at the start of available bytes is one that append could have written:
+     * its size fits, matches its sizes, and its node counts add up to its nodes.
+     */
+    static bool isValidRecord(const char *record, uint64_t available) {
+        if (available < sizeof(RecordHeader))
+            return false;
+        const RecordHeader &h = *reinterpret_cast<const RecordHeader *>(record);
+
+        /* Each of the sizes takes at least 8 bytes, which also keeps the size below from overflowing */
+        if (h.size > available || h.n_w > available || h.n_nodes > available
+            || h.n_vars > available || h.n_constraints > available
+            || h.size != TrajectoryFile::recordSize<Scalar>(n_x, n_u, h.n_w, h.n_nodes, h.n_vars, h.n_constraints))
+            return false;
+
+        const uint64_t *node_counts = reinterpret_cast<const uint64_t *>(&h + 1);
+        uint64_t n_nodes = 0;
+        for (uint64_t i_w = 0; i_w < h.n_w; ++i_w) {
+            if (node_counts[i_w] > h.n_nodes - n_nodes)
+                return false;
+            n_nodes += node_counts[i_w];
+        }
+        return n_nodes == h.n_nodes;
+    }
+
+public:
+
+    using States = Eigen::Map<const Eigen::Matrix<Scalar, n_x, Eigen::Dynamic>>;
+    using Controls = Eigen::Map<const Eigen::Matrix<Scalar, n_u, Eigen::Dynamic>>;
+    using Row = Eigen::Map<const Eigen::Matrix<Scalar, 1, Eigen::Dynamic>>;
+    using Column = Eigen::Map<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>;
+
+    /** One replan, as views into the mapped file. These are invalidated when the reader is closed. */
+    class Replan {
+    private:
+
+        const RecordHeader *h;
+
+        const uint64_t *nodeCounts() const {
+            return reinterpret_cast<const uint64_t *>(h + 1);
+        }
+
+        const Scalar *scalars() const {
+            return reinterpret_cast<const Scalar *>(nodeCounts() + h->n_w);
+        }
+
+    public:
+
+        explicit Replan(const RecordHeader *header) : h(header) {
+        }
+
+        const RecordHeader &header() const {
+            return *h;
+        }
+
+        Index n_w() const {
+            return h->n_w;
+        }
+
+        Index n_nodes() const {
+            return h->n_nodes;
+        }
+
+        Index n_c(Index i_w) const {
+            return nodeCounts()[i_w];
+        }
+
+        CollocationScheme scheme() const {
+            return static_cast<CollocationScheme>(h->scheme);
+        }
+
+        bool hasMultipliers() const {
+            return h->n_vars > 0;
+        }
+
+        Row points() const {
+            return Row(scalars(), h->n_nodes);
+        }
+
+        Row times() const {
+            return Row(scalars() + h->n_nodes, h->n_w);
+        }
+
+        States states() const {
+            return States(scalars() + h->n_nodes + h->n_w, n_x, h->n_nodes);
+        }
+
+        Controls controls() const {
+            return Controls(scalars() + h->n_nodes + h->n_w + n_x * h->n_nodes, n_u, h->n_nodes);
+        }
+
+        /** The multipliers, in the layout of the solution. These are empty if the record has none. */
+        Column zLower() const {
+            return Column(scalars() + h->n_nodes + h->n_w + (n_x + n_u) * h->n_nodes, h->n_vars);
+        }
+
+        Column zUpper() const {
+            return Column(zLower().data() + h->n_vars, h->n_vars);
+        }
+
+        Column lambda() const {
+            return Column(zUpper().data() + h->n_vars, h->n_constraints);
+        }
+
+        /** Copy the replan back into a solution, for example to warm start a solve with it */
+        TrajectorySolution<Scalar, Index, n_x, n_u> solution() const {
+            TrajectorySolution<Scalar, Index, n_x, n_u> result;
+            result.status = static_cast<typename TrajectorySolution<Scalar, Index, n_x, n_u>::Result::status_type>(
+                h->status);
+            result.cost = h->cost;
+            result.node_counts.assign(nodeCounts(), nodeCounts() + h->n_w);
+            const auto get = result.layout();
+            result.x.resize(get.n_vars);
+            Index node = 0;
+            for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+                get.statesAtWaypoint(result.x.data(), i_w) = states().middleCols(node, get.n_c(i_w));
+                get.controlsAtWaypoint(result.x.data(), i_w) = controls().middleCols(node, get.n_c(i_w));
+                node += get.n_c(i_w);
+            }
+            get.times(result.x.data()) = times();
+            result.z_lower = zLower();
+            result.z_upper = zUpper();
+            result.lambda = lambda();
+            return result;
+        }
+    };
+
+    TrajectoryFileReader() = default;
+
+    TrajectoryFileReader(const TrajectoryFileReader &) = delete;
+
+    TrajectoryFileReader &operator=(const TrajectoryFileReader &) = delete;
+
+    ~TrajectoryFileReader() {
+        close();
+    }
+
+    /**
+     * Map the file at path. Return false if it cannot be mapped, was written with other sizes,
+     * is truncated, or holds a record that append could not have written.
+     */
+    bool open(const std::string &path) {
+        close();
+        file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+
+        struct stat status;
+        if (fstat(file, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(FileHeader)) {
+            close();
+            return false;
+        }
+        void *mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+        if (mapped == MAP_FAILED) {
+            close();
+            return false;
+        }
+        memory = static_cast<const char *>(mapped);
+        length = status.st_size;
+
+        const FileHeader &h = *reinterpret_cast<const FileHeader *>(memory);
+        if (std::memcmp(h.magic, TrajectoryFile::magic, sizeof(h.magic)) != 0 || h.version != TrajectoryFile::version
+            || h.scalar_size != sizeof(Scalar) || h.state_size != n_x || h.control_size != n_u) {
+            close();
+            return false;
+        }
+
+        uint64_t offset = sizeof(FileHeader);
+        for (uint64_t i = 0; i < h.count; ++i) {
+            if (!isValidRecord(memory + offset, length - offset)) {
+                close();
+                return false;
+            }
+            offsets.push_back(offset);
+            offset += reinterpret_cast<const RecordHeader *>(memory + offset)->size;
+        }
+        return true;
+    }
+
+    void close() {
+        if (memory)
+            munmap(const_cast<char *>(memory), length);
+        if (file >= 0)
+            ::close(file);
+        memory = nullptr;
+        length = 0;
+        file = -1;
+        offsets.clear();
+    }
+
+    bool isOpen() const {
+        return memory != nullptr;
+    }
+
+    /** The number of replans */
+    Index size() const {
+        return offsets.size();
+    }
+
+    Replan operator[](Index i) const {
+        return Replan(reinterpret_cast<const RecordHeader *>(memory + offsets[i]));
+    }
+};
+
+#endif /* TRAJECTORY_FILE_HEADER */
@@ -0,0 +1,318 @@
+#ifndef TRAJECTORY_PROBLEM_HEADER
+#define TRAJECTORY_PROBLEM_HEADER
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "cppad/example/cppad_eigen.hpp"
+#include "cppad/ipopt/solve.hpp"
+#include "Eigen/Dense"
+#include "initial_guess.h"
+#include "interruptible_solve.h"
+#include "presolve.h"
+#include "reduced_control_variable_getter.h"
+#include "runtime_constraints.h"
+#include "runtime_fused_constraint.h"
+#include "runtime_variable_getter.h"
+#include "time_parameterization.h"
+#include "utils.h"
+
+template<typename T>
+using TrajectoryVector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+
+/** How TrajectoryProblem::initialGuess fills in the variables */
+enum class InitialGuess {
+    /** The straight line between the waypoints, with initial_time per waypoint and zero controls */
+    StraightLine,
+    /** The minimum-snap trajectory, timed with guess_velocity and guess_acceleration (see initial_guess.h) */
+    MinimumSnap,
+    /** A previous solution, warm_start, for example from a SolutionLibrary (see solution_library.h).
+     * If its node counts do not match the transcription, this falls back to MinimumSnap. */
+    WarmStart
+};
+
+/**
+ * Everything that describes a mission, independently of how it is discretized:
+ * the initial state, the waypoints, and the bounds on the states, controls, control rates and times.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+struct TrajectoryProblem {
+
+    using State = Eigen::Matrix<Scalar, n_x, 1>;
+    using Control = Eigen::Matrix<Scalar, n_u, 1>;
+
+    State initial_state;
+
+    /** The waypoints, one per column */
+    Eigen::Matrix<Scalar, n_x, Eigen::Dynamic> waypoints;
+
+    Control control_rate_lower;
+    Control control_rate_upper;
+
+    State state_lower;
+    State state_upper;
+
+    Control control_lower;
+    Control control_upper;
+
+    Scalar time_lower;
+    Scalar time_upper;
+
+    /** The time per waypoint used by the initial guess */
+    Scalar initial_time = 1;
+
+    InitialGuess guess = InitialGuess::StraightLine;
+
+    /** The velocity and acceleration limits that time each waypoint of the minimum-snap guess */
+    Scalar guess_velocity = 2;
+    Scalar guess_acceleration = 2;
+
+    /** The variables of the WarmStart guess, in the layout of RuntimeVariableGetter(warm_start_node_counts) */
+    TrajectoryVector<Scalar> warm_start;
+    std::vector<Index> warm_start_node_counts;
+
+    /** The collocation points used within each waypoint */
+    CollocationScheme scheme = CollocationScheme::LegendreGaussLobatto;
+
+    /** What Ipopt sees as the time variable of each waypoint (see time_parameterization.h).
+     * The initial guess, the bounds and the solution are always in durations. */
+    TimeVariable time_variable = TimeVariable::Duration;
+
+    /** The number of control nodes of each waypoint, from which its controls are interpolated
+     * (see RuntimeControlReduction). Zero keeps the controls at every collocation point as variables. */
+    Index control_nodes = 0;
+
+    /** The number of waypoints */
+    Index n_w() const {
+        return waypoints.cols();
+    }
+
+    /** Fill x with the initial guess selected by guess */
+    void initialGuess(const RuntimeVariableGetter<Scalar, Index, n_x, n_u> &get, Scalar *x) const {
+        if (guess == InitialGuess::WarmStart && warm_start_node_counts == get.node_counts)
+            Eigen::Map<TrajectoryVector<Scalar>>(x, get.n_vars) = warm_start;
+        else if (guess != InitialGuess::StraightLine)
+            minimumSnapGuess(initial_state, waypoints, guess_velocity, guess_acceleration,
+                             time_lower, time_upper, initial_time, scheme, get, x);
+        else
+            straightLineGuess(get, x);
+    }
+
+    /** Fill x with the straight line from each waypoint to the next, with all of the controls set to zero */
+    void straightLineGuess(const RuntimeVariableGetter<Scalar, Index, n_x, n_u> &get, Scalar *x) const {
+        get.setZero(x);
+        get.times(x).fill(initial_time);
+        for (Index i_w = 0; i_w < n_w(); ++i_w) {
+
+            /* interpolated = final - (1 - collocation_point) * ( final - initial ) */
+            const State initial = i_w == 0 ? initial_state : State(waypoints.col(i_w - 1));
+            const State final = waypoints.col(i_w);
+            const TrajectoryVector<Scalar> points = generateCollocationPoints<Scalar>(get.n_c(i_w), scheme);
+            auto states = get.statesAtWaypoint(x, i_w);
+            for (Index i_c = 0; i_c < get.n_c(i_w); ++i_c)
+                states.col(i_c) = final - (1 - points(i_c)) * (final - initial);
+        }
+    }
+
+    /** Fill in the variable bounds */
+    void variableBounds(const RuntimeVariableGetter<Scalar, Index, n_x, n_u> &get,
+                        Scalar *lower,
+                        Scalar *upper) const {
+        for (Index i_w = 0; i_w < n_w(); ++i_w) {
+            get.statesAtWaypoint(lower, i_w).colwise() = state_lower;
+            get.statesAtWaypoint(upper, i_w).colwise() = state_upper;
+            get.controlsAtWaypoint(lower, i_w).colwise() = control_lower;
+            get.controlsAtWaypoint(upper, i_w).colwise() = control_upper;
+        }
+        get.times(lower).fill(time_lower);
+        get.times(upper).fill(time_upper);
+    }
+};
+
+/**
+ * The constraints and cost function of a problem, transcribed with the node counts of a RuntimeVariableGetter.
+ * Adjacent waypoints hold separate copies of their boundary nodes, which the collocation constraints tie together.
+ * The rows of this transcription are the canonical row order of the multipliers in a TrajectorySolution.
+ * The times of its variables are the time variables of problem.time_variable.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+struct RuntimeTranscription {
+
+    using ADScalar = CppAD::AD<Scalar>;
+    using GetAD = RuntimeVariableGetter<ADScalar, Index, n_x, n_u>;
+    using Constraints = std::tuple<
+        RuntimeCollocationConstraints<ADScalar, Index, n_x, n_u>,
+        RuntimeControlRateConstraints<ADScalar, Index, n_x, n_u>,
+        RuntimeDynamicsConstraints<ADScalar, Index, n_x, n_u>,
+        RuntimeInitialStateConstraints<ADScalar, Index, n_x, n_u>,
+        RuntimeSmoothControlConstraints<ADScalar, Index, n_x, n_u>,
+        RuntimeWaypointConstraints<ADScalar, Index, n_x, n_u>
+    >;
+    using Fused = RuntimeFusedConstraint<Constraints, ADScalar, Index, n_x, n_u>;
+    using FG = RuntimeFG_eval<TrajectoryVector, Scalar, Fused>;
+
+    /** The number of collocation rows, which come first */
+    const Index n_collocation_rows;
+
+    Fused fused_constraints;
+
+    FG fg_eval;
+
+    RuntimeTranscription(const TrajectoryProblem<Scalar, Index, n_x, n_u> &problem,
+                         const RuntimeVariableGetter<Scalar, Index, n_x, n_u> &get)
+            : n_collocation_rows((n_x + n_u) * (get.n_w - 1)),
+              fused_constraints(constraints(problem, GetAD(get.node_counts)),
+                                GetAD(get.node_counts),
+                                problem.scheme,
+                                problem.time_variable),
+              fg_eval(fused_constraints) {
+    }
+
+    /* The FG_eval holds a reference to the fused constraints */
+    RuntimeTranscription(const RuntimeTranscription &) = delete;
+    RuntimeTranscription &operator=(const RuntimeTranscription &) = delete;
+
+private:
+
+    static Constraints constraints(const TrajectoryProblem<Scalar, Index, n_x, n_u> &problem, const GetAD &get_ad) {
+        return Constraints(
+            RuntimeCollocationConstraints<ADScalar, Index, n_x, n_u>(get_ad),
+            RuntimeControlRateConstraints<ADScalar, Index, n_x, n_u>(get_ad,
+                                                                     problem.control_rate_lower,
+                                                                     problem.control_rate_upper),
+            RuntimeDynamicsConstraints<ADScalar, Index, n_x, n_u>(get_ad),
+            RuntimeInitialStateConstraints<ADScalar, Index, n_x, n_u>(get_ad, problem.initial_state),
+            RuntimeSmoothControlConstraints<ADScalar, Index, n_x, n_u>(get_ad),
+            RuntimeWaypointConstraints<ADScalar, Index, n_x, n_u>(get_ad, problem.waypoints)
+        );
+    }
+};
+
+/**
+ * Presolve (see presolve.h) and solve the problem of fg_eval with Ipopt, starting from xi, and expand the solution
+ * to the variables of fg_eval. toSolution(y, x) fills x, in the layout of get and in durations, from the variables y
+ * of fg_eval, which is how the iterates are published to the IterateStream of the control.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, typename FG, typename ToSolution>
+CppAD::ipopt::solve_result<TrajectoryVector<Scalar>>
+solvePresolved(FG &fg_eval,
+               const RuntimeVariableGetter<Scalar, Index, n_x, n_u> &get,
+               const TrajectoryVector<Scalar> &xi,
+               const TrajectoryVector<Scalar> &xl,
+               const TrajectoryVector<Scalar> &xu,
+               const TrajectoryVector<Scalar> &gl,
+               const TrajectoryVector<Scalar> &gu,
+               const std::string &options,
+               SolveControl *control,
+               const ToSolution &toSolution) {
+
+    /* Remove the variables that are pinned by the bounds, the initial state, and the waypoints */
+    Presolve<TrajectoryVector<Scalar>, FG> presolve(fg_eval, xi, xl, xu, gl, gu);
+    using ReducedFG = typename Presolve<TrajectoryVector<Scalar>, FG>::ReducedFG;
+
+    IterateHandler handler;
+    if (control && control->getIterateStream()) {
+        handler.stream = control->getIterateStream();
+        handler.publish = [&](const double *reduced_x, const SolveProgress &progress) {
+            TrajectoryIterate *iterate = handler.stream->producerSlot();
+            if (!iterate)
+                return;
+            iterate->iteration = progress.iteration;
+            iterate->objective = progress.objective;
+            iterate->infeasibility = progress.infeasibility;
+            iterate->node_counts = get.node_counts;
+            iterate->x.resize(get.n_vars);
+            TrajectoryVector<Scalar> y(xi.size());
+            presolve.expandVariables(reduced_x, y.data());
+            toSolution(y.data(), iterate->x.data());
+            handler.stream->publish();
+        };
+    }
+
+    SolveControl unlimited;
+    CppAD::ipopt::solve_result<TrajectoryVector<Scalar>> reduced_solution;
+    solveInterruptible<TrajectoryVector<Scalar>, ReducedFG>(options,
+                                                            presolve.xi,
+                                                            presolve.xl,
+                                                            presolve.xu,
+                                                            presolve.gl,
+                                                            presolve.gu,
+                                                            presolve.reduced_fg,
+                                                            reduced_solution,
+                                                            control ? *control : unlimited,
+                                                            handler);
+
+    CppAD::ipopt::solve_result<TrajectoryVector<Scalar>> solution;
+    presolve.expand(reduced_solution, solution);
+    return solution;
+}
+
+/**
+ * Transcribe the problem with the specified number of collocation points for each waypoint
+ * (see RuntimeVariableGetter), and solve it with Ipopt starting from x. The times of x and of the solution
+ * are durations, whatever the time variable of the problem is, and x and the solution are in the layout of get,
+ * whatever problem.control_nodes is.
+ * If a control is given, the solve can be cancelled or given a deadline through it (see interruptible_solve.h),
+ * and its iterates are published to the IterateStream of the control, if it has one.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+CppAD::ipopt::solve_result<TrajectoryVector<Scalar>>
+solveRuntimeTrajectory(const TrajectoryProblem<Scalar, Index, n_x, n_u> &problem,
+                       const RuntimeVariableGetter<Scalar, Index, n_x, n_u> &get,
+                       const TrajectoryVector<Scalar> &x,
+                       const std::string &options,
+                       SolveControl *control = nullptr) {
+
+    using Transcription = RuntimeTranscription<Scalar, Index, n_x, n_u>;
+    Transcription transcription(problem, get);
+    const TrajectoryVector<Scalar> &gl = transcription.fused_constraints.lower_bound;
+    const TrajectoryVector<Scalar> &gu = transcription.fused_constraints.upper_bound;
+
+    TrajectoryVector<Scalar> lower_bound(get.n_vars);
+    TrajectoryVector<Scalar> upper_bound(get.n_vars);
+    problem.variableBounds(get, lower_bound.data(), upper_bound.data());
+    toTimeVariableBounds(problem.time_variable, get, lower_bound.data(), upper_bound.data());
+    TrajectoryVector<Scalar> initial_guess = x;
+    toTimeVariables(problem.time_variable, get, initial_guess.data());
+
+    CppAD::ipopt::solve_result<TrajectoryVector<Scalar>> solution;
+    if (problem.control_nodes == 0) {
+        solution = solvePresolved(transcription.fg_eval, get, initial_guess, lower_bound, upper_bound, gl, gu,
+                                  options, control, [&](const Scalar *y, Scalar *full) {
+                                      std::copy(y, y + get.n_vars, full);
+                                      toDurations(problem.time_variable, get, full);
+                                  });
+    } else {
+        /* Solve for the control nodes, and interpolate the controls of the solution */
+        using Reduction = RuntimeControlReduction<Scalar, Index, n_x, n_u>;
+        const Reduction reduction(get, problem.control_nodes, problem.scheme);
+        typename Reduction::template FG<typename Transcription::FG> reduced_fg(reduction, transcription.fg_eval);
+
+        TrajectoryVector<Scalar> z(reduction.n_vars), z_lower(reduction.n_vars), z_upper(reduction.n_vars);
+        reduction.reduce(initial_guess.data(), z.data());
+        reduction.reduceBounds(lower_bound.data(), upper_bound.data(), z_lower.data(), z_upper.data());
+
+        const auto reduced = solvePresolved(reduced_fg, get, z, z_lower, z_upper, gl, gu, options, control,
+                                            [&](const Scalar *y, Scalar *full) {
+                                                reduction.expand(y, full);
+                                                toDurations(problem.time_variable, get, full);
+                                            });
+        solution.status = reduced.status;
+        solution.obj_value = reduced.obj_value;
+        solution.g = reduced.g;
+        solution.lambda = reduced.lambda;
+        solution.x.resize(get.n_vars);
+        solution.zl.resize(get.n_vars);
+        solution.zu.resize(get.n_vars);
+        reduction.expand(reduced.x.data(), solution.x.data());
+        reduction.expandBoundMultipliers(reduced.zl.data(), solution.zl.data());
+        reduction.expandBoundMultipliers(reduced.zu.data(), solution.zu.data());
+    }
+
+    toDurationMultipliers(problem.time_variable, get, solution.x.data(), solution.zl.data(), solution.zu.data());
+    toDurations(problem.time_variable, get, solution.x.data());
+    return solution;
+}
+
+#endif /* TRAJECTORY_PROBLEM_HEADER */
@@ -0,0 +1,297 @@
+#ifndef TRAJECTORY_SAMPLER_HEADER
+#define TRAJECTORY_SAMPLER_HEADER
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include "Eigen/Dense"
+#include "runtime_variable_getter.h"
+#include "trajectory_solver.h"
+#include "utils.h"
+
+/**
+ * Evaluates the interpolant of a solution, that is, the Lagrange polynomial through the collocation points
+ * of each waypoint, at any time from the start of the trajectory. This is meant for a control loop, so
+ * everything that does not depend on the time is computed once here: the start of each waypoint, the barycentric
+ * weights of its points, and the derivatives of the states and controls at its points. Sampling uses
+ * fixed-capacity storage on the stack and does not allocate.
+ *
+ * Each sample costs one pass over the n_c points of its waypoint for the coefficients, and a matrix-vector
+ * product with them, which Eigen vectorizes. The batches of times are split into runs of up to max_batch
+ * consecutive times that fall into the same waypoint, and each run costs a single product of the nodes of its
+ * waypoint with the coefficients of all of its times, so sorted times are the fastest.
+ * Times outside of the trajectory are clamped to its ends.
+ * Waypoints that take no time are never sampled, unless the whole trajectory takes none, in which case
+ * the rates are zero.
+ *
+ * @tparam max_n_c: The most collocation points that a waypoint may have
+ * @tparam max_batch: The most times that a batch evaluates with one product
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index max_n_c = 64, Index max_batch = 16>
+class TrajectorySampler {
+public:
+
+    using State = Eigen::Matrix<Scalar, n_x, 1>;
+    using Control = Eigen::Matrix<Scalar, n_u, 1>;
+
+private:
+
+    static const Index n_vars = n_x + n_u;
+
+    using Vars = Eigen::Matrix<Scalar, n_vars, 1>;
+    using Coefficients = Eigen::Matrix<Scalar, Eigen::Dynamic, 1, 0, max_n_c, 1>;
+
+    /** The coefficients of a run of times, one per column, and the variables at those times */
+    using CoefficientBlock = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, 0, max_n_c, max_batch>;
+    using VarsBlock = Eigen::Matrix<Scalar, n_vars, Eigen::Dynamic, 0, n_vars, max_batch>;
+
+    /** The states and controls of every node, and their derivatives with respect to time */
+    Eigen::Matrix<Scalar, n_vars, Eigen::Dynamic> nodes;
+    Eigen::Matrix<Scalar, n_vars, Eigen::Dynamic> node_derivatives;
+
+    /** The collocation points and their barycentric weights, node by node */
+    TrajectoryVector<Scalar> points;
+    TrajectoryVector<Scalar> weights;
+
+    /** The first node of each waypoint, with one more entry for the end */
+    std::vector<Index> offsets;
+
+    /** The time at the start of each waypoint, with one more entry for the end, and the duration of each */
+    std::vector<Scalar> starts;
+    std::vector<Scalar> durations;
+
+    /** The first and last waypoint that take some time, which the times before and after the trajectory fall into */
+    Index first = 0;
+    Index last = 0;
+
+    /** The waypoint that contains t, trying hint first, since batches of times are usually sorted */
+    Index segment(Scalar t, Index hint) const {
+        if (hint < durations.size() && starts[hint] <= t && t < starts[hint + 1])
+            return hint;
+        /* Between the ends, the last start at or before t belongs to a waypoint that takes some time */
+        const Index upper = std::upper_bound(starts.begin(), starts.end(), t) - starts.begin();
+        if (upper == 0)
+            return first;
+        if (upper > durations.size())
+            return last;
+        return upper - 1;
+    }
+
+    /** The time t of waypoint i_w as a fraction of its duration */
+    Scalar fraction(Index i_w, Scalar t) const {
+        return durations[i_w] > 0
+               ? std::min(std::max((t - starts[i_w]) / durations[i_w], Scalar(0)), Scalar(1))
+               : Scalar(t <= starts[i_w] ? 0 : 1);
+    }
+
+    /**
+     * Write the n_c interpolation coefficients of the waypoint at tau into values, and if derivatives is given,
+     * those of the derivative with respect to time. Return the index of the node if tau is one of the points,
+     * or the number of points otherwise, in which case the coefficients are set.
+     */
+    Index coefficients(Index i_w, Scalar tau, Scalar *values, Scalar *derivatives) const {
+        const Index offset = offsets[i_w];
+        const Index n_c = offsets[i_w + 1] - offset;
+        for (Index j = 0; j < n_c; ++j)
+            if (tau == points(offset + j))
+                return j;
+
+        /* The barycentric formula p = sum_j a_j f_j / sum_j a_j with a_j = w_j / (tau - c_j), and
+         * p' = sum_j a_j (s - 1 / (tau - c_j)) f_j / sum_j a_j with s = sum_j a_j / (tau - c_j) / sum_j a_j */
+        const Eigen::Array<Scalar, Eigen::Dynamic, 1, 0, max_n_c, 1> inverse_distances =
+            (tau - points.segment(offset, n_c).array()).inverse();
+        Eigen::Map<Eigen::Array<Scalar, Eigen::Dynamic, 1>> a(values, n_c);
+        a = weights.segment(offset, n_c).array() * inverse_distances;
+        const Scalar a_sum = a.sum();
+        if (derivatives) {
+            const Scalar s = (a * inverse_distances).sum() / a_sum;
+            Eigen::Map<Eigen::Array<Scalar, Eigen::Dynamic, 1>>(derivatives, n_c) =
+                a * (s - inverse_distances) / (a_sum * durations[i_w]);
+        }
+        a /= a_sum;
+        return n_c;
+    }
+
+    /** Evaluate the variables, and their derivatives if given, at t */
+    void evaluate(Scalar t, Vars &vars, Vars *derivatives) const {
+        const Index i_w = segment(t, 0);
+        const Index offset = offsets[i_w];
+        const Index n_c = offsets[i_w + 1] - offset;
+
+        Coefficients values(n_c);
+        Coefficients derivative_values(n_c);
+        const Index node = coefficients(i_w, fraction(i_w, t), values.data(),
+                                        derivatives ? derivative_values.data() : nullptr);
+        if (node < n_c) {
+            vars = nodes.col(offset + node);
+            if (derivatives)
+                *derivatives = node_derivatives.col(offset + node);
+            return;
+        }
+        vars.noalias() = nodes.middleCols(offset, n_c) * values;
+        if (derivatives)
+            derivatives->noalias() = nodes.middleCols(offset, n_c) * derivative_values;
+    }
+
+    /**
+     * Evaluate the variables, and their derivatives if given, at the run of times that starts at begin:
+     * the following times that fall into the same waypoint as times(begin), but at most max_batch of them.
+     * The waypoint is found from hint first, and then becomes the hint for the next run.
+     * Return the number of times in the run, which is the number of columns of vars.
+     */
+    template<typename Times>
+    Index evaluateRun(const Times &times, Index begin, Index &hint, VarsBlock &vars, VarsBlock *derivatives) const {
+        const Index i_w = segment(times(begin), hint);
+        hint = i_w;
+        const Index offset = offsets[i_w];
+        const Index n_c = offsets[i_w + 1] - offset;
+
+        CoefficientBlock values(n_c, +max_batch);
+        CoefficientBlock derivative_values(n_c, derivatives ? +max_batch : 0);
+        Index nodes_at[max_batch];
+        Index n_times = 0;
+        for (Index i = begin; i < Index(times.size()) && n_times < max_batch; ++i, ++n_times) {
+            if (segment(times(i), i_w) != i_w)
+                break;
+            nodes_at[n_times] = coefficients(i_w, fraction(i_w, times(i)), values.col(n_times).data(),
+                                             derivatives ? derivative_values.col(n_times).data() : nullptr);
+            if (nodes_at[n_times] < n_c) {
+                values.col(n_times).setZero();
+                values(nodes_at[n_times], n_times) = 1;
+                if (derivatives)
+                    derivative_values.col(n_times).setZero();
+            }
+        }
+
+        vars.resize(+n_vars, n_times);
+        vars.noalias() = nodes.middleCols(offset, n_c) * values.leftCols(n_times);
+        if (derivatives) {
+            derivatives->resize(+n_vars, n_times);
+            derivatives->noalias() = nodes.middleCols(offset, n_c) * derivative_values.leftCols(n_times);
+            /* At a node, the derivative of the interpolant is known exactly */
+            for (Index k = 0; k < n_times; ++k)
+                if (nodes_at[k] < n_c)
+                    derivatives->col(k) = node_derivatives.col(offset + nodes_at[k]);
+        }
+        return n_times;
+    }
+
+public:
+
+    /** Sample the solution x in the layout of get, whose collocation points follow scheme */
+    TrajectorySampler(const RuntimeVariableGetter<Scalar, Index, n_x, n_u> &get,
+                      const Scalar *x,
+                      CollocationScheme scheme)
+            : nodes(+n_vars, get.n_nodes),
+              node_derivatives(+n_vars, get.n_nodes),
+              points(get.n_nodes),
+              weights(get.n_nodes),
+              offsets(get.n_w + 1, 0),
+              starts(get.n_w + 1, 0),
+              durations(get.n_w),
+              last(get.n_w - 1) {
+        assert(get.n_w > 0);
+        for (Index i_w = 0; i_w < get.n_w; ++i_w) {
+            const Index n_c = get.n_c(i_w);
+            assert(n_c >= 2 && n_c <= max_n_c);
+            const Index offset = offsets[i_w];
+            offsets[i_w + 1] = offset + n_c;
+            durations[i_w] = get.times(x)(i_w);
+            starts[i_w + 1] = starts[i_w] + durations[i_w];
+
+            const TrajectoryVector<Scalar> waypoint_points = generateCollocationPoints<Scalar>(n_c, scheme);
+            points.segment(offset, n_c) = waypoint_points;
+            weights.segment(offset, n_c) = barycentricWeights(waypoint_points);
+            nodes.middleCols(offset, n_c) = get.varsAtWaypoint(x, i_w);
+            if (durations[i_w] > 0)
+                node_derivatives.middleCols(offset, n_c) =
+                    get.varsAtWaypoint(x, i_w) * lagrangeDerivativeCoefficients(waypoint_points) / durations[i_w];
+            else
+                node_derivatives.middleCols(offset, n_c).setZero();
+        }
+        while (first < last && !(durations[first] > 0))
+            ++first;
+        while (last > first && !(durations[last] > 0))
+            --last;
+    }
+
+    /** Sample a solution, whose collocation points follow scheme */
+    TrajectorySampler(const TrajectorySolution<Scalar, Index, n_x, n_u> &solution, CollocationScheme scheme)
+            : TrajectorySampler(solution.layout(), solution.x.data(), scheme) {
+    }
+
+    /** The total time of the trajectory */
+    Scalar duration() const {
+        return starts.back();
+    }
+
+    /** The state and control at t */
+    void sample(Scalar t, State &state, Control &control) const {
+        Vars vars;
+        evaluate(t, vars, nullptr);
+        state = vars.template head<n_x>();
+        control = vars.template tail<n_u>();
+    }
+
+    /** The state and control at t, and their derivatives with respect to time */
+    void sample(Scalar t, State &state, Control &control, State &state_rate, Control &control_rate) const {
+        Vars vars;
+        Vars derivatives;
+        evaluate(t, vars, &derivatives);
+        state = vars.template head<n_x>();
+        control = vars.template tail<n_u>();
+        state_rate = derivatives.template head<n_x>();
+        control_rate = derivatives.template tail<n_u>();
+    }
+
+    /**
+     * The states and controls at each of the times, one per column of the outputs,
+     * which the caller sizes. Sorted times are the fastest.
+     */
+    template<typename Times, typename States, typename Controls>
+    void sample(const Eigen::MatrixBase<Times> &times,
+                const Eigen::MatrixBase<States> &states_,
+                const Eigen::MatrixBase<Controls> &controls_) const {
+        Eigen::MatrixBase<States> &states = const_cast<Eigen::MatrixBase<States> &>(states_);
+        Eigen::MatrixBase<Controls> &controls = const_cast<Eigen::MatrixBase<Controls> &>(controls_);
+        assert(states.cols() == times.size() && controls.cols() == times.size());
+
+        VarsBlock vars;
+        Index hint = 0;
+        for (Index i = 0; i < Index(times.size());) {
+            const Index n_times = evaluateRun(times, i, hint, vars, nullptr);
+            states.middleCols(i, n_times) = vars.template topRows<n_x>();
+            controls.middleCols(i, n_times) = vars.template bottomRows<n_u>();
+            i += n_times;
+        }
+    }
+
+    /** The same as above, and the derivatives of the states and controls with respect to time */
+    template<typename Times, typename States, typename Controls, typename StateRates, typename ControlRates>
+    void sample(const Eigen::MatrixBase<Times> &times,
+                const Eigen::MatrixBase<States> &states_,
+                const Eigen::MatrixBase<Controls> &controls_,
+                const Eigen::MatrixBase<StateRates> &state_rates_,
+                const Eigen::MatrixBase<ControlRates> &control_rates_) const {
+        Eigen::MatrixBase<States> &states = const_cast<Eigen::MatrixBase<States> &>(states_);
+        Eigen::MatrixBase<Controls> &controls = const_cast<Eigen::MatrixBase<Controls> &>(controls_);
+        Eigen::MatrixBase<StateRates> &state_rates = const_cast<Eigen::MatrixBase<StateRates> &>(state_rates_);
+        Eigen::MatrixBase<ControlRates> &control_rates = const_cast<Eigen::MatrixBase<ControlRates> &>(control_rates_);
+        assert(states.cols() == times.size() && controls.cols() == times.size());
+        assert(state_rates.cols() == times.size() && control_rates.cols() == times.size());
+
+        VarsBlock vars;
+        VarsBlock derivatives;
+        Index hint = 0;
+        for (Index i = 0; i < Index(times.size());) {
+            const Index n_times = evaluateRun(times, i, hint, vars, &derivatives);
+            states.middleCols(i, n_times) = vars.template topRows<n_x>();
+            controls.middleCols(i, n_times) = vars.template bottomRows<n_u>();
+            state_rates.middleCols(i, n_times) = derivatives.template topRows<n_x>();
+            control_rates.middleCols(i, n_times) = derivatives.template bottomRows<n_u>();
+            i += n_times;
+        }
+    }
+};
+
+#endif /* TRAJECTORY_SAMPLER_HEADER */
@@ -0,0 +1,52 @@
+#include "trajectory_solver.h"
+
+/* The fixed-size kernels */
+#define TRAJECTORY_KERNEL_INSTANTIATION(n_c, n_w) \
+    template QuadrotorSolution solveFixedTrajectory<double, size_t, QuadrotorDynamics<double>::n_x, QuadrotorDynamics<double>::n_u, n_c, n_w>( \
+        const QuadrotorProblem &, const std::string &, SolveControl *);
+
+TRAJECTORY_KERNELS(TRAJECTORY_KERNEL_INSTANTIATION)
+
+#undef TRAJECTORY_KERNEL_INSTANTIATION
+
+namespace {
+
+using Kernel = QuadrotorSolution (*)(const QuadrotorProblem &, const std::string &, SolveControl *);
+
+struct KernelEntry {
+    size_t n_c;
+    size_t n_w;
+    Kernel kernel;
+};
+
+#define TRAJECTORY_KERNEL_ENTRY(n_c, n_w) \
+    {n_c, n_w, &solveFixedTrajectory<double, size_t, QuadrotorDynamics<double>::n_x, QuadrotorDynamics<double>::n_u, n_c, n_w>},
+
+const KernelEntry kernels[] = {
+    TRAJECTORY_KERNELS(TRAJECTORY_KERNEL_ENTRY)
+};
+
+#undef TRAJECTORY_KERNEL_ENTRY
+
+Kernel findKernel(size_t n_c, size_t n_w) {
+    for (const KernelEntry &entry : kernels)
+        if (entry.n_c == n_c && entry.n_w == n_w)
+            return entry.kernel;
+    return nullptr;
+}
+
+}
+
+bool hasFixedTrajectoryKernel(size_t n_c, size_t n_w) {
+    return findKernel(n_c, n_w) != nullptr;
+}
+
+QuadrotorSolution solveTrajectory(const QuadrotorProblem &problem,
+                                  size_t n_c,
+                                  const std::string &options,
+                                  SolveControl *control) {
+    Kernel kernel = findKernel(n_c, problem.n_w());
+    if (kernel && problem.time_variable == TimeVariable::Duration && problem.control_nodes == 0)
+        return kernel(problem, options, control);
+    return solveRuntimeTrajectory(problem, n_c, options, control);
+}
@@ -0,0 +1,343 @@
+#ifndef TRAJECTORY_SOLVER_HEADER
+#define TRAJECTORY_SOLVER_HEADER
+
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "cppad/example/cppad_eigen.hpp"
+#include "cppad/ipopt/solve.hpp"
+#include "Eigen/Dense"
+
+#include "fg_eval.h"
+#include "fused_contraint.h"
+#include "interruptible_solve.h"
+#include "presolve.h"
+#include "quadrotor_dynamics.h"
+#include "runtime_variable_getter.h"
+#include "shared_variable_getter.h"
+#include "trajectory_problem.h"
+
+#include "control_rate_constraints.h"
+#include "dynamics_constraints.h"
+#include "initial_state_constraints.h"
+#include "smooth_control_constraints.h"
+#include "waypoint_constraints.h"
+
+/** The fixed-size vector type of the bounds in the FusedConstraint */
+template<size_t size>
+using TrajectoryArray = Eigen::Matrix<double, size, 1>;
+
+/**
+ * The solution of a TrajectoryProblem. Regardless of how the problem was solved,
+ * x is stored in the layout of RuntimeVariableGetter(node_counts).
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+struct TrajectorySolution {
+
+    using Result = CppAD::ipopt::solve_result<TrajectoryVector<Scalar>>;
+
+    typename Result::status_type status = Result::not_defined;
+
+    /** The value of the cost function, that is, the total time */
+    Scalar cost = 0;
+
+    /** The number of collocation points of each waypoint */
+    std::vector<Index> node_counts;
+
+    /** The states, controls and times */
+    TrajectoryVector<Scalar> x;
+
+    /** The multipliers of the lower and upper variable bounds, in the layout of x */
+    TrajectoryVector<Scalar> z_lower;
+    TrajectoryVector<Scalar> z_upper;
+
+    /** The multipliers of the constraints, in the row order of the RuntimeTranscription for node_counts,
+     * whichever transcription solved the problem */
+    TrajectoryVector<Scalar> lambda;
+
+    /** The layout of x */
+    RuntimeVariableGetter<Scalar, Index, n_x, n_u> layout() const {
+        return RuntimeVariableGetter<Scalar, Index, n_x, n_u>(node_counts);
+    }
+};
+
+/**
+ * The constraints and cost function of a problem with n_c collocation points for each of the n_w waypoints,
+ * where adjacent waypoints share their boundary node (see SharedVariableGetter). Since the boundary nodes are
+ * shared, there are no collocation constraints, and the rows are those of the RuntimeTranscription after its
+ * collocation rows, in the same order.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+struct FixedTranscription {
+
+    using ADScalar = CppAD::AD<Scalar>;
+    using Get = SharedVariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using GetAD = SharedVariableGetter<ADScalar, Index, n_x, n_u, n_c, n_w>;
+    using RuntimeGet = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Constraints = std::tuple<
+        ControlRateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>,
+        DynamicsConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>,
+        InitialStateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>,
+        SmoothControlConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>,
+        WaypointConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>
+    >;
+    /* Evaluate waypoint by waypoint, so each segment is taped while its variables are in cache */
+    using Fused = FusedConstraint<Constraints, ADScalar, Index, n_x, n_u, n_c, n_w,
+        TrajectoryArray, SharedVariableGetter, AutoStorage<>, EvaluationOrder::WaypointMajor>;
+    using FG = FG_eval<TrajectoryVector, Scalar, Fused, GetAD>;
+
+    Fused fused_constraints;
+
+    FG fg_eval;
+
+    explicit FixedTranscription(const TrajectoryProblem<Scalar, Index, n_x, n_u> &problem)
+            : fused_constraints(Constraints(
+                  ControlRateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(
+                      problem.control_rate_lower, problem.control_rate_upper),
+                  DynamicsConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(),
+                  InitialStateConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(problem.initial_state),
+                  SmoothControlConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(),
+                  WaypointConstraints<ADScalar, Index, n_x, n_u, n_c, n_w, SharedVariableGetter>(problem.waypoints)),
+                                generateCollocationPoints<Scalar>(n_c, problem.scheme)),
+              fg_eval(fused_constraints) {
+        assert(problem.n_w() == n_w);
+    }
+
+    /* The FG_eval holds a reference to the fused constraints */
+    FixedTranscription(const FixedTranscription &) = delete;
+    FixedTranscription &operator=(const FixedTranscription &) = delete;
+
+    /** Copy x into the layout of get, which must have n_c points for each waypoint.
+     * Each shared node is written to both of its copies. */
+    template<typename T>
+    static void toRuntimeLayout(const RuntimeGet &get, const T *x, T *runtime_x) {
+        for (Index i_w = 0; i_w < n_w; ++i_w)
+            get.varsAtWaypoint(runtime_x, i_w) = Get::varsAtWaypoint(x, i_w);
+        get.times(runtime_x) = Get::times(x);
+    }
+
+    /** Copy runtime_x from the layout of get into x. Going waypoint by waypoint writes each shared node twice,
+     * so the second copy wins, which is the same if the collocation constraints hold. */
+    template<typename T>
+    static void fromRuntimeLayout(const RuntimeGet &get, const T *runtime_x, T *x) {
+        for (Index i_w = 0; i_w < n_w; ++i_w)
+            Get::varsAtWaypoint(x, i_w) = get.varsAtWaypoint(runtime_x, i_w);
+        Get::times(x) = get.times(runtime_x);
+    }
+
+    /**
+     * Map the row multipliers lambda of this transcription to the rows of the RuntimeTranscription at runtime_x.
+     * The rows that both have keep their multipliers. The bound multipliers of each shared node are left to its
+     * copy at the end of the earlier waypoint, so the multiplier of each collocation row is the one that makes
+     * the runtime Lagrangian stationary with respect to the copy at the start of the later waypoint.
+     * This records the runtime transcription once.
+     */
+    static TrajectoryVector<Scalar> runtimeMultipliers(const TrajectoryProblem<Scalar, Index, n_x, n_u> &problem,
+                                                       const RuntimeGet &get,
+                                                       const TrajectoryVector<Scalar> &runtime_x,
+                                                       const TrajectoryVector<Scalar> &lambda) {
+        RuntimeTranscription<Scalar, Index, n_x, n_u> runtime(problem, get);
+        const Index n_rows = runtime.fused_constraints.n_constraints;
+        assert(Index(lambda.size()) + runtime.n_collocation_rows == n_rows);
+
+        TrajectoryVector<ADScalar> x = runtime_x.template cast<ADScalar>();
+        CppAD::Independent(x);
+        TrajectoryVector<ADScalar> fg(1 + n_rows);
+        runtime.fg_eval(fg, x);
+        CppAD::ADFun<Scalar> fun(x, fg);
+
+        TrajectoryVector<Scalar> runtime_lambda = TrajectoryVector<Scalar>::Zero(n_rows);
+        runtime_lambda.tail(lambda.size()) = lambda;
+        TrajectoryVector<Scalar> weights(1 + n_rows);
+        weights << 1, runtime_lambda;
+        const TrajectoryVector<Scalar> gradient = fun.Reverse(1, weights);
+
+        /* Collocation row i_w-1 is v(i_w, 0) - v(i_w-1, n_c-1). Its weight is still zero, so its multiplier
+         * is minus the gradient at v(i_w, 0) */
+        for (Index i_w = 1; i_w < n_w; ++i_w)
+            runtime_lambda.segment((n_x + n_u) * (i_w - 1), n_x + n_u) = -get.varsAtWaypoint(gradient.data(), i_w).col(0);
+        return runtime_lambda;
+    }
+};
+
+/**
+ * Solve the problem with n_c collocation points for each of the n_w waypoints, where both
+ * are known at compile time. Adjacent waypoints share their boundary node (see SharedVariableGetter),
+ * and the solution is copied back into the layout of the RuntimeVariableGetter.
+ * The time variables are the durations, so problem.time_variable must be TimeVariable::Duration,
+ * and every collocation point holds its controls, so problem.control_nodes must be zero.
+ * If a control is given, the solve can be cancelled or given a deadline through it (see interruptible_solve.h),
+ * and its iterates are published to the IterateStream of the control, if it has one.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+TrajectorySolution<Scalar, Index, n_x, n_u>
+solveFixedTrajectory(const TrajectoryProblem<Scalar, Index, n_x, n_u> &problem,
+                     const std::string &options,
+                     SolveControl *control = nullptr) {
+
+    using Transcription = FixedTranscription<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Get = typename Transcription::Get;
+    using RuntimeGet = RuntimeVariableGetter<Scalar, Index, n_x, n_u>;
+    using Vector = TrajectoryVector<Scalar>;
+
+    assert(problem.n_w() == n_w);
+    assert(problem.time_variable == TimeVariable::Duration);
+    assert(problem.control_nodes == 0);
+    const RuntimeGet runtime_get(n_c, n_w);
+    Transcription transcription(problem);
+
+    /* The initial guess and bounds are described in the runtime layout, where both copies of each shared node
+     * hold the same values */
+    Vector runtime_x(runtime_get.n_vars);
+    Vector runtime_lower(runtime_get.n_vars);
+    Vector runtime_upper(runtime_get.n_vars);
+    problem.initialGuess(runtime_get, runtime_x.data());
+    problem.variableBounds(runtime_get, runtime_lower.data(), runtime_upper.data());
+
+    Vector initial_guess(+Get::n_vars);
+    Vector lower_bound(+Get::n_vars);
+    Vector upper_bound(+Get::n_vars);
+    Transcription::fromRuntimeLayout(runtime_get, runtime_x.data(), initial_guess.data());
+    Transcription::fromRuntimeLayout(runtime_get, runtime_lower.data(), lower_bound.data());
+    Transcription::fromRuntimeLayout(runtime_get, runtime_upper.data(), upper_bound.data());
+
+    /* Remove the variables that are pinned by the bounds, the initial state, and the waypoints */
+    using FG = typename Transcription::FG;
+    Presolve<Vector, FG> presolve(transcription.fg_eval,
+                                  initial_guess,
+                                  lower_bound,
+                                  upper_bound,
+                                  transcription.fused_constraints.lower_bound,
+                                  transcription.fused_constraints.upper_bound);
+    using ReducedFG = typename Presolve<Vector, FG>::ReducedFG;
+
+    IterateHandler handler;
+    Vector full_iterate(+Get::n_vars);
+    if (control && control->getIterateStream()) {
+        handler.stream = control->getIterateStream();
+        handler.publish = [&](const double *reduced_x, const SolveProgress &progress) {
+            TrajectoryIterate *iterate = handler.stream->producerSlot();
+            if (!iterate)
+                return;
+            iterate->iteration = progress.iteration;
+            iterate->objective = progress.objective;
+            iterate->infeasibility = progress.infeasibility;
+            iterate->node_counts = runtime_get.node_counts;
+            iterate->x.resize(runtime_get.n_vars);
+            presolve.expandVariables(reduced_x, full_iterate.data());
+            Transcription::toRuntimeLayout(runtime_get, full_iterate.data(), iterate->x.data());
+            handler.stream->publish();
+        };
+    }
+
+    SolveControl unlimited;
+    CppAD::ipopt::solve_result<Vector> reduced_solution;
+    solveInterruptible<Vector, ReducedFG>(options,
+                                          presolve.xi,
+                                          presolve.xl,
+                                          presolve.xu,
+                                          presolve.gl,
+                                          presolve.gu,
+                                          presolve.reduced_fg,
+                                          reduced_solution,
+                                          control ? *control : unlimited,
+                                          handler);
+    CppAD::ipopt::solve_result<Vector> solution;
+    presolve.expand(reduced_solution, solution);
+
+    TrajectorySolution<Scalar, Index, n_x, n_u> result;
+    result.status = solution.status;
+    result.cost = solution.obj_value;
+    result.node_counts = runtime_get.node_counts;
+    result.x.resize(runtime_get.n_vars);
+    Transcription::toRuntimeLayout(runtime_get, solution.x.data(), result.x.data());
+    result.z_lower.resize(runtime_get.n_vars);
+    result.z_upper.resize(runtime_get.n_vars);
+    Transcription::toRuntimeLayout(runtime_get, solution.zl.data(), result.z_lower.data());
+    Transcription::toRuntimeLayout(runtime_get, solution.zu.data(), result.z_upper.data());
+    /* The bound multipliers of each shared node go to a single copy (see runtimeMultipliers) */
+    for (Index i_w = 1; i_w < n_w; ++i_w) {
+        runtime_get.varsAtWaypoint(result.z_lower.data(), i_w).col(0).setZero();
+        runtime_get.varsAtWaypoint(result.z_upper.data(), i_w).col(0).setZero();
+    }
+    result.lambda = Transcription::runtimeMultipliers(problem, runtime_get, result.x, solution.lambda);
+    return result;
+}
+
+/**
+ * Solve the problem with n_c collocation points for each waypoint using the runtime-sized classes.
+ */
+template<typename Scalar, typename Index, Index n_x, Index n_u>
+TrajectorySolution<Scalar, Index, n_x, n_u>
+solveRuntimeTrajectory(const TrajectoryProblem<Scalar, Index, n_x, n_u> &problem,
+                       Index n_c,
+                       const std::string &options,
+                       SolveControl *control = nullptr) {
+
+    const RuntimeVariableGetter<Scalar, Index, n_x, n_u> get(n_c, problem.n_w());
+    TrajectoryVector<Scalar> initial_guess(get.n_vars);
+    problem.initialGuess(get, initial_guess.data());
+    auto solution = solveRuntimeTrajectory(problem, get, initial_guess, options, control);
+
+    TrajectorySolution<Scalar, Index, n_x, n_u> result;
+    result.status = solution.status;
+    result.cost = solution.obj_value;
+    result.node_counts = get.node_counts;
+    result.x = solution.x;
+    result.z_lower = solution.zl;
+    result.z_upper = solution.zu;
+    result.lambda = solution.lambda;
+    return result;
+}
+
+/*
+ * ----------------------------------------------
+ *
+ * Dispatch
+ *
+ * ----------------------------------------------
+ */
+using QuadrotorProblem = TrajectoryProblem<double, size_t, QuadrotorDynamics<double>::n_x, QuadrotorDynamics<double>::n_u>;
+using QuadrotorSolution = TrajectorySolution<double, size_t, QuadrotorDynamics<double>::n_x, QuadrotorDynamics<double>::n_u>;
+
+/**
+ * The (n_c, n_w) combinations that are compiled with fixed sizes, in trajectory_solver.cpp.
+ * Every other combination is solved with the runtime-sized classes.
+ */
+#define TRAJECTORY_KERNELS(KERNEL) \
+    KERNEL(7, 2) KERNEL(7, 3) KERNEL(7, 4) KERNEL(7, 5) KERNEL(7, 6) \
+    KERNEL(11, 2) KERNEL(11, 3) KERNEL(11, 4) KERNEL(11, 5) KERNEL(11, 6)
+
+#define TRAJECTORY_KERNEL_DECLARATION(n_c, n_w) \
+    extern template QuadrotorSolution solveFixedTrajectory<double, size_t, QuadrotorDynamics<double>::n_x, QuadrotorDynamics<double>::n_u, n_c, n_w>( \
+        const QuadrotorProblem &, const std::string &, SolveControl *);
+
+TRAJECTORY_KERNELS(TRAJECTORY_KERNEL_DECLARATION)
+
+#undef TRAJECTORY_KERNEL_DECLARATION
+
+/**
+ * Solve the problem with n_c collocation points for each waypoint. If a fixed-size kernel was compiled
+ * for n_c and the number of waypoints, use it. Otherwise, fall back to the runtime-sized classes.
+ * The fixed-size kernels solve in durations with a control at every collocation point, so any other time variable
+ * and any number of control nodes also use the runtime-sized classes.
+ * The fixed-size kernels share the boundary nodes while the runtime path duplicates them and adds the
+ * collocation constraints, so both transcriptions have the same solutions.
+ * If a control is given, the solve can be cancelled or given a deadline through it (see interruptible_solve.h).
+ */
+QuadrotorSolution solveTrajectory(const QuadrotorProblem &problem,
+                                  size_t n_c,
+                                  const std::string &options,
+                                  SolveControl *control = nullptr);
+
+/** Return true if solveTrajectory has a fixed-size kernel for n_c and n_w */
+bool hasFixedTrajectoryKernel(size_t n_c, size_t n_w);
+
+/** A function with the signature of solveTrajectory, which the solvers that run many solves call for each one */
+using TrajectorySolver = std::function<QuadrotorSolution(const QuadrotorProblem &problem,
+                                                         size_t n_c,
+                                                         const std::string &options,
+                                                         SolveControl *control)>;
+
+#endif /* TRAJECTORY_SOLVER_HEADER */
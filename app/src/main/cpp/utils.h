@@ -1,14 +1,106 @@
 #ifndef UTILS_HEADER
 #define UTILS_HEADER
 
+#include <cmath>
 #include "Eigen/Dense"
 
-/** Generate n collocation points. 
-    TODO: These should not be uniform */
-template<typename Scalar, typename Index, Index n_c>
+/** The distribution of the collocation points within each waypoint */
+enum class CollocationScheme {
+
+    /** Equally spaced points. These are simple, but the interpolation polynomial
+     * oscillates near the ends of the interval as the number of points grows (Runge's phenomenon). */
+    Uniform,
+
+    /** The endpoints and the roots of the derivative of the Legendre polynomial P_{n_c-1} */
+    LegendreGaussLobatto,
+
+    /** The extrema of the Chebyshev polynomial T_{n_c-1}, that is, (1 - cos(pi * i / (n_c-1))) / 2 */
+    ChebyshevGaussLobatto
+};
+
+/** Generate n_c collocation points on [0, 1] using the specified scheme.
+ * The points are sorted in increasing order and always include both endpoints. */
+template<typename Scalar>
+Eigen::Matrix<Scalar, Eigen::Dynamic, 1>
+generateCollocationPoints(size_t n_c, CollocationScheme scheme) {
+
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> points(n_c);
+    if (n_c == 1) {
+        points(0) = 0;
+        return points;
+    }
+
+    const size_t N = n_c - 1;
+    const double pi = 3.14159265358979323846;
+    switch (scheme) {
+
+        case CollocationScheme::Uniform:
+            for (size_t i = 0; i < n_c; ++i)
+                points(i) = static_cast<Scalar>(static_cast<double>(i) / N);
+            break;
+
+        case CollocationScheme::ChebyshevGaussLobatto:
+            for (size_t i = 0; i < n_c; ++i)
+                points(i) = static_cast<Scalar>((1 - std::cos(pi * i / N)) / 2);
+            break;
+
+        case CollocationScheme::LegendreGaussLobatto:
+
+            /* Use Newton's method on (1-x^2) P'_N(x), starting from the Chebyshev points.
+             * The Legendre polynomials are evaluated with the three term recurrence. */
+            for (size_t i = 0; i < n_c; ++i) {
+                double x = -std::cos(pi * i / N);
+                for (size_t iteration = 0; iteration < 100; ++iteration) {
+                    double p_previous = 1;
+                    double p = x;
+                    for (size_t k = 2; k <= N; ++k) {
+                        const double p_next = ((2 * k - 1) * x * p - (k - 1) * p_previous) / k;
+                        p_previous = p;
+                        p = p_next;
+                    }
+                    const double dx = (x * p - p_previous) / (n_c * p);
+                    x -= dx;
+                    if (std::abs(dx) <= 1e-15)
+                        break;
+                }
+                points(i) = static_cast<Scalar>((1 + x) / 2);
+            }
+            points(0) = 0;
+            points(N) = 1;
+            break;
+    }
+    return points;
+}
+
+/** Generate n_c collocation points on [0, 1] using the specified scheme.
+ * The points are only computed once for each n_c and scheme. */
+template<typename Scalar, typename Index, Index n_c, CollocationScheme scheme = CollocationScheme::Uniform>
 Eigen::Matrix<Scalar, n_c, 1>
 generateCollocationPoints() {
-    return Eigen::Matrix<Scalar, n_c, 1>::LinSpaced(n_c, 0, n_c - 1) / (n_c - 1);
+    static const Eigen::Matrix<Scalar, n_c, 1> points = generateCollocationPoints<Scalar>(n_c, scheme);
+    return points;
+}
+
+/**
+ * Compute the barycentric weights of the collocation points, that is,
+ *
+ * w(j) = 1 / prod_{k != j} ( c(j) - c(k) )
+ *
+ * These define the Lagrange interpolation polynomials through the points in a numerically stable way.
+ */
+template<typename Derived>
+Eigen::Matrix<typename Derived::Scalar, Derived::SizeAtCompileTime, 1>
+barycentricWeights(const Derived &collocation_points) {
+    const Eigen::Index n_c = collocation_points.size();
+    Eigen::Matrix<typename Derived::Scalar, Derived::SizeAtCompileTime, 1> weights(n_c);
+    for (Eigen::Index j = 0; j < n_c; ++j) {
+        weights(j) = 1;
+        for (Eigen::Index k = 0; k < n_c; ++k)
+            if (k != j)
+                weights(j) *= collocation_points(j) - collocation_points(k);
+        weights(j) = typename Derived::Scalar(1) / weights(j);
+    }
+    return weights;
 }
 
 /**
@@ -26,30 +118,118 @@ template<typename Derived>
 Eigen::Matrix<typename Derived::Scalar, Derived::SizeAtCompileTime, Derived::SizeAtCompileTime>
 lagrangeDerivativeCoefficients(const Derived &collocation_points) {
 
-    /* Calculate a matrix of differences between the collocation points so that
-     * dt(i,j) = c(i) - c(j)*/
     using Scalar = typename Derived::Scalar;
-    using Index = size_t;
-    const Index n_c = Derived::SizeAtCompileTime;
-    Eigen::Matrix<typename Derived::Scalar, n_c, n_c> dt = collocation_points.replicate(1, n_c);
-    dt -= dt.transpose().eval();
+    using Index = Eigen::Index;
+    const Index n_c = collocation_points.size();
+
+    /* The barycentric weights w(j) = 1 / prod_{k != j} (c(j) - c(k)) */
+    const Eigen::Matrix<Scalar, Derived::SizeAtCompileTime, 1> weights = barycentricWeights(collocation_points);
 
-    /* Now calculate all of the coefficients */
-    Eigen::Matrix<Scalar, n_c, n_c> derivative_coefficients;
+    /* The derivative of the j^th Lagrange polynomial at c(i) is
+     *
+     * (w(j) / w(i)) / (c(i) - c(j))
+     *
+     * for i != j. Since the derivative of a constant is zero, each column must sum to zero,
+     * so we compute the diagonal as the negative sum of the other entries.
+     * This is both cheaper and more accurate than the direct formula. */
+    Eigen::Matrix<Scalar, Derived::SizeAtCompileTime, Derived::SizeAtCompileTime> derivative_coefficients(n_c, n_c);
     for (Index i = 0; i < n_c; ++i) {
+        Scalar diagonal = 0;
         for (Index j = 0; j < n_c; ++j) {
-            Scalar dc_j_i = 0;
-            Scalar temp = 1;
-            for (Index k = 0; k < n_c; ++k) {
-                if (j != k) {
-                    dc_j_i = (temp + dc_j_i * dt(i, k)) / dt(j, k);
-                    temp = temp * dt(i, k) / dt(j, k);
-                }
+            if (j != i) {
+                derivative_coefficients(j, i) =
+                        (weights(j) / weights(i)) / (collocation_points(i) - collocation_points(j));
+                diagonal -= derivative_coefficients(j, i);
             }
-            derivative_coefficients(j, i) = dc_j_i;
         }
+        derivative_coefficients(i, i) = diagonal;
     }
     return derivative_coefficients;
 }
 
+/**
+ * This function calculates the values of the Lagrange interpolation polynomials
+ * of the collocation points at tau. That is, if fx denotes the values of a function
+ * at the collocation points (as in lagrangeDerivativeCoefficients), then
+ *
+ * fx * coeffs = f(tau)
+ *
+ * The weights must be the barycentric weights of the collocation points.
+ */
+template<typename Points, typename Weights>
+Eigen::Matrix<typename Points::Scalar, Points::SizeAtCompileTime, 1>
+lagrangeInterpolationCoefficients(const Points &collocation_points,
+                                  const Weights &weights,
+                                  typename Points::Scalar tau) {
+
+    using Scalar = typename Points::Scalar;
+    const Eigen::Index n_c = collocation_points.size();
+    Eigen::Matrix<Scalar, Points::SizeAtCompileTime, 1> coeffs(n_c);
+
+    /* At a collocation point, the interpolant simply returns the value there */
+    for (Eigen::Index j = 0; j < n_c; ++j) {
+        if (tau == collocation_points(j)) {
+            coeffs.setZero();
+            coeffs(j) = 1;
+            return coeffs;
+        }
+    }
+
+    /* Otherwise, use the second (true) form of the barycentric formula */
+    for (Eigen::Index j = 0; j < n_c; ++j)
+        coeffs(j) = weights(j) / (tau - collocation_points(j));
+    coeffs /= coeffs.sum();
+    return coeffs;
+}
+
+/**
+ * This function calculates the derivatives of the Lagrange interpolation polynomials
+ * of the collocation points at tau, so that
+ *
+ * fx * coeffs = df/dt(tau)
+ *
+ * The weights must be the barycentric weights of the collocation points.
+ */
+template<typename Points, typename Weights>
+Eigen::Matrix<typename Points::Scalar, Points::SizeAtCompileTime, 1>
+lagrangeInterpolationDerivativeCoefficients(const Points &collocation_points,
+                                            const Weights &weights,
+                                            typename Points::Scalar tau) {
+
+    using Scalar = typename Points::Scalar;
+    const Eigen::Index n_c = collocation_points.size();
+    Eigen::Matrix<Scalar, Points::SizeAtCompileTime, 1> coeffs(n_c);
+
+    /* At a collocation point, this is a column of the differentiation matrix */
+    for (Eigen::Index i = 0; i < n_c; ++i) {
+        if (tau == collocation_points(i)) {
+            Scalar diagonal = 0;
+            for (Eigen::Index j = 0; j < n_c; ++j) {
+                if (j != i) {
+                    coeffs(j) = (weights(j) / weights(i)) / (collocation_points(i) - collocation_points(j));
+                    diagonal -= coeffs(j);
+                }
+            }
+            coeffs(i) = diagonal;
+            return coeffs;
+        }
+    }
+
+    /* Otherwise, differentiate the barycentric formula p = sum_j a_j f_j / sum_j a_j, with
+     * a_j = w_j / (tau - c_j). This gives
+     *
+     * p' = sum_j a_j (p - f_j) / (tau - c_j) / sum_j a_j */
+    Eigen::Matrix<Scalar, Points::SizeAtCompileTime, 1> a(n_c);
+    Eigen::Matrix<Scalar, Points::SizeAtCompileTime, 1> inverse_distance(n_c);
+    for (Eigen::Index j = 0; j < n_c; ++j) {
+        inverse_distance(j) = 1 / (tau - collocation_points(j));
+        a(j) = weights(j) * inverse_distance(j);
+    }
+    const Scalar a_sum = a.sum();
+    const Scalar s = a.dot(inverse_distance) / a_sum;
+    for (Eigen::Index j = 0; j < n_c; ++j)
+        coeffs(j) = a(j) * (s - inverse_distance(j)) / a_sum;
+    return coeffs;
+}
+
 #endif /* UTILS_HEADER */
\ No newline at end of file
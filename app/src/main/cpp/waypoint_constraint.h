@@ -1,6 +1,7 @@
 #ifndef WAYPOINT_CONSTRAINT_HEADER
 #define WAYPOINT_CONSTRAINT_HEADER
 
+#include "derivative_demand.h"
 #include "variable_getter.h"
 #include "Eigen/Dense"
 #include "equality_constraint.h"
@@ -9,15 +10,16 @@
  * This ensures that a single component of the state hits some specified 
  * waypoints. Since there are n_w waypoints, this yields n_w conditions.
  */
-template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w, Index state_index>
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w, Index state_index,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
 struct WaypointConstraint
         : EqualityConstraint<
                 WaypointConstraint<
-                        Scalar, Index, n_x, n_u, n_c, n_w, state_index>, Scalar, Index, n_w> {
+                        Scalar, Index, n_x, n_u, n_c, n_w, state_index, Getter>, Scalar, Index, n_w> {
 
 private:
 
-    using Get = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Get = Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
     using Map = Eigen::Map<Eigen::Matrix<Scalar, 1, n_w>>;
 
     const Eigen::Matrix<Scalar, 1, n_w> waypoints;
@@ -25,6 +27,8 @@ private:
 public:
 
     static const Index derivatives = 0;
+    static const unsigned derivative_rows = NoRows;
+    static const unsigned derivative_columns = NoColumns;
 
     template<typename Waypoints>
     WaypointConstraint(const Waypoints &waypoints)
@@ -41,6 +45,19 @@ public:
         G = Get::statesAtCollocationPoint(x, n_c - 1).row(state_index) - waypoints;
         return g + this->n_constraints;
     }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return i_w;
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        g[0] = Get::state(x, n_c - 1, i_w)(state_index) - waypoints(i_w);
+        return g + 1;
+    }
 };
 
 #endif /* WAYPOINT_CONSTRAINT_HEADER */
\ No newline at end of file
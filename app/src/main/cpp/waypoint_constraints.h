@@ -1,6 +1,7 @@
 #ifndef WAYPOINT_CONSTRAINTS_HEADER
 #define WAYPOINT_CONSTRAINTS_HEADER
 
+#include "derivative_demand.h"
 #include "variable_getter.h"
 #include "Eigen/Dense"
 #include "equality_constraint.h"
@@ -10,15 +11,16 @@
  * all of the specified waypoints. Since there are n_w waypoints
  * and the state is of size n_x, this yields n_w * n_x conditions.
  */
-template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w>
+template<typename Scalar, typename Index, Index n_x, Index n_u, Index n_c, Index n_w,
+    template<typename, typename I, I, I, I, I> class Getter = VariableGetter>
 struct WaypointConstraints
         : EqualityConstraint<
                 WaypointConstraints<
-                        Scalar, Index, n_x, n_u, n_c, n_w>, Scalar, Index, n_x * n_w> {
+                        Scalar, Index, n_x, n_u, n_c, n_w, Getter>, Scalar, Index, n_x * n_w> {
 
 private:
 
-    using Get = VariableGetter<Scalar, Index, n_x, n_u, n_c, n_w>;
+    using Get = Getter<Scalar, Index, n_x, n_u, n_c, n_w>;
     using Map = Eigen::Map<Eigen::Matrix<Scalar, n_x, n_w >>;
 
     const Eigen::Matrix<Scalar, n_x, n_w> waypoints;
@@ -26,6 +28,8 @@ private:
 public:
 
     static const Index derivatives = 0;
+    static const unsigned derivative_rows = NoRows;
+    static const unsigned derivative_columns = NoColumns;
 
     template<typename Waypoints>
     WaypointConstraints(const Waypoints &waypoints)
@@ -40,6 +44,20 @@ public:
         G = Get::statesAtCollocationPoint(x, n_c - 1) - waypoints;
         return g + this->n_constraints;
     }
+
+    /** The offset of the rows of waypoint i_w within the rows of this class */
+    static constexpr Index waypointOffset(Index i_w) {
+        return n_x * i_w;
+    }
+
+    /** Evaluate only the rows of waypoint i_w and store the values in g.
+     * Then return a pointer past the rows that were written. */
+    template<typename LD>
+    Scalar *evaluateWaypoint(Scalar *g, const Scalar *x, LD &lagrange_derivatives, Index i_w) const {
+        Eigen::Map<Eigen::Matrix<Scalar, n_x, 1>> G(g);
+        G = Get::state(x, n_c - 1, i_w) - waypoints.col(i_w);
+        return g + n_x;
+    }
 };
 
 #endif /* COLLOCATION_CONSTRAINTS_HEADER */
\ No newline at end of file
@@ -0,0 +1,272 @@
+#ifndef WORK_STEALING_POOL_HEADER
+#define WORK_STEALING_POOL_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cppad/cppad.hpp"
+
+/**
+ * CppAD keeps its tapes and memory per thread, but only once it knows how to number the threads.
+ * Every thread that is not a pool worker is thread 0, and each live worker holds a number from 1 to
+ * CPPAD_MAX_NUM_THREADS - 1, which all of the pools share. Other threads that solve concurrently, such as the
+ * callers of trajectory_solve, reserve a number for the duration of each solve in the same way. A worker must not touch CppAD without its own number,
+ * so the numbers are reserved before the workers are started. CppAD is in parallel mode while any number is reserved.
+ *
+ * setup() must run while no worker is alive, which the WorkStealingPool does before starting its threads.
+ * Without NDEBUG, CppAD also checks that the first call of many of its templates (for example CheckSimpleVector
+ * for each vector type) is sequential, so debug builds need to run the same CppAD code once before any worker
+ * starts, see the prepare task of WorkStealingPool.
+ */
+class CppADThreads {
+private:
+
+    static std::mutex &mutex() {
+        static std::mutex instance;
+        return instance;
+    }
+
+    /** Which thread numbers are taken. Number 0 always is. */
+    static std::vector<bool> &taken() {
+        static std::vector<bool> instance(CPPAD_MAX_NUM_THREADS, false);
+        return instance;
+    }
+
+    static std::atomic<size_t> &workers() {
+        static std::atomic<size_t> instance{0};
+        return instance;
+    }
+
+    static size_t &number() {
+        static thread_local size_t instance = 0;
+        return instance;
+    }
+
+    static bool inParallel() {
+        return workers() > 0;
+    }
+
+    static size_t threadNumber() {
+        return number();
+    }
+
+public:
+
+    /** Tell CppAD how to number the threads, and initialize its statics for AD<double>. This only runs once. */
+    static void setup() {
+        static std::once_flag once;
+        std::call_once(once, [] {
+            CppAD::thread_alloc::parallel_setup(CPPAD_MAX_NUM_THREADS, inParallel, threadNumber);
+            CppAD::parallel_ad<double>();
+        });
+    }
+
+    /** Take a free thread number for a worker that is about to start. Return 0 if every number is taken. */
+    static size_t reserve() {
+        std::lock_guard<std::mutex> lock(mutex());
+        for (size_t i = 1; i < taken().size(); ++i) {
+            if (!taken()[i]) {
+                taken()[i] = true;
+                ++workers();
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    /** The number of the calling thread, which is 0 unless it entered with a reserved number */
+    static size_t current() {
+        return number();
+    }
+
+    /** Give the calling thread a number from reserve */
+    static void enter(size_t reserved) {
+        number() = reserved;
+    }
+
+    /** Release the memory that CppAD holds for the calling thread, and its thread number */
+    static void leave() {
+        CppAD::thread_alloc::free_available(number());
+        std::lock_guard<std::mutex> lock(mutex());
+        taken()[number()] = false;
+        number() = 0;
+        --workers();
+    }
+};
+
+/**
+ * A fixed set of worker threads, each with its own queue of tasks. A worker runs the newest task of its
+ * own queue first, and when that is empty, it steals the oldest task of another queue. Tasks that are submitted
+ * from a worker go to its own queue, and the others are spread over the queues in turn.
+ *
+ * Each worker has its own CppAD thread number (see CppADThreads), so the tasks can record tapes concurrently.
+ * A pool only starts as many workers as there are free numbers. If the other pools hold all of them,
+ * it has no workers, and submit runs each task on the calling thread.
+ */
+class WorkStealingPool {
+public:
+
+    using Task = std::function<void()>;
+
+private:
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+
+    /** The tasks that were submitted but not yet taken, and not yet finished */
+    size_t queued = 0;
+    size_t pending = 0;
+    bool stopping = false;
+
+    std::atomic<size_t> next_queue{0};
+
+    /** The pool whose worker runs on the calling thread, if any, and the index of that worker */
+    static const WorkStealingPool *&currentPool() {
+        static thread_local const WorkStealingPool *instance = nullptr;
+        return instance;
+    }
+
+    static size_t &currentWorker() {
+        static thread_local size_t instance = 0;
+        return instance;
+    }
+
+    bool take(size_t worker, Task &task) {
+        {
+            Queue &own = *queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            Queue &other = *queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if (!other.tasks.empty()) {
+                task = std::move(other.tasks.front());
+                other.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(size_t worker, size_t thread_number) {
+        currentPool() = this;
+        currentWorker() = worker;
+        CppADThreads::enter(thread_number);
+        for (;;) {
+            Task task;
+            if (take(worker, task)) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    --queued;
+                }
+                task();
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0)
+                    idle.notify_all();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0)
+                break;
+        }
+        CppADThreads::leave();
+    }
+
+public:
+
+    /**
+     * Start n_threads workers, at least one, and at most as many as there are free CppAD thread numbers.
+     * If given, prepare runs on the calling thread before the workers start, while CppAD is still sequential
+     * (unless another pool is alive).
+     */
+    explicit WorkStealingPool(size_t n_threads = std::thread::hardware_concurrency(),
+                              const Task &prepare = Task()) {
+        CppADThreads::setup();
+        if (prepare)
+            prepare();
+        std::vector<size_t> thread_numbers;
+        for (size_t i = 0; i < std::max<size_t>(n_threads, 1); ++i) {
+            const size_t thread_number = CppADThreads::reserve();
+            if (thread_number == 0)
+                break;
+            thread_numbers.push_back(thread_number);
+        }
+        for (size_t i = 0; i < thread_numbers.size(); ++i)
+            queues.emplace_back(new Queue());
+        for (size_t i = 0; i < thread_numbers.size(); ++i)
+            threads.emplace_back(&WorkStealingPool::run, this, i, thread_numbers[i]);
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    /** Finish the tasks that were already submitted, and stop the workers */
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    size_t size() const {
+        return threads.size();
+    }
+
+    /** The index of the worker of this pool that runs the calling thread, or size() if it is not one */
+    size_t workerIndex() const {
+        return currentPool() == this ? currentWorker() : size();
+    }
+
+    /** Run the task on a worker. The task must not throw, since nothing on the worker would catch it. */
+    void submit(Task task) {
+        if (threads.empty()) {
+            task();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++queued;
+            ++pending;
+        }
+        const size_t worker = workerIndex();
+        Queue &queue = *queues[worker < size() ? worker : next_queue++ % size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    /** Wait until every task that was submitted has finished. Do not call this from a worker. */
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return pending == 0; });
+    }
+};
+
+#endif /* WORK_STEALING_POOL_HEADER */